@@ -0,0 +1,23 @@
+#include "Actuator.h"
+
+//* Initializing static members
+uint32_t ActuatorCounters:: _totalWrites = 0;
+uint32_t ActuatorCounters:: _totalSuppressed = 0;
+
+/**
+ * @brief   Records the outcome of a write request.
+ * @note
+ * @param   written: true if the hardware was actually written
+ * @retval
+ */
+void ActuatorCounters::count(bool written)
+{
+    if (written) {
+        _writes++;
+        _totalWrites++;
+    }
+    else {
+        _suppressed++;
+        _totalSuppressed++;
+    }
+}
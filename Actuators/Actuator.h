@@ -0,0 +1,74 @@
+#ifndef ACTUATOR_H_
+#define ACTUATOR_H_
+
+#include <stdint.h>
+
+/**
+ * Write counters shared by all actuators.
+ * writes:      values actually written to the hardware
+ * suppressed:  requests skipped because the output already had that value
+ */
+class ActuatorCounters
+{
+    static uint32_t _totalWrites;
+    static uint32_t _totalSuppressed;
+
+protected:
+    uint32_t    _writes;
+    uint32_t    _suppressed;
+
+    ActuatorCounters() : _writes(0), _suppressed(0) {}
+
+    void    count(bool written);
+
+public:
+    uint32_t    writes(void) const { return _writes; }
+    uint32_t    suppressed(void) const { return _suppressed; }
+
+    static uint32_t totalWrites(void) { return _totalWrites; }
+    static uint32_t totalSuppressed(void) { return _totalSuppressed; }
+};
+
+/**
+ * Output that is only written when its value changes.
+ * Wraps any mbed style output assignable from 'Value' (DigitalOut, PwmOut, Servo).
+ *
+ * Example of use:
+ *
+ * @code
+ *
+ * DigitalOut              led(LED1);
+ * Actuator<DigitalOut>    led_out(led);
+ *
+ * while (1)
+ *     led_out.write(button);  // the pin is only touched when the button changes
+ *
+ * @endcode
+ */
+template <typename Output, typename Value = int>
+class Actuator : public ActuatorCounters
+{
+    Output& _out;
+    Value   _value;
+    bool    _written;
+
+public:
+    Actuator(Output& out) : _out(out), _value(), _written(false) {}
+
+    bool write(Value v)
+    {
+        bool    changed = !_written || !(v == _value);
+
+        if (changed) {
+            _out = v;
+            _value = v;
+            _written = true;
+        }
+
+        count(changed);
+        return changed;
+    }
+
+    Value   value(void) const { return _value; }
+};
+#endif /* ACTUATOR_H_ */
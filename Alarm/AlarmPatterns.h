@@ -0,0 +1,53 @@
+#ifndef ALARM_PATTERNS_H_
+#define ALARM_PATTERNS_H_
+
+#include <stdint.h>
+
+/**
+ * Tone patterns of the alarms.
+ * Each note is a PWM period in microseconds (0: silence) and a duration,
+ * the periods are computed by the compiler so the sequencer interrupt only
+ * copies integers into the PWM.
+ */
+struct AlarmNote
+{
+    uint16_t    period_us;
+    uint16_t    duration_ms;
+};
+
+constexpr uint16_t alarmTone(uint32_t hz)
+{
+    return (uint16_t)((1000000 + hz / 2) / hz);
+}
+
+/**
+ * Alarms by priority, a higher value preempts a lower one.
+ */
+enum AlarmPattern {
+    ALARM_SECURITY  = 0,
+    ALARM_FLOOD     = 1,
+    ALARM_FIRE      = 2,
+    ALARM_COUNT
+};
+
+// fire: fast two tone siren
+static constexpr AlarmNote ALARM_FIRE_NOTES[] = {
+    { alarmTone(1318), 250 }, { alarmTone(880), 250 }
+};
+
+// flood: slow falling three tones and a pause
+static constexpr AlarmNote ALARM_FLOOD_NOTES[] = {
+    { alarmTone(1046), 300 }, { alarmTone(784), 300 }, { alarmTone(523), 300 }, { 0, 600 }
+};
+
+// security: short chirps
+static constexpr AlarmNote ALARM_SECURITY_NOTES[] = {
+    { alarmTone(2093), 100 }, { 0, 100 }, { alarmTone(2093), 100 }, { 0, 100 },
+    { alarmTone(2093), 100 }, { 0, 500 }
+};
+
+static_assert(alarmTone(1318) == 759, "tone period");
+static_assert(sizeof(ALARM_FIRE_NOTES) / sizeof(AlarmNote) <= 16, "alarm_iterator in HomeState is 4 bits");
+static_assert(sizeof(ALARM_FLOOD_NOTES) / sizeof(AlarmNote) <= 16, "alarm_iterator in HomeState is 4 bits");
+static_assert(sizeof(ALARM_SECURITY_NOTES) / sizeof(AlarmNote) <= 16, "alarm_iterator in HomeState is 4 bits");
+#endif /* ALARM_PATTERNS_H_ */
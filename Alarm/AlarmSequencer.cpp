@@ -0,0 +1,140 @@
+#include "AlarmSequencer.h"
+
+struct AlarmMelody
+{
+    const AlarmNote*    notes;
+    uint8_t             count;
+};
+
+#define ALARM_MELODY(table) { table, sizeof(table) / sizeof(AlarmNote) }
+
+static const AlarmMelody    melodies[ALARM_COUNT] = {
+    ALARM_MELODY(ALARM_SECURITY_NOTES),
+    ALARM_MELODY(ALARM_FLOOD_NOTES),
+    ALARM_MELODY(ALARM_FIRE_NOTES)
+};
+
+/**
+ * @brief   Constructs the sequencer, the buzzer is silenced.
+ * @note
+ * @param   buzzer: PWM output driving the buzzer
+ * @retval
+ */
+AlarmSequencer::AlarmSequencer(PwmOut& buzzer) :
+    _buzzer(buzzer),
+    _active(0),
+    _playing(-1),
+    _step(0),
+    _notes(0),
+    _preemptions(0)
+{
+    _buzzer.pulsewidth_us(0);
+}
+
+/**
+ * @brief   Starts sounding 'pattern' unless a higher alarm is active.
+ * @note    Raising an alarm that is already active does nothing.
+ * @param
+ * @retval
+ */
+void AlarmSequencer::raise(AlarmPattern pattern)
+{
+    if (active(pattern))
+        return;
+
+    __disable_irq();
+    _active |= (1 << pattern);
+    if (_playing < (int8_t)pattern) {
+        if (_playing >= 0)
+            _preemptions++;
+        reschedule();
+    }
+    __enable_irq();
+}
+
+/**
+ * @brief   Stops 'pattern', the next lower active alarm takes over.
+ * @note
+ * @param
+ * @retval
+ */
+void AlarmSequencer::clear(AlarmPattern pattern)
+{
+    if (!active(pattern))
+        return;
+
+    __disable_irq();
+    _active &= ~(1 << pattern);
+    if (_playing == (int8_t)pattern)
+        reschedule();
+    __enable_irq();
+}
+
+/**
+ * @brief   Clears all alarms.
+ * @note
+ * @param
+ * @retval
+ */
+void AlarmSequencer::silence(void)
+{
+    if (!_active)
+        return;
+
+    __disable_irq();
+    _active = 0;
+    reschedule();
+    __enable_irq();
+}
+
+/**
+ * @brief   Drops the current note and plays from the highest active alarm.
+ * @note    Called with interrupts disabled.
+ * @param
+ * @retval
+ */
+void AlarmSequencer::reschedule(void)
+{
+    _timeout.detach();
+    next();
+}
+
+/**
+ * @brief   Timeout handler, plays the next note.
+ * @note
+ * @param
+ * @retval
+ */
+void AlarmSequencer::next(void)
+{
+    int8_t  pattern = ALARM_COUNT - 1;
+
+    while (pattern >= 0 && !(_active & (1 << pattern)))
+        pattern--;
+
+    if (pattern < 0) {
+        _buzzer.pulsewidth_us(0);
+        _playing = -1;
+        _step = 0;
+        return;
+    }
+
+    if (pattern != _playing) {
+        _playing = pattern;
+        _step = 0;
+    }
+
+    const AlarmMelody&  melody = melodies[pattern];
+    const AlarmNote&    note = melody.notes[_step];
+
+    if (note.period_us) {
+        _buzzer.period_us(note.period_us);
+        _buzzer.pulsewidth_us(note.period_us / 2);
+    }
+    else
+        _buzzer.pulsewidth_us(0);
+
+    _notes++;
+    _step = (_step + 1) % melody.count;
+    _timeout.attach_us(callback(this, &AlarmSequencer::next), (uint32_t)note.duration_ms * 1000);
+}
@@ -0,0 +1,55 @@
+#ifndef ALARM_SEQUENCER_H_
+#define ALARM_SEQUENCER_H_
+
+#include "mbed.h"
+#include "AlarmPatterns.h"
+
+/**
+ * Plays the alarm patterns on a buzzer from a Timeout interrupt.
+ *
+ * Every note re-arms the Timeout with its own duration, so the cadence does
+ * not depend on the main loop. Several alarms can be raised at once, the one
+ * with the highest priority sounds; raising a higher or clearing the playing
+ * alarm switches pattern immediately, not at the end of the note.
+ *
+ * Example of use:
+ *
+ * @code
+ *
+ * PwmOut          buzzer(p22);
+ * AlarmSequencer  siren(buzzer);
+ *
+ * siren.raise(ALARM_SECURITY);
+ * siren.raise(ALARM_FIRE);        // fire takes over
+ * siren.clear(ALARM_FIRE);        // back to the security chirps
+ * siren.silence();
+ *
+ * @endcode
+ */
+class AlarmSequencer
+{
+    PwmOut&             _buzzer;
+    Timeout             _timeout;
+    volatile uint8_t    _active;    // one bit per AlarmPattern
+    volatile int8_t     _playing;   // AlarmPattern or -1
+    volatile uint8_t    _step;
+    volatile uint32_t   _notes;
+    volatile uint32_t   _preemptions;
+
+    void    next(void);
+    void    reschedule(void);
+
+public:
+    AlarmSequencer(PwmOut& buzzer);
+
+    void        raise(AlarmPattern pattern);
+    void        clear(AlarmPattern pattern);
+    void        silence(void);
+
+    bool        active(AlarmPattern pattern) const { return _active & (1 << pattern); }
+    int         playing(void) const { return _playing; }
+    uint8_t     step(void) const { return _step; }
+    uint32_t    notes(void) const { return _notes; }
+    uint32_t    preemptions(void) const { return _preemptions; }
+};
+#endif /* ALARM_SEQUENCER_H_ */
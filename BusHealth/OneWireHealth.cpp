@@ -0,0 +1,231 @@
+#include "OneWireHealth.h"
+
+#define CHANGED_BUS     (1 << 15)
+
+static void bump(uint16_t& counter)
+{
+    if (counter < 0xFFFF)
+        counter++;
+}
+
+static uint32_t shorter(uint32_t a, uint32_t b)
+{
+    return a < b ? a : b;
+}
+
+/**
+ * @brief   Constructs the health of a bus, no device in quarantine.
+ * @note
+ * @param
+ * @retval
+ */
+OneWireHealth::OneWireHealth() :
+    _changed(0)
+{
+    memset(_devices, 0, sizeof(_devices));
+    memset(&_bus, 0, sizeof(_bus));
+    for (uint8_t i = 0; i < OW_HEALTH_DEVICES; i++) {
+        _devices[i].quarantine_ms = OW_QUARANTINE_MS;
+        _devices[i].max_ms = OW_QUARANTINE_MAX_MS;
+    }
+}
+
+/**
+ * @brief   Counts an attempt for the device and the bus.
+ * @note
+ * @param   dev:    the device
+ * @param   result: OW_xxx of the attempt
+ * @param   retry:  the attempt is a retry
+ * @retval
+ */
+void OneWireHealth::count(Device& dev, uint8_t result, bool retry)
+{
+    OneWireStats*   stats[2] = { &dev.stats, &_bus };
+
+    for (uint8_t i = 0; i < 2; i++) {
+        if (retry)
+            bump(stats[i]->retries);
+        else
+            stats[i]->transactions++;
+        if (result == OW_NO_PRESENCE)
+            bump(stats[i]->presence_failures);
+        else if (result == OW_CRC_ERROR)
+            bump(stats[i]->crc_errors);
+    }
+
+    // plain successes are not worth a report
+    if (retry || result != OW_OK)
+        _changed |= (1 << (&dev - _devices)) | CHANGED_BUS;
+}
+
+/**
+ * @brief   Scores a transaction and puts the device in quarantine when it
+ *          fails too often.
+ * @note
+ * @param   dev:    the device
+ * @param   result: OW_xxx of the transaction, after the retries
+ * @param   now_ms: free running millisecond clock
+ * @retval
+ */
+void OneWireHealth::judge(Device& dev, uint8_t result, uint32_t now_ms)
+{
+    if (result == OW_OK) {
+        if (dev.score > 0)
+            dev.score--;
+        if (dev.score == 0)
+            dev.quarantine_ms = shorter(OW_QUARANTINE_MS, dev.max_ms);  // healthy again, forget the past quarantines
+        return;
+    }
+
+    dev.score += 2;
+    if (dev.score < OW_QUARANTINE_SCORE)
+        return;
+
+    dev.quarantined = true;
+    dev.release_ms = now_ms + dev.quarantine_ms;
+    dev.quarantine_ms = shorter(dev.quarantine_ms * 2, dev.max_ms);
+    dev.score = OW_QUARANTINE_SCORE - 2;            // one more failure after the release and it is back in
+    bump(dev.stats.quarantines);
+    bump(_bus.quarantines);
+    _changed |= (1 << (&dev - _devices)) | CHANGED_BUS;
+}
+
+/**
+ * @brief   Runs a DS1820 transaction with retries.
+ * @note    Blocks for the retries, at most OW_RETRIES transactions and
+ *          their backoff.
+ * @param   device: number of the device on the bus
+ * @param   sensor: the device
+ * @param   temp:   filled with the temperature, NULL to start a conversion
+ * @param   now_ms: free running millisecond clock
+ * @retval  OW_xxx
+ */
+uint8_t OneWireHealth::transaction(uint8_t device, DS1820& sensor, float* temp, uint32_t now_ms)
+{
+    MBED_ASSERT(device < OW_HEALTH_DEVICES);
+
+    Device&     dev = _devices[device];
+
+    if (dev.quarantined) {
+        if ((int32_t)(now_ms - dev.release_ms) < 0) {
+            bump(dev.stats.skipped);   // reported with the next change, not worth one
+            bump(_bus.skipped);
+            return OW_QUARANTINED;
+        }
+        dev.quarantined = false;
+        _changed |= (1 << device) | CHANGED_BUS;
+    }
+
+    uint32_t    backoff_us = OW_BACKOFF_US;
+    uint8_t     result;
+
+    for (uint8_t attempt = 0; ; attempt++) {
+        if (temp)
+            result = sensor.read(*temp);
+        else
+            result = sensor.startConversion() ? OW_OK : OW_NO_PRESENCE;
+        count(dev, result, attempt > 0);
+        if (result == OW_OK || attempt == OW_RETRIES)
+            break;
+
+        wait_us(backoff_us);
+        backoff_us = backoff_us * 2 < OW_BACKOFF_MAX_US ? backoff_us * 2 : OW_BACKOFF_MAX_US;
+    }
+
+    judge(dev, result, now_ms);
+    return result;
+}
+
+/**
+ * @brief   Starts a temperature conversion.
+ * @note
+ * @param   sensor: the device
+ * @param   device: number of the device on the bus
+ * @param   now_ms: free running millisecond clock
+ * @retval  OW_OK, OW_NO_PRESENCE or OW_QUARANTINED
+ */
+uint8_t OneWireHealth::startConversion(DS1820& sensor, uint8_t device, uint32_t now_ms)
+{
+    return transaction(device, sensor, NULL, now_ms);
+}
+
+/**
+ * @brief   Reads the temperature.
+ * @note    'temp' is only updated on OW_OK.
+ * @param   sensor: the device
+ * @param   device: number of the device on the bus
+ * @param   temp:   the temperature
+ * @param   now_ms: free running millisecond clock
+ * @retval  OW_xxx
+ */
+uint8_t OneWireHealth::read(DS1820& sensor, uint8_t device, float& temp, uint32_t now_ms)
+{
+    return transaction(device, sensor, &temp, now_ms);
+}
+
+/**
+ * @brief   Limits the quarantines of a device.
+ * @note    For the devices a safety function depends on, they are tried
+ *          again at least every 'max_ms'.
+ * @param   device: number of the device on the bus
+ * @param   max_ms: longest quarantine, OW_QUARANTINE_MAX_MS by default
+ * @retval
+ */
+void OneWireHealth::setMaxQuarantine(uint8_t device, uint32_t max_ms)
+{
+    MBED_ASSERT(device < OW_HEALTH_DEVICES);
+
+    Device&     dev = _devices[device];
+
+    dev.max_ms = max_ms;
+    dev.quarantine_ms = shorter(dev.quarantine_ms, max_ms);
+}
+
+/**
+ * @brief   Tells if a device is in quarantine.
+ * @note
+ * @param   device: number of the device, OW_HEALTH_BUS for any device
+ * @retval
+ */
+bool OneWireHealth::quarantined(uint8_t device) const
+{
+    if (device < OW_HEALTH_DEVICES)
+        return _devices[device].quarantined;
+    for (uint8_t i = 0; i < OW_HEALTH_DEVICES; i++)
+        if (_devices[i].quarantined)
+            return true;
+    return false;
+}
+
+/**
+ * @brief   Gets a device whose error counters changed since it was last returned.
+ * @note    The bus comes last, as OW_HEALTH_BUS.
+ * @param   device: filled with the number of the device
+ * @retval  false when nothing changed
+ */
+bool OneWireHealth::nextChanged(uint8_t& device)
+{
+    for (uint8_t i = 0; i < OW_HEALTH_DEVICES; i++)
+        if (_changed & (1 << i)) {
+            _changed &= ~(1 << i);
+            device = i;
+            return true;
+        }
+    if (_changed & CHANGED_BUS) {
+        _changed = 0;
+        device = OW_HEALTH_BUS;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief   Error counters of a device.
+ * @note
+ * @param   device: number of the device, OW_HEALTH_BUS for the bus
+ * @retval
+ */
+const OneWireStats& OneWireHealth::device(uint8_t device) const
+{
+    return device < OW_HEALTH_DEVICES ? _devices[device].stats : _bus;
+}
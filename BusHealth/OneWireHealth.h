@@ -0,0 +1,109 @@
+#ifndef ONE_WIRE_HEALTH_H_
+#define ONE_WIRE_HEALTH_H_
+
+#include "mbed.h"
+#include "DS1820.h"
+
+#define OW_HEALTH_DEVICES       4           // devices tracked on a bus
+#define OW_HEALTH_BUS           0xFF        // device number of the bus totals
+#define OW_RETRIES              2           // retries of a failed transaction
+#define OW_BACKOFF_US           100         // wait before the first retry, doubles for each one
+#define OW_BACKOFF_MAX_US       1000
+#define OW_QUARANTINE_SCORE     6           // a failure adds 2, a success takes 1 off
+#define OW_QUARANTINE_MS        10000       // first quarantine, doubles for each one in a row
+#define OW_QUARANTINE_MAX_MS    300000
+
+/**
+ * Result of a transaction, 0..2 are the DS1820::read() error codes.
+ */
+enum OneWireResult {
+    OW_OK           = 0,
+    OW_NO_PRESENCE  = 1,    // no presence pulse, the bus is shorted or empty
+    OW_CRC_ERROR    = 2,
+    OW_QUARANTINED  = 3     // not tried, the device is in quarantine
+};
+
+/**
+ * Error counters of a device, or of the whole bus.
+ */
+struct OneWireStats
+{
+    uint32_t    transactions;
+    uint16_t    presence_failures;  // attempts without a presence pulse
+    uint16_t    crc_errors;         // attempts that read a bad CRC
+    uint16_t    retries;
+    uint16_t    quarantines;
+    uint16_t    skipped;            // transactions not tried because of a quarantine
+};
+
+/**
+ * Health of the devices on a 1-Wire bus.
+ *
+ * Every DS1820 transaction goes through here. A failed attempt (no
+ * presence pulse, CRC error) is retried right away up to OW_RETRIES times,
+ * the wait before each retry doubles from OW_BACKOFF_US up to
+ * OW_BACKOFF_MAX_US. Failed transactions raise a score a success lowers,
+ * so a device that keeps failing or flaps between working and failing
+ * reaches OW_QUARANTINE_SCORE and is left alone for a while: its
+ * transactions return OW_QUARANTINED without touching the bus. The
+ * quarantine doubles each time the device fails again right after it,
+ * up to OW_QUARANTINE_MAX_MS. A device the house cannot do without for
+ * long, e.g. the only sensor of the fire detector, gets a shorter limit
+ * with setMaxQuarantine().
+ *
+ * The attempts are counted per device and for the bus.
+ *
+ * Example of use:
+ *
+ * @code
+ *
+ * DS1820          sensor(p6);
+ * OneWireHealth   health;
+ * float           temp;
+ * uint8_t         device;
+ *
+ * sensor.begin();
+ * while (1) {
+ *     health.startConversion(sensor, 0, uptime_ms());
+ *     wait(1.0);
+ *     if (health.read(sensor, 0, temp, uptime_ms()) == OW_OK)
+ *         pc.printf("temp = %3.1f\r\n", temp);
+ *     while (health.nextChanged(device))
+ *         pc.printf("device %d: %d crc errors\r\n", device, health.device(device).crc_errors);
+ * }
+ *
+ * @endcode
+ */
+class OneWireHealth
+{
+    struct Device
+    {
+        OneWireStats    stats;
+        uint8_t         score;
+        bool            quarantined;
+        uint32_t        release_ms;
+        uint32_t        quarantine_ms;  // length of the next quarantine
+        uint32_t        max_ms;         // longest quarantine
+    };
+
+    Device          _devices[OW_HEALTH_DEVICES];
+    OneWireStats    _bus;
+    uint16_t        _changed;           // bit n: device n counters changed, bit 15: the bus
+
+    uint8_t transaction(uint8_t device, DS1820& sensor, float* temp, uint32_t now_ms);
+    void    count(Device& dev, uint8_t result, bool retry);
+    void    judge(Device& dev, uint8_t result, uint32_t now_ms);
+
+public:
+    OneWireHealth();
+
+    uint8_t startConversion(DS1820& sensor, uint8_t device, uint32_t now_ms);
+    uint8_t read(DS1820& sensor, uint8_t device, float& temp, uint32_t now_ms);
+    void    setMaxQuarantine(uint8_t device, uint32_t max_ms);
+    bool    quarantined(uint8_t device) const;
+    bool    nextChanged(uint8_t& device);
+
+    const OneWireStats& device(uint8_t device) const;
+    const OneWireStats& bus(void) const { return _bus; }
+};
+#endif /* ONE_WIRE_HEALTH_H_ */
@@ -0,0 +1,114 @@
+#include "ClimateController.h"
+
+/**
+ * @brief   Constructs a hysteresis controller.
+ * @note
+ * @param   setpoint_centi: middle of the band, 1/100 degC
+ * @param   band_centi:     width of the band, 1/100 degC
+ * @param   demand:         output when on, > 0 heats, < 0 cools
+ * @retval
+ */
+HysteresisController::HysteresisController(int16_t setpoint_centi, int16_t band_centi, int16_t demand) :
+    _setpoint(setpoint_centi),
+    _band(band_centi),
+    _demand(demand),
+    _on(false)
+{ }
+
+/**
+ * @brief   Switches on and off at the edges of the band.
+ * @note
+ * @param
+ * @retval  'demand' or 0
+ */
+int16_t HysteresisController::update(int16_t temp_centi, uint32_t /*dt_ms*/)
+{
+    int16_t low = _setpoint - _band / 2;
+    int16_t high = _setpoint + _band / 2;
+
+    if (_demand > 0) {
+        if (temp_centi < low)
+            _on = true;
+        else if (temp_centi > high)
+            _on = false;
+    }
+    else {
+        if (temp_centi > high)
+            _on = true;
+        else if (temp_centi < low)
+            _on = false;
+    }
+
+    return _on ? _demand : 0;
+}
+
+/**
+ * @brief   Constructs a PID controller.
+ * @note
+ * @param   setpoint_centi: target temperature, 1/100 degC
+ * @param   gains:          Q16 gains
+ * @param   min, max:       output range, permille
+ * @retval
+ */
+PidController::PidController(int16_t setpoint_centi, const PidGains& gains, int16_t min, int16_t max) :
+    _gains(gains),
+    _setpoint(setpoint_centi),
+    _min(min),
+    _max(max)
+{
+    reset();
+}
+
+/**
+ * @brief   Clears the integral and the derivative history.
+ * @note
+ * @param
+ * @retval
+ */
+void PidController::reset(void)
+{
+    _integral = 0;
+    _last = 0;
+    _first = true;
+}
+
+/**
+ * @brief   One control step.
+ * @note
+ * @param   temp_centi: measured temperature, 1/100 degC
+ * @param   dt_ms:      time since the previous step
+ * @retval  Demand, permille within [min, max]
+ */
+int16_t PidController::update(int16_t temp_centi, uint32_t dt_ms)
+{
+    int32_t error = _setpoint - temp_centi;
+    int64_t p = (int64_t)_gains.kp * error;
+    int64_t d = 0;
+    int64_t lo = (int64_t)_min << 16;
+    int64_t hi = (int64_t)_max << 16;
+
+    if (!_first && dt_ms)
+        d = -((int64_t)_gains.kd * (temp_centi - _last) * 1000) / dt_ms;
+    _last = temp_centi;
+    _first = false;
+
+    int64_t integral = _integral + ((int64_t)_gains.ki * error * dt_ms) / 1000;
+    int64_t out = p + _integral + d;
+
+    // conditional integration: only while it does not push further into saturation
+    if (!((out >= hi && error > 0) || (out <= lo && error < 0))) {
+        if (integral > hi)
+            integral = hi;
+        else if (integral < lo)
+            integral = lo;
+        _integral = (int32_t)integral;
+        out = p + _integral + d;
+    }
+
+    if (out > hi)
+        out = hi;
+    else if (out < lo)
+        out = lo;
+
+    return (int16_t)(out >> 16);
+}
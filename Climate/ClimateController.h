@@ -0,0 +1,87 @@
+#ifndef CLIMATE_CONTROLLER_H_
+#define CLIMATE_CONTROLLER_H_
+
+#include <stdint.h>
+
+#define CLIMATE_FULL_DEMAND 1000    // demand is in permille of full power
+
+/**
+ * Interface of the climate control laws.
+ *
+ * update() takes the temperature in 1/100 degC and the time since the last
+ * call, and returns the demand in permille: positive to heat, negative to
+ * cool. All implementations are integer only.
+ */
+class ClimateController
+{
+public:
+    virtual ~ClimateController() {}
+
+    virtual int16_t update(int16_t temp_centi, uint32_t dt_ms) = 0;
+    virtual void    reset(void) = 0;
+};
+
+/**
+ * On/off control with a hysteresis band around the setpoint.
+ *
+ * 'demand' gives the direction: a positive demand switches on below
+ * setpoint - band/2 and off above setpoint + band/2 (heating), a negative
+ * demand the other way round (cooling).
+ */
+class HysteresisController : public ClimateController
+{
+    int16_t _setpoint;
+    int16_t _band;
+    int16_t _demand;
+    bool    _on;
+
+public:
+    HysteresisController(int16_t setpoint_centi, int16_t band_centi, int16_t demand);
+
+    int16_t update(int16_t temp_centi, uint32_t dt_ms);
+    void    reset(void) { _on = false; }
+};
+
+/**
+ * Gains of the PID controller, Q16.16.
+ * kp: permille per 1/100 degC
+ * ki: permille per 1/100 degC and second
+ * kd: permille per 1/100 degC per second
+ */
+struct PidGains
+{
+    int32_t kp;
+    int32_t ki;
+    int32_t kd;
+};
+
+#define PID_GAIN(x)     ((int32_t)((x) * 65536.0 + 0.5))
+
+/**
+ * PID controller in Q16.16 fixed point, output clamped to [min, max].
+ *
+ * The derivative acts on the measurement so a setpoint change gives no kick.
+ * Anti-windup: the integral is clamped to the output range and is not
+ * integrated further while the output is saturated in the same direction.
+ * A heating loop uses [0, 1000], a cooling loop [-1000, 0] with the error
+ * sign handled by the clamp.
+ */
+class PidController : public ClimateController
+{
+    PidGains    _gains;
+    int16_t     _setpoint;
+    int16_t     _min;
+    int16_t     _max;
+    int32_t     _integral;  // Q16 permille
+    int16_t     _last;
+    bool        _first;
+
+public:
+    PidController(int16_t setpoint_centi, const PidGains& gains, int16_t min, int16_t max);
+
+    int16_t update(int16_t temp_centi, uint32_t dt_ms);
+    void    reset(void);
+    void    setSetpoint(int16_t setpoint_centi) { _setpoint = setpoint_centi; }
+    int32_t integral(void) const { return _integral >> 16; }
+};
+#endif /* CLIMATE_CONTROLLER_H_ */
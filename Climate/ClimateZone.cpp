@@ -0,0 +1,106 @@
+#include "ClimateZone.h"
+
+/**
+ * @brief   Constructs a zone.
+ * @note
+ * @param   heat:       controller returning the heating demand (>= 0)
+ * @param   cool:       controller returning the cooling demand (<= 0)
+ * @param   period_ms:  duty cycle window
+ * @param   min_on_ms:  shortest on and off time
+ * @retval
+ */
+ClimateZone::ClimateZone(ClimateController& heat, ClimateController& cool,
+                         uint32_t period_ms /*= CLIMATE_PERIOD_MS*/, uint32_t min_on_ms /*= CLIMATE_MIN_ON_MS*/) :
+    _heat(heat),
+    _cool(cool),
+    _period_ms(period_ms),
+    _min_on_ms(min_on_ms)
+{
+    reset();
+}
+
+/**
+ * @brief   Turns both outputs off and clears the controllers.
+ * @note
+ * @param
+ * @retval
+ */
+void ClimateZone::reset(void)
+{
+    _heat.reset();
+    _cool.reset();
+    _demand = 0;
+    _on_ms = 0;
+    _direction = 0;
+    _started = false;
+}
+
+/**
+ * @brief   Runs both controllers on a new temperature reading.
+ * @note    Heating wins if both ask for power (overlapping setpoints).
+ * @param
+ * @retval  Demand, permille
+ */
+int16_t ClimateZone::update(int16_t temp_centi, uint32_t dt_ms)
+{
+    int16_t heat = _heat.update(temp_centi, dt_ms);
+    int16_t cool = _cool.update(temp_centi, dt_ms);
+
+    _demand = heat > 0 ? heat : cool;
+    return _demand;
+}
+
+/**
+ * @brief   Starts a new window when the previous one ended.
+ * @note    The demand is latched per window, a new reading changes the
+ *          on time of the next window. A window is cut short, once the
+ *          minimum on or off time has passed, when the demand switches
+ *          between heating, cooling and idle.
+ * @param
+ * @retval
+ */
+void ClimateZone::tick(uint32_t now_ms)
+{
+    uint32_t    elapsed = now_ms - _window_start;
+    int8_t      wanted = _demand > 0 ? 1 : (_demand < 0 ? -1 : 0);
+
+    if (_started && elapsed < _period_ms && !(wanted != _direction && elapsed >= _min_on_ms))
+        return;
+
+    uint32_t    level = _demand < 0 ? -_demand : _demand;
+    uint32_t    on = (level * _period_ms) / CLIMATE_FULL_DEMAND;
+
+    if (on < _min_on_ms)
+        on = (on * 2 >= _min_on_ms) ? _min_on_ms : 0;
+    else if (_period_ms - on < _min_on_ms)
+        on = _period_ms;
+
+    _window_start = now_ms;
+    _on_ms = on;
+    _direction = on ? (_demand > 0 ? 1 : -1) : 0;
+    _started = true;
+}
+
+/**
+ * @brief   Tells if the heater is on at 'now_ms'.
+ * @note
+ * @param
+ * @retval
+ */
+bool ClimateZone::heating(uint32_t now_ms)
+{
+    tick(now_ms);
+    return _direction > 0 && (now_ms - _window_start) < _on_ms;
+}
+
+/**
+ * @brief   Tells if the aircon is on at 'now_ms'.
+ * @note
+ * @param
+ * @retval
+ */
+bool ClimateZone::cooling(uint32_t now_ms)
+{
+    tick(now_ms);
+    return _direction < 0 && (now_ms - _window_start) < _on_ms;
+}
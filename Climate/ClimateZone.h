@@ -0,0 +1,58 @@
+#ifndef CLIMATE_ZONE_H_
+#define CLIMATE_ZONE_H_
+
+#include <stdint.h>
+#include "ClimateController.h"
+
+#define CLIMATE_PERIOD_MS   1200000 // duty cycle window
+#define CLIMATE_MIN_ON_MS   300000  // shortest on or off time of the heater or aircon
+
+/**
+ * One heated and cooled zone.
+ *
+ * A heating and a cooling controller (any ClimateController) give the
+ * demand, a slow duty cycle turns it into on/off times for the heater or
+ * the aircon. Within a window of 'period_ms' the output is on for
+ * demand * period, but never for less than 'min_on_ms' and never off for
+ * less than that either, so the equipment does not short cycle.
+ *
+ * Example of use:
+ *
+ * @code
+ *
+ * PidController   heat(2450, gains, 0, CLIMATE_FULL_DEMAND);
+ * PidController   cool(2650, gains, -CLIMATE_FULL_DEMAND, 0);
+ * ClimateZone     living(heat, cool);
+ *
+ * living.update(temp_centi, 10000);   // every new reading
+ * heater = living.heating(now_ms);    // as often as you like
+ * aircon = living.cooling(now_ms);
+ *
+ * @endcode
+ */
+class ClimateZone
+{
+    ClimateController&  _heat;
+    ClimateController&  _cool;
+    uint32_t            _period_ms;
+    uint32_t            _min_on_ms;
+    int16_t             _demand;
+    uint32_t            _window_start;
+    uint32_t            _on_ms;
+    int8_t              _direction;     // 1 heat, -1 cool, 0 idle in this window
+    bool                _started;
+
+    void    tick(uint32_t now_ms);
+
+public:
+    ClimateZone(ClimateController& heat, ClimateController& cool,
+                uint32_t period_ms = CLIMATE_PERIOD_MS, uint32_t min_on_ms = CLIMATE_MIN_ON_MS);
+
+    int16_t     update(int16_t temp_centi, uint32_t dt_ms);
+    void        reset(void);
+
+    bool        heating(uint32_t now_ms);
+    bool        cooling(uint32_t now_ms);
+    int16_t     demand(void) const { return _demand; }
+};
+#endif /* CLIMATE_ZONE_H_ */
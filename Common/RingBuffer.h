@@ -0,0 +1,51 @@
+#ifndef RING_BUFFER_H_
+#define RING_BUFFER_H_
+
+#include <stdint.h>
+
+/**
+ * Lock-free single producer / single consumer queue.
+ * One side may run in an interrupt handler, the other in the main loop.
+ * N must be a power of two, one slot is never used so N - 1 items fit.
+ */
+template <typename T, uint32_t N>
+class RingBuffer
+{
+    T                   _items[N];
+    volatile uint32_t   _head;      // written by the producer only
+    volatile uint32_t   _tail;      // written by the consumer only
+
+public:
+    RingBuffer() : _head(0), _tail(0) {}
+
+    bool push(const T& item)
+    {
+        uint32_t    head = _head;
+        uint32_t    next = (head + 1) & (N - 1);
+
+        if (next == _tail)
+            return false;           // full
+        _items[head] = item;
+        _head = next;
+        return true;
+    }
+
+    bool pop(T& item)
+    {
+        uint32_t    tail = _tail;
+
+        if (tail == _head)
+            return false;           // empty
+        item = _items[tail];
+        _tail = (tail + 1) & (N - 1);
+        return true;
+    }
+
+    bool        empty(void) const { return _head == _tail; }
+    uint32_t    count(void) const { return (_head - _tail) & (N - 1); }
+    void        clear(void) { _tail = _head; }
+
+private:
+    static_assert((N & (N - 1)) == 0, "RingBuffer size must be a power of two");
+};
+#endif /* RING_BUFFER_H_ */
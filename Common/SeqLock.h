@@ -0,0 +1,62 @@
+#ifndef SEQ_LOCK_H_
+#define SEQ_LOCK_H_
+
+#include <stdint.h>
+
+#if defined(__arm__) || defined(__ARMCC_VERSION)
+    #include "mbed.h"
+    #define SEQLOCK_BARRIER()   __DMB()
+#else
+    #define SEQLOCK_BARRIER()   __sync_synchronize()
+#endif
+
+/**
+ * Sequence lock publishing a value from one writer to any number of readers.
+ *
+ * The writer never waits and never disables interrupts. The sequence number
+ * is odd while an update is in progress. A reader retries if it saw an odd
+ * number or if the number changed while it was copying.
+ *
+ * There must be a single writer context. A reader running in an interrupt
+ * that pre-empted the writer can never see the update finish, so interrupt
+ * handlers must use tryRead() and keep their previous snapshot when it fails.
+ */
+template <typename T>
+class SeqLock
+{
+    volatile uint32_t   _seq;
+    T                   _value;
+
+public:
+    SeqLock() : _seq(0), _value() {}
+
+    void write(const T& value)
+    {
+        _seq = _seq + 1;
+        SEQLOCK_BARRIER();
+        _value = value;
+        SEQLOCK_BARRIER();
+        _seq = _seq + 1;
+    }
+
+    bool tryRead(T& value) const
+    {
+        uint32_t    seq = _seq;
+
+        if (seq & 1)
+            return false;
+        SEQLOCK_BARRIER();
+        value = _value;
+        SEQLOCK_BARRIER();
+        return seq == _seq;
+    }
+
+    void read(T& value) const
+    {
+        while (!tryRead(value))
+            ;
+    }
+
+    uint32_t    sequence(void) const { return _seq; }
+};
+#endif /* SEQ_LOCK_H_ */
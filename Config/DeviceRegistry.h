@@ -0,0 +1,204 @@
+#ifndef DEVICE_REGISTRY_H_
+#define DEVICE_REGISTRY_H_
+
+#include "HouseConfig.h"
+#include "WaterSampler.h"
+#include "EchoRanger.h"
+#include "Actuator.h"
+
+/*
+Compile time queries and checks over HOUSE_DEVICES (HouseConfig.h).
+Everything here is constexpr or a template, it costs no code or RAM: the
+drivers are constructed with constant pins and nothing is looked up at run
+time. C++11 constexpr functions are single expressions, hence the recursion.
+*/
+
+#define HOUSE_DEVICE_COUNT  (sizeof(HOUSE_DEVICES) / sizeof(DeviceConfig))
+#define DS1820_CONVERSION_US    750000  // 12 bit conversion time
+#define ANALOGIN_MIN_US         20      // slowest LPC1768 AnalogIn read, incl. the mbed layer
+
+constexpr unsigned house_device_count(DeviceKind kind, unsigned index = 0)
+{
+    return index == HOUSE_DEVICE_COUNT ? 0 :
+           (HOUSE_DEVICES[index].kind == kind ? 1 : 0) + house_device_count(kind, index + 1);
+}
+
+// index in HOUSE_DEVICES of the 'ordinal'th device of 'kind'
+constexpr unsigned house_device_index(DeviceKind kind, unsigned ordinal, unsigned index = 0)
+{
+    return index == HOUSE_DEVICE_COUNT ? HOUSE_DEVICE_COUNT :
+           HOUSE_DEVICES[index].kind == kind ?
+               (ordinal == 0 ? index : house_device_index(kind, ordinal - 1, index + 1)) :
+               house_device_index(kind, ordinal, index + 1);
+}
+
+constexpr PinName house_pin(DeviceKind kind, unsigned ordinal = 0)
+{
+    return house_device_index(kind, ordinal) == HOUSE_DEVICE_COUNT ? NC :
+           HOUSE_DEVICES[house_device_index(kind, ordinal)].pin;
+}
+
+constexpr uint8_t house_zone(DeviceKind kind, unsigned ordinal = 0)
+{
+    return HOUSE_DEVICES[house_device_index(kind, ordinal)].zone;
+}
+
+constexpr uint32_t house_period_us(DeviceKind kind, unsigned ordinal = 0)
+{
+    return HOUSE_DEVICES[house_device_index(kind, ordinal)].period_us;
+}
+
+constexpr bool house_pin_used_after(PinName pin, unsigned index)
+{
+    return index == HOUSE_DEVICE_COUNT ? false :
+           HOUSE_DEVICES[index].pin == pin || house_pin_used_after(pin, index + 1);
+}
+
+constexpr bool house_pins_unique(unsigned index = 0)
+{
+    return index == HOUSE_DEVICE_COUNT ? true :
+           !house_pin_used_after(HOUSE_DEVICES[index].pin, index + 1) && house_pins_unique(index + 1);
+}
+
+// LPC1768 pin functions (the pin names are not numbered in board order)
+constexpr bool pin_is_pwm(PinName pin)
+{
+    return pin == p21 || pin == p22 || pin == p23 || pin == p24 || pin == p25 || pin == p26;
+}
+
+constexpr bool pin_is_analog(PinName pin)
+{
+    return pin == p15 || pin == p16 || pin == p17 || pin == p18 || pin == p19 || pin == p20;
+}
+
+constexpr bool pins_are_uart(PinName tx, PinName rx)
+{
+    return (tx == p9 && rx == p10) || (tx == p13 && rx == p14) || (tx == p28 && rx == p27);
+}
+
+constexpr bool house_kind_on_pwm(DeviceKind kind, unsigned ordinal = 0)
+{
+    return ordinal == house_device_count(kind) ? true :
+           pin_is_pwm(house_pin(kind, ordinal)) && house_kind_on_pwm(kind, ordinal + 1);
+}
+
+constexpr bool house_kind_on_analog(DeviceKind kind, unsigned ordinal = 0)
+{
+    return ordinal == house_device_count(kind) ? true :
+           pin_is_analog(house_pin(kind, ordinal)) && house_kind_on_analog(kind, ordinal + 1);
+}
+
+constexpr unsigned HOUSE_ZONES = house_device_count(DEV_PIR);
+
+constexpr bool house_zones_valid(unsigned index = 0)
+{
+    return index == HOUSE_DEVICE_COUNT ? true :
+           HOUSE_DEVICES[index].zone < HOUSE_ZONES && house_zones_valid(index + 1);
+}
+
+// the n'th PIR and light must both serve zone n, ZoneTable indexes them by zone
+constexpr bool house_zone_devices_ordered(DeviceKind kind, unsigned ordinal = 0)
+{
+    return ordinal == house_device_count(kind) ? true :
+           house_zone(kind, ordinal) == ordinal && house_zone_devices_ordered(kind, ordinal + 1);
+}
+
+static_assert(house_pins_unique(), "HOUSE_DEVICES uses a pin twice");
+static_assert(HOUSE_ZONES > 0, "every zone needs a PIR");
+static_assert(house_device_count(DEV_LIGHT) == HOUSE_ZONES, "every zone needs exactly one light");
+static_assert(house_zones_valid(), "a device is in a zone that has no PIR");
+static_assert(house_zone_devices_ordered(DEV_PIR) && house_zone_devices_ordered(DEV_LIGHT),
+              "list the PIRs and lights in zone order");
+static_assert(house_device_count(DEV_TEMPERATURE) == 1 && house_device_count(DEV_WATER) == 1 &&
+              house_device_count(DEV_RANGER_TRIGGER) == 1 && house_device_count(DEV_RANGER_ECHO) == 1 &&
+              house_device_count(DEV_PHONE_TX) == 1 && house_device_count(DEV_PHONE_RX) == 1,
+              "the house has exactly one of each bus device");
+static_assert(house_kind_on_pwm(DEV_BUZZER) && house_kind_on_pwm(DEV_WINDOW) && house_kind_on_pwm(DEV_GARAGE_MOTOR),
+              "buzzer and servos need PWM pins (p21 - p26)");
+static_assert(house_kind_on_analog(DEV_WATER), "the water sensor needs an analog pin (p15 - p20)");
+static_assert(pins_are_uart(house_pin(DEV_PHONE_TX), house_pin(DEV_PHONE_RX)), "the phone needs a UART pin pair");
+static_assert(house_period_us(DEV_TEMPERATURE) > DS1820_CONVERSION_US, "the DS1820 cannot be read faster than it converts");
+static_assert(house_period_us(DEV_WATER) >= ANALOGIN_MIN_US, "water sample rate is above what AnalogIn can do");
+static_assert(house_period_us(DEV_WATER) == 1000000 / WATER_SAMPLE_HZ, "WaterSampler is built for WATER_SAMPLE_HZ");
+static_assert(house_period_us(DEV_RANGER_TRIGGER) >= ECHO_RANGER_PERIOD_US, "the HC-SR04 needs 60 ms between pings");
+
+/*
+Generates the drivers of all devices of one kind, in configuration order,
+each constructed with its constant pin. DeviceBank<DigitalIn, DEV_PIR> is
+exactly an array of DigitalIn, bank[n] is the device of zone n.
+*/
+template <unsigned... I> struct DeviceIndices {};
+template <unsigned N, unsigned... I> struct MakeDeviceIndices : MakeDeviceIndices<N - 1, N - 1, I...> {};
+template <unsigned... I> struct MakeDeviceIndices<0, I...> { typedef DeviceIndices<I...> type; };
+
+template <typename Driver, DeviceKind Kind>
+class DeviceBank
+{
+    static const unsigned   N = house_device_count(Kind);
+
+    Driver  _drivers[N];
+
+    template <unsigned... I>
+    DeviceBank(DeviceIndices<I...>) : _drivers{ house_pin(Kind, I)... } {}
+
+public:
+    DeviceBank() : DeviceBank(typename MakeDeviceIndices<N>::type()) {}
+
+    static unsigned size(void) { return N; }
+    Driver&         operator[](unsigned ordinal) { return _drivers[ordinal]; }
+
+private:
+    static_assert(N > 0, "DeviceBank of a kind that is not in HOUSE_DEVICES");
+};
+
+/*
+Change-only writers for the drivers of a DeviceBank (see Actuator.h), out[n]
+writes bank[n]. Their writes count in the shared actuator counters like any
+other output's.
+*/
+template <typename Driver, DeviceKind Kind>
+class ActuatorBank
+{
+    static const unsigned   N = house_device_count(Kind);
+
+    Actuator<Driver>    _actuators[N];
+
+    template <unsigned... I>
+    ActuatorBank(DeviceBank<Driver, Kind>& bank, DeviceIndices<I...>) : _actuators{ bank[I]... } {}
+
+public:
+    ActuatorBank(DeviceBank<Driver, Kind>& bank) : ActuatorBank(bank, typename MakeDeviceIndices<N>::type()) {}
+
+    static unsigned     size(void) { return N; }
+    Actuator<Driver>&   operator[](unsigned ordinal) { return _actuators[ordinal]; }
+};
+
+/*
+Polling schedule of one device kind, the period comes from HOUSE_DEVICES.
+due() is true once per period, measured on a free running millisecond clock.
+*/
+template <DeviceKind Kind>
+class Poll
+{
+    uint32_t    _last_ms;
+
+public:
+    static const uint32_t   PERIOD_MS = house_period_us(Kind) / 1000;
+
+    Poll() : _last_ms(0) {}
+
+    bool due(uint32_t now_ms)
+    {
+        if (now_ms - _last_ms < PERIOD_MS)
+            return false;
+        _last_ms = now_ms;
+        return true;
+    }
+
+    // the device is polled every PERIOD_MS, 'ahead_ms' before that is the time to get it ready
+    bool ahead(uint32_t now_ms, uint32_t ahead_ms) const { return now_ms - _last_ms >= PERIOD_MS - ahead_ms; }
+
+private:
+    static_assert(house_period_us(Kind) >= 1000, "Poll needs a period of at least 1 ms");
+};
+#endif /* DEVICE_REGISTRY_H_ */
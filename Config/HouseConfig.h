@@ -0,0 +1,90 @@
+#ifndef HOUSE_CONFIG_H_
+#define HOUSE_CONFIG_H_
+
+#include "mbed.h"
+#include "HomeState.h"
+
+/*
+Description of the house: every device with its pin, zone and polling
+period, and the thresholds of the control rules. This is the only file to
+edit when devices are added or moved; DeviceRegistry.h checks it at compile
+time and main.cpp creates the drivers from it.
+*/
+
+enum DeviceKind {
+    DEV_PIR,                // DigitalIn, one per zone
+    DEV_LIGHT,              // DigitalOut, one per zone
+    DEV_TEMPERATURE,        // DS1820 1-Wire bus
+    DEV_WATER,              // AnalogIn
+    DEV_HEATER,             // DigitalOut
+    DEV_AIRCON,             // DigitalOut
+    DEV_WINDOW,             // Servo (PWM)
+    DEV_DOORLOCK,           // DigitalOut
+    DEV_BUZZER,             // PwmOut
+    DEV_GARAGE_MOTOR,       // Servo (PWM)
+    DEV_GARAGE_OPENING,     // DigitalOut led
+    DEV_GARAGE_CLOSING,     // DigitalOut led
+    DEV_GARAGE_DOOR,        // DigitalOut led
+    DEV_RANGER_TRIGGER,     // DigitalOut, HC-SR04 trigger
+    DEV_RANGER_ECHO,        // InterruptIn, HC-SR04 echo
+    DEV_PHONE_TX,           // UART to the phone app
+    DEV_PHONE_RX,
+    DEV_KIND_COUNT
+};
+
+struct DeviceConfig
+{
+    DeviceKind  kind;
+    PinName     pin;
+    uint8_t     zone;
+    uint32_t    period_us;  // polling or sampling period, 0: not polled
+};
+
+static constexpr DeviceConfig HOUSE_DEVICES[] = {
+    // kind                 pin     zone    period_us
+    { DEV_PIR,              p5,     0,      0       },
+    { DEV_LIGHT,            p19,    0,      0       },
+    { DEV_TEMPERATURE,      p6,     0,      2000000 },  // conversion takes 750 ms
+    { DEV_WATER,            p20,    0,      1000    },
+    { DEV_HEATER,           p7,     0,      0       },
+    { DEV_AIRCON,           p8,     0,      0       },
+    { DEV_WINDOW,           p21,    0,      0       },
+    { DEV_DOORLOCK,         p12,    0,      0       },
+    { DEV_BUZZER,           p22,    0,      0       },
+    { DEV_GARAGE_MOTOR,     p24,    0,      0       },
+    { DEV_GARAGE_OPENING,   p25,    0,      0       },
+    { DEV_GARAGE_CLOSING,   p26,    0,      0       },
+    { DEV_GARAGE_DOOR,      p27,    0,      0       },
+    { DEV_RANGER_TRIGGER,   p29,    0,      60000   },
+    { DEV_RANGER_ECHO,      p30,    0,      0       },
+    { DEV_PHONE_TX,         p9,     0,      0       },
+    { DEV_PHONE_RX,         p10,    0,      0       }
+};
+
+// Thresholds in HomeState units
+static constexpr int16_t    FIRE_TEMP = 30 * HOME_TEMP_SCALE;      // a fire is only cleared below this
+static constexpr int16_t    AIRCON_TEMP = 27 * HOME_TEMP_SCALE;
+static constexpr int16_t    HEATER_TEMP = 24 * HOME_TEMP_SCALE;
+static constexpr uint16_t   WATER_DETECTED = HOME_WATER_SCALE / 100; // 0.01 of full scale
+static constexpr int16_t    SETBACK_TEMP = 4 * HOME_TEMP_SCALE;    // comfort setpoints move out by this when nobody is expected
+
+// Timing
+static constexpr uint32_t   LIGHT_MS = 10000;           // lights stay on 10 seconds after the last motion
+static constexpr uint32_t   PRECONDITION_S = 3600;      // start heating or cooling an hour ahead
+static constexpr uint32_t   RECENT_MOTION_S = 1800;     // someone moved in the last 30 minutes, they are home
+static constexpr uint16_t   GARAGE_OBSTACLE_CM = 10;    // the garage door re-opens for anything closer
+static constexpr float      FLOOD_SAFE_S = 5;           // a flood puts the board in its safe state after this
+static constexpr uint32_t   SAFE_BEACON_WAKEUPS = 10;   // safe state: flood alert and telemetry every 10 wakeups
+static constexpr uint32_t   TEMP_QUARANTINE_MAX_MS = 10000; // the fire detector's only sensor is tried again at least this often
+
+// Time each subsystem may take in a pass of the control loop (see LoopMonitor.h)
+static constexpr uint32_t   PIR_BUDGET_US = 500;
+static constexpr uint32_t   HEATING_BUDGET_US = 15000;  // a DS1820 read takes 11.5 ms
+static constexpr uint32_t   ALARM_BUDGET_US = 500;
+static constexpr uint32_t   FLOOD_BUDGET_US = 500;
+static constexpr uint32_t   GARAGE_BUDGET_US = 500;
+static constexpr uint32_t   PHONE_BUDGET_US = 20000;    // the reply to the phone is written out at 9600 baud
+static constexpr uint32_t   OUTPUTS_BUDGET_US = 500;
+static constexpr uint32_t   PUBLISH_BUDGET_US = 500;
+static constexpr uint32_t   REPORT_BUDGET_US = 25000;   // a keyframe is written out at 9600 baud
+#endif /* HOUSE_CONFIG_H_ */
@@ -96,6 +96,7 @@
  *
  */
 #include "DS1820.h"
+#include "TraceRing.h"
 
 //#define DEBUG   1
 
@@ -285,15 +286,23 @@ void DS1820::setResolution(uint8_t res)
  *          11-bit resolution -> max conversion time = 375ms
  *          12-bit resolution -> max conversion time = 750ms
  * @param
- * @retval
+ * @retval  true:   conversion started
+ *          false:  sensor not present or no presence pulse on the bus
  */
-void DS1820::startConversion(void)
+bool DS1820::startConversion(void)
 {
     if (_present) {
-        _oneWire->reset();
+        TRACE_BEGIN(TP_DS1820_CONVERT);
+        if (!_oneWire->reset()) {
+            TRACE_END(TP_DS1820_CONVERT, 1);
+            return false;
+        }
         _oneWire->select(_addr);
         _oneWire->write_byte(0x44);  //start temperature conversion
+        TRACE_END(TP_DS1820_CONVERT, 0);
+        return true;
     }
+    return false;
 }
 
 /**
@@ -305,11 +314,8 @@ void DS1820::startConversion(void)
 float DS1820::read(void)
 {
     if (_present) {
-        _oneWire->reset();
-        _oneWire->select(_addr);
-        _oneWire->write_byte(0xBE);          // to read Scratchpad
-        for (uint8_t i = 0; i < 9; i++)     // reading scratchpad registers
-            _data[i] = _oneWire->read_byte();
+        TRACE_BEGIN(TP_DS1820_READ);
+        _oneWire->command(_addr, 0xBE, _data, 9);   // read Scratchpad
 
         // Convert the raw bytes to a 16-bit unsigned value
         uint16_t*   p_word = reinterpret_cast < uint16_t * > (&_data[0]);
@@ -343,6 +349,7 @@ float DS1820::read(void)
         // 1 sign bit, 7 integer bits, 8 fractional bits (two’s compliment
         // and the LSB of the 16-bit binary number represents 1/256th of a unit).
         *p_word = *p_word << 4;
+        TRACE_END(TP_DS1820_READ, 0);
 
         // Convert to floating point value
         return(toFloat(*p_word));
@@ -360,26 +367,31 @@ float DS1820::read(void)
  *                (It's passed as reference to floating point.)
  * @retval  error code:
  *              0 - no errors ('temp' contains the temperature measured)
- *              1 - sensor not present ('temp' is not updated)
+ *              1 - sensor not present or no presence pulse ('temp' is not updated)
  *              2 - CRC error ('temp' is not updated)
  */
 uint8_t DS1820::read(float& temp)
 {
     if (_present) {
-        _oneWire->reset();
-        _oneWire->select(_addr);
-        _oneWire->write_byte(0xBE);              // to read Scratchpad
-        for (uint8_t i = 0; i < 9; i++)         // reading scratchpad registers
-            _data[i] = _oneWire->read_byte();
+        TRACE_BEGIN(TP_DS1820_READ);
+        if (!_oneWire->command(_addr, 0xBE, _data, 9)) {    // read Scratchpad
+            TRACE_END(TP_DS1820_READ, 1);
+            return 1;                           // shorted or empty bus
+        }
 
         if (_oneWire->crc8(_data, 8) != _data[8])  // if calculated CRC does not match the stored one
         {
 #if DEBUG
             for (uint8_t i = 0; i < 9; i++)
                 printf("data[%d]=0x%.2x\r\n", i, data[i]);
+#endif
+            TRACE_END(TP_DS1820_READ, 2);
+#if ONEWIRE_CAPTURE
+            onewire_capture_freeze();           // keep the failed transaction for host/onewire_replay
 #endif
             return 2;                           // return with CRC error
         }
+        TRACE_END(TP_DS1820_READ, 0);
 
         // Convert the raw bytes to a 16bit unsigned value
         uint16_t*   p_word = reinterpret_cast < uint16_t * > (&_data[0]);
@@ -126,7 +126,7 @@ public:
     bool    begin(void);
     bool    isPresent();
     void    setResolution(uint8_t res);
-    void    startConversion(void);
+    bool    startConversion(void);
     float   read(void);
     uint8_t read(float& temp);
 };
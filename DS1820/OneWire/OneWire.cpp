@@ -114,6 +114,65 @@ sample code bearing this copyright.
 //--------------------------------------------------------------------------
 */
 #include "OneWire.h"
+#include "TraceRing.h"
+
+// SPI bus master: a slot is one 16 bit frame at 4 us per bit, MSB first
+#define SPI_HZ          250000
+#define SPI_SLOT_1      0x7FFF      // 4 us low, the device samples at 15 us, a read slot as well
+#define SPI_SLOT_0      0x0001      // 60 us low, 4 us recovery
+#define SPI_RESET       0x0000      // 8 of them: 512 us low
+#define SPI_RELEASE     0xFFFF      // 8 of them: 512 us for the presence pulse
+#define SPI_SAMPLE      (1 << 13)   // bit sampled 10 us into a read slot
+
+// Slots of a GPIO transfer
+#define SLOT_WRITE_0    0
+#define SLOT_WRITE_1    1
+#define SLOT_READ       2
+
+#if ONEWIRE_CAPTURE
+OneWireCapture  onewire_capture = { ONEWIRE_CAPTURE_MAGIC, ONEWIRE_CAPTURE_SLOTS };
+
+/**
+ * @brief   Adds a slot to the capture ring.
+ * @note    Does nothing while the capture is frozen.
+ * @param   kind:   ONEWIRE_SLOT_xxx
+ * @param   value:  presence, bit written or bit read
+ * @param   us:     timing of the slot
+ * @retval
+ */
+void onewire_capture_slot(uint8_t kind, uint8_t value, uint32_t us)
+{
+    if (onewire_capture.frozen)
+        return;
+    onewire_capture.slot[onewire_capture.head] = ONEWIRE_SLOT(kind, value, us);
+    onewire_capture.head = (onewire_capture.head + 1) % ONEWIRE_CAPTURE_SLOTS;
+    onewire_capture.written++;
+}
+
+/**
+ * @brief   Stops recording, the ring keeps the slots up to now.
+ * @note
+ * @param
+ * @retval
+ */
+void onewire_capture_freeze(void)
+{
+    onewire_capture.frozen = 1;
+}
+
+/**
+ * @brief   Empties the ring and records again.
+ * @note
+ * @param
+ * @retval
+ */
+void onewire_capture_resume(void)
+{
+    onewire_capture.head = 0;
+    onewire_capture.written = 0;
+    onewire_capture.frozen = 0;
+}
+#endif
 
 /**
  * @brief   Constructs a OneWire object.
@@ -126,6 +185,7 @@ sample code bearing this copyright.
 OneWire::OneWire(PinName gpioPin, int samplePoint_us /*= 13*/) :
     _gpio(new DigitalInOut(gpioPin)),
     _uart(NULL),
+    _spi(NULL),
     _samplePoint_us(samplePoint_us)
 {
     Timer   timer;
@@ -183,8 +243,49 @@ OneWire::OneWire(PinName gpioPin, int samplePoint_us /*= 13*/) :
  */
 OneWire::OneWire(PinName txPin, PinName rxPin, int baud /*=115200*/) :
     _gpio(NULL),
-    _uart(new UART(txPin, rxPin, baud))
+    _uart(new UART(txPin, rxPin, baud)),
+    _spi(NULL)
+{
+#if ONEWIRE_SEARCH
+    reset_search();
+#endif
+}
+
+/**
+ * @brief   Constructs a OneWire object.
+ * @note    SPI is used to implement a 1-Wire Bus Master, the peripheral clocks out
+ *          the slots as bit patterns and samples the bus on MISO, so no slot is timed
+ *          by the CPU and an interrupt can only lengthen the recovery between slots.
+ *          Like with the UART a 470 Ohm resistor shall be tied between the MOSI pin
+ *          and the 1-wire data bus/line, the MISO pin is the 1-wire data bus/line.
+ *          SCLK is not connected but the pin is taken by the SPI.
+ *
+ *           ----------------
+ *          |                |   ----------------------->  +3.3V
+ *          |   MBED BOARD   |  |
+ *          |                |  |   ------
+ *          |           3.3V |--o--| 4.7k |-------
+ *          |                |      ------        |
+ *          |                |      ------        |
+ *          |       SPI MOSI |-----|  470 |---    |
+ *          |                |      ------    |   |
+ *          |                |                |   |
+ *          |       SPI MISO |----------------o---o----->  1-wire bus/line
+ *          |                |
+ *          |            GND |-------------------------->  GND
+ *          |                |
+ *           ----------------
+ *
+ * @param
+ * @retval
+ */
+OneWire::OneWire(PinName mosiPin, PinName misoPin, PinName sclkPin) :
+    _gpio(NULL),
+    _uart(NULL),
+    _spi(new SPI(mosiPin, misoPin, sclkPin))
 {
+    _spi->format(16, 0);
+    _spi->frequency(SPI_HZ);
 #if ONEWIRE_SEARCH
     reset_search();
 #endif
@@ -196,6 +297,8 @@ OneWire::~OneWire()
         delete _gpio;
     if (_uart != NULL)
         delete _uart;
+    if (_spi != NULL)
+        delete _spi;
 }
 
 /**
@@ -209,15 +312,29 @@ uint8_t OneWire::reset(void)
 {
     uint8_t present;
 
+    TRACE_BEGIN(TP_ONEWIRE_RESET);
     if (_gpio != NULL) {
         OUTPUT();
         WRITE(0);           // pull down the 1-wire bus do create reset pulse
         WAIT_US(500);       // wait at least 480 us
         INPUT();            // release the 1-wire bus and go into receive mode
+        CAPTURE_MARK(t);
         WAIT_US(90);        // DS1820 waits about 15 to 60 us and generates a 60 to 240 us presence pulse
         present = !READ();  // read the presence pulse
+        CAPTURE(ONEWIRE_SLOT_RESET, present, t);
         WAIT_US(420);
     }
+    else if (_spi != NULL) {
+        uint16_t    early, late;
+
+        for (uint8_t i = 0; i < 8; i++)
+            _spi->write(SPI_RESET);
+        early = _spi->write(SPI_RELEASE);   // the first bit may still see the bus rising
+        late = _spi->write(SPI_RELEASE);
+        for (uint8_t i = 2; i < 8; i++)
+            _spi->write(SPI_RELEASE);
+        present = (early & 0x7FFF) != 0x7FFF || late != SPI_RELEASE;
+    }
     else {
         _uart->baud(9600);
         #if (MBED_MAJOR_VERSION > 5)
@@ -225,6 +342,8 @@ uint8_t OneWire::reset(void)
         #else
             wait_ms(10);
         #endif
+        while (_uart->readable())
+            _uart->_base_getc();    // echoes of the write slots, nobody reads them
         _uart->_base_putc(0xF0);
         present = _uart->_base_getc();
         wait_us(420);
@@ -237,6 +356,7 @@ uint8_t OneWire::reset(void)
         present = (present >= 0x10);
     }
 
+    TRACE_END(TP_ONEWIRE_RESET, present);
     return present;
 }
 
@@ -251,11 +371,16 @@ void OneWire::write_bit(uint8_t v)
     if (v & 1) {
         if (_gpio != NULL) {
             OUTPUT();
+            CAPTURE_MARK(t);
             WRITE(0);   // drive output low
             WAIT_US(1);
             WRITE(1);   // drive output high
+            CAPTURE(ONEWIRE_SLOT_WRITE, 1, t);
             WAIT_US(60);
         }
+        else if (_spi != NULL) {
+            _spi->write(SPI_SLOT_1);
+        }
         else {
             _uart->_base_putc(0xFF);
         }
@@ -263,11 +388,16 @@ void OneWire::write_bit(uint8_t v)
     else {
         if (_gpio != NULL) {
             OUTPUT();
+            CAPTURE_MARK(t);
             WRITE(0);   // drive output low
             WAIT_US(60);
             WRITE(1);   // drive output high
+            CAPTURE(ONEWIRE_SLOT_WRITE, 0, t);
             WAIT_US(1);
         }
+        else if (_spi != NULL) {
+            _spi->write(SPI_SLOT_0);
+        }
         else {
             _uart->_base_putc(0x00);
         }
@@ -286,12 +416,17 @@ uint8_t OneWire::read_bit(void)
 
     if (_gpio != NULL) {
         OUTPUT();
+        CAPTURE_MARK(t);
         WRITE(0);
         INPUT();
         wait_us(_samplePoint_us - _outToInTransition_us);   // wait till sample point
         r = READ();
+        CAPTURE(ONEWIRE_SLOT_READ, r, t);
         WAIT_US(55);
     }
+    else if (_spi != NULL) {
+        r = (_spi->write(SPI_SLOT_1) & SPI_SAMPLE) != 0;
+    }
     else {
         _uart->_base_putc(0xFF);
         do {
@@ -319,6 +454,11 @@ void OneWire::write_byte(uint8_t v, uint8_t power /* = 0 */ )
 {
     uint8_t bitMask;
 
+    if (_spi != NULL) {
+        spi_byte(v);
+        return;
+    }
+
     for (bitMask = 0x01; bitMask; bitMask <<= 1)
         write_bit((bitMask & v) ? 1 : 0);
     if ((!power) && (_gpio != NULL))
@@ -350,6 +490,9 @@ uint8_t OneWire::read_byte()
     uint8_t bitMask;
     uint8_t r = 0;
 
+    if (_spi != NULL)
+        return spi_byte(0xFF);
+
     for (bitMask = 0x01; bitMask; bitMask <<= 1) {
         if (read_bit())
             r |= bitMask;
@@ -358,6 +501,148 @@ uint8_t OneWire::read_byte()
     return r;
 }
 
+/**
+ * @brief   Runs the 8 slots of a byte on the SPI bus master.
+ * @note    Reading is writing 1s, the device pulls the bus low for its 0s.
+ * @param   v: byte to write, 0xFF to read
+ * @retval  the byte seen on the bus
+ */
+uint8_t OneWire::spi_byte(uint8_t v)
+{
+    uint8_t r = 0;
+
+    for (uint8_t i = 0; i < 8; i++)
+        if (_spi->write((v >> i) & 1 ? SPI_SLOT_1 : SPI_SLOT_0) & SPI_SAMPLE)
+            r |= 1 << i;
+    return r;
+}
+
+/**
+ * @brief   Runs a slot of a GPIO transfer.
+ * @note    The bus is driven high on entry and left so. Only the part of a slot
+ *          the device times is run with interrupts off: the short low pulse of
+ *          a 1 and the low pulse up to the sample point of a read. A 0 is
+ *          left open, an interrupt makes its low pulse longer but it stays a 0
+ *          up to 120 us.
+ * @param   slot: SLOT_xxx
+ * @retval  the bit read, 0 for writes
+ */
+uint8_t OneWire::gpio_slot(uint8_t slot)
+{
+    uint32_t    primask = __get_PRIMASK();
+    uint8_t     r = 0;
+
+    if (slot == SLOT_WRITE_0) {
+        CAPTURE_MARK(t);
+        WRITE(0);
+        WAIT_US(60);
+        WRITE(1);
+        CAPTURE(ONEWIRE_SLOT_WRITE, 0, t);
+        WAIT_US(1);
+    }
+    else if (slot == SLOT_WRITE_1) {
+        __disable_irq();
+        CAPTURE_MARK(t);
+        WRITE(0);
+        WAIT_US(1);
+        WRITE(1);
+        CAPTURE(ONEWIRE_SLOT_WRITE, 1, t);
+        __set_PRIMASK(primask);
+        WAIT_US(60);
+    }
+    else {
+        __disable_irq();
+        CAPTURE_MARK(t);
+        WRITE(0);
+        INPUT();
+        wait_us(_samplePoint_us - _outToInTransition_us);   // wait till sample point
+        r = READ();
+        CAPTURE(ONEWIRE_SLOT_READ, r, t);
+        __set_PRIMASK(primask);
+        WAIT_US(55);
+        WRITE(1);   // the device let go, drive the bus high again
+        OUTPUT();
+    }
+    return r;
+}
+
+/**
+ * @brief   Writes and reads a block of bytes.
+ * @note    See OneWire.h.
+ * @param   tx:     bytes to write, NULL to read
+ * @param   rx:     filled with the bytes seen on the bus, NULL to write only
+ * @param   count:  number of bytes
+ * @retval
+ */
+void OneWire::transfer(const uint8_t* tx, uint8_t* rx, uint16_t count)
+{
+    for (uint16_t i = 0; i < count; i++) {
+        uint8_t v = tx != NULL ? tx[i] : 0xFF;
+        uint8_t r = 0;
+
+        if (_gpio != NULL) {
+            uint8_t slots[8];
+
+            for (uint8_t b = 0; b < 8; b++)
+                slots[b] = !((v >> b) & 1) ? SLOT_WRITE_0 : rx != NULL ? SLOT_READ : SLOT_WRITE_1;
+            if (i == 0) {
+                WRITE(1);
+                OUTPUT();
+            }
+            for (uint8_t b = 0; b < 8; b++)
+                r |= gpio_slot(slots[b]) << b;
+        }
+        else if (_spi != NULL)
+            r = spi_byte(v);
+        else {
+            for (uint8_t b = 0; b < 8; b++) {
+                if (!((v >> b) & 1))
+                    write_bit(0);
+                else if (rx == NULL)
+                    write_bit(1);
+                else
+                    r |= read_bit() << b;
+            }
+        }
+
+        if (rx != NULL)
+            rx[i] = r;
+    }
+    if (_gpio != NULL)
+        INPUT();
+}
+
+/**
+ * @brief   Runs a command on a device and reads its answer.
+ * @note    See OneWire.h.
+ * @param   rom:        device to select, NULL to skip ROM
+ * @param   command:    function command
+ * @param   rx:         filled with the answer
+ * @param   count:      bytes of the answer
+ * @retval  1 if a device asserted a presence pulse, 0 otherwise.
+ */
+uint8_t OneWire::command(const uint8_t* rom, uint8_t command, uint8_t* rx, uint16_t count)
+{
+    uint8_t tx[10];
+    uint8_t n = 0;
+
+    if (rom != NULL) {
+        tx[n++] = 0x55;     // Choose ROM
+        for (uint8_t i = 0; i < 8; i++)
+            tx[n++] = rom[i];
+    }
+    else
+        tx[n++] = 0xCC;     // Skip ROM
+    tx[n++] = command;
+
+    if (!reset())
+        return 0;
+    transfer(tx, NULL, n);
+    if (count > 0)
+        transfer(NULL, rx, count);
+    return 1;
+}
+
 /**
  * @brief   Reads bytes.
  * @note
@@ -580,6 +865,96 @@ uint8_t OneWire::search(uint8_t* newAddr)
         newAddr[i] = ROM_NO[i];
     return search_result;
 }
+
+/**
+ * @brief   Finds all the devices, or the devices of a family, in one go.
+ * @note    A pass of the search has to start from the root, the devices only
+            listen after a reset, but what the last passes found is not read
+            again: ROM_NO holds the path of the last device, 'pending' the
+            discrepancies on it whose 1 branch is left. A pass follows ROM_NO
+            down to the deepest pending discrepancy and takes its 1 branch,
+            the bits below it are the cached prefix and only checked. The
+            search ends when nothing is pending, with no extra pass.
+            Families are searched from target_search(), the family bits are
+            never a discrepancy so the search does not leave the family.
+            A device that drops off while its path is followed ends the pass
+            early and the discrepancies below the drop are forgotten.
+ * @param   roms:           filled with the ROMs found, in search order
+ * @param   max:            size of 'roms'
+ * @param   family_code:    family to look for, 0 for all the devices
+ * @retval  number of ROMs found
+ */
+uint16_t OneWire::search_all(uint8_t (*roms)[8], uint16_t max, uint8_t family_code /*= 0*/)
+{
+    uint8_t     pending[8] = { 0 };                 // same layout as ROM_NO
+    uint8_t     first = family_code ? 8 : 0;        // bits fixed by the family
+    uint8_t     known = first;                      // bits below this are followed from ROM_NO
+    uint16_t    found = 0;
+
+    if (family_code)
+        target_search(family_code);
+    else
+        reset_search();
+
+    while (found < max && reset()) {
+        uint8_t id_bit_number;
+
+        write_byte(0xF0);
+        for (id_bit_number = 0; id_bit_number < 64; id_bit_number++) {
+            uint8_t rom_byte_number = id_bit_number >> 3;
+            uint8_t rom_byte_mask = 1 << (id_bit_number & 7);
+            uint8_t id_bit = read_bit();
+            uint8_t cmp_id_bit = read_bit();
+            uint8_t search_direction;
+
+            if (id_bit && cmp_id_bit)
+                break;  // no device on this path
+            if (id_bit_number < known) {
+                search_direction = (ROM_NO[rom_byte_number] & rom_byte_mask) != 0;
+                if (id_bit != cmp_id_bit && id_bit != search_direction)
+                    break;  // the devices of the cached path dropped off
+            }
+            else if (id_bit != cmp_id_bit)
+                search_direction = id_bit;
+            else {
+                // a new discrepancy, the 0 branch first
+                search_direction = 0;
+                pending[rom_byte_number] |= rom_byte_mask;
+            }
+
+            if (search_direction)
+                ROM_NO[rom_byte_number] |= rom_byte_mask;
+            else
+                ROM_NO[rom_byte_number] &= ~rom_byte_mask;
+            write_bit(search_direction);
+        }
+
+        if (id_bit_number == 64) {
+            for (uint8_t i = 0; i < 8; i++)
+                roms[found][i] = ROM_NO[i];
+            found++;
+        }
+        else {
+            // the branches below the failed bit are gone with it
+            for (uint8_t i = id_bit_number; i < 64; i++)
+                pending[i >> 3] &= ~(1 << (i & 7));
+        }
+
+        // resume from the deepest pending discrepancy
+        int8_t  branch = 63;
+
+        while (branch >= first && !(pending[branch >> 3] & (1 << (branch & 7))))
+            branch--;
+        if (branch < first)
+            break;
+        pending[branch >> 3] &= ~(1 << (branch & 7));
+        ROM_NO[branch >> 3] |= 1 << (branch & 7);
+        known = branch + 1;
+    }
+
+    reset_search();
+    return found;
+}
 #endif
 //
 #if ONEWIRE_CRC
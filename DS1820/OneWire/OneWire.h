@@ -60,6 +60,22 @@ void init_soft_delay( void ) {
 #define ONEWIRE_CRC 1
 #endif
 
+// You can record the slots of the bus into a RAM ring by defining this
+// to 1, see OneWireCapture.h. GPIO bus masters only.
+#ifndef ONEWIRE_CAPTURE
+#define ONEWIRE_CAPTURE 0
+#endif
+
+#include "OneWireCapture.h"
+
+#if ONEWIRE_CAPTURE
+    #define CAPTURE_MARK(t)                 uint32_t t = us_ticker_read()
+    #define CAPTURE(kind, value, t)         onewire_capture_slot((kind), (value), us_ticker_read() - (t))
+#else
+    #define CAPTURE_MARK(t)
+    #define CAPTURE(kind, value, t)
+#endif
+
 class UART :
     public  SerialBase,
     private NonCopyable<UART>
@@ -76,6 +92,7 @@ class OneWire
 {
     DigitalInOut*   _gpio;
     UART*           _uart;
+    SPI*            _spi;
 
     int _samplePoint_us;
     int _outToInTransition_us;
@@ -93,6 +110,7 @@ public:
     // Constructors
     OneWire(PinName gpioPin, int samplePoint_us = 13);          // GPIO
     OneWire(PinName txPin, PinName rxPin, int baud = 115200);   // UART
+    OneWire(PinName mosiPin, PinName misoPin, PinName sclkPin); // SPI
 
     // Destructor
     ~OneWire();
@@ -128,6 +146,25 @@ public:
     // Read a bit.
     uint8_t read_bit(void);
 
+    // Write 'count' bytes from 'tx' and store the bytes seen on the bus in
+    // 'rx'. A 1 bit of 'tx' is a read slot, so reading is writing 0xFF:
+    // 'tx' NULL only reads, 'rx' NULL only writes. On GPIO the slots of a
+    // byte are worked out before it starts, each slot runs with interrupts
+    // off for the part that is timed and the bus stays driven between the
+    // bytes, it is released at the end.
+    void transfer(const uint8_t* tx, uint8_t* rx, uint16_t count);
+
+    // Reset, select 'rom' (skip ROM when NULL), send 'command' and read
+    // 'count' bytes into 'rx', in two transfers. Returns 1 if a device
+    // asserted a presence pulse, nothing else is done otherwise.
+    uint8_t command(const uint8_t* rom, uint8_t command, uint8_t* rx, uint16_t count);
+
+private:
+    uint8_t spi_byte(uint8_t v);
+    uint8_t gpio_slot(uint8_t slot);
+
+public:
+
     // Stop forcing power onto the bus. You only need to do this if
     // you used the 'power' flag to write() or used a write_bit() call
     // and aren't about to do another read or write. You would rather
@@ -150,6 +187,13 @@ public:
     // get garbage.  The order is deterministic. You will always get
     // the same devices in the same order.
     uint8_t search(uint8_t *newAddr);
+
+    // Look for all the devices, or only those of 'family_code' when it is
+    // not 0, in one go. The discrepancies met on the way are kept, so each
+    // pass goes straight down the known part of its path and there is no
+    // pass past the last device of the family. Fills up to 'max' ROMs in
+    // search order and returns how many. Leaves the search state reset.
+    uint16_t search_all(uint8_t (*roms)[8], uint16_t max, uint8_t family_code = 0);
 #endif
 
 #if ONEWIRE_CRC
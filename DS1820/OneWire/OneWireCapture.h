@@ -0,0 +1,63 @@
+#ifndef OneWireCapture_h
+#define OneWireCapture_h
+
+#include <stdint.h>
+
+// Capture of the slots run on a 1-Wire bus, for finding intermittent errors.
+//
+// With ONEWIRE_CAPTURE defined to 1 (see OneWire.h) every reset, write and
+// read slot of the GPIO bus master goes into a ring in RAM, 2 bytes each:
+//
+//     bits 15..14  kind (ONEWIRE_SLOT_xxx)
+//     bit  13      value: presence pulse seen, bit written, bit read
+//     bits 12..0   timing in us, 8191 at most:
+//                  reset: release of the bus to the presence sample
+//                  write: time the bus was held low
+//                  read:  start of the slot to the sample
+//
+// The timing is where the interrupts show: a write 1 held low past 15 us
+// is read as a 0 by the device, a read sampled late sees the released bus.
+//
+// A CRC error of a DS1820 freezes the ring so the transaction that failed
+// stays in it, onewire_capture_resume() starts recording again. The
+// capture file is the OneWireCapture structure as it is in RAM, e.g. from
+// gdb: dump binary value capture.owc onewire_capture
+// host/onewire_replay replays capture files on Linux.
+
+#define ONEWIRE_CAPTURE_MAGIC   0x3143574F  // "OWC1"
+
+#ifndef ONEWIRE_CAPTURE_SLOTS
+#define ONEWIRE_CAPTURE_SLOTS   1024        // 2 KB, the last four DS1820 reads or so
+#endif
+
+enum OneWireSlotKind {
+    ONEWIRE_SLOT_WRITE  = 0,
+    ONEWIRE_SLOT_READ   = 1,
+    ONEWIRE_SLOT_RESET  = 2
+};
+
+#define ONEWIRE_SLOT(kind, value, us)   (uint16_t)(((kind) << 14) | (((value) & 1) << 13) | ((us) > 0x1FFF ? 0x1FFF : (us)))
+#define ONEWIRE_SLOT_KIND(slot)         ((slot) >> 14)
+#define ONEWIRE_SLOT_VALUE(slot)        (((slot) >> 13) & 1)
+#define ONEWIRE_SLOT_US(slot)           ((slot) & 0x1FFF)
+
+struct OneWireCapture
+{
+    uint32_t    magic;
+    uint16_t    slots;          // size of the ring, ONEWIRE_CAPTURE_SLOTS of the build
+    uint16_t    head;           // next slot written
+    uint32_t    written;        // slots since the start, the ring holds the last 'slots' of them
+    uint8_t     frozen;
+    uint8_t     reserved[3];
+    uint16_t    slot[ONEWIRE_CAPTURE_SLOTS];
+};
+
+#if ONEWIRE_CAPTURE
+extern OneWireCapture   onewire_capture;
+
+void    onewire_capture_slot(uint8_t kind, uint8_t value, uint32_t us);
+void    onewire_capture_freeze(void);
+void    onewire_capture_resume(void);
+#endif
+
+#endif
@@ -0,0 +1,121 @@
+#include "FireDetector.h"
+
+/**
+ * @brief   Constructs the detector.
+ * @note
+ * @param   sensors:            number of sensors, at most FIRE_MAX_SENSORS
+ * @param   absolute_centi:     absolute threshold, 1/100 degC
+ * @param   rate_centi_per_min: rate-of-rise threshold, 1/100 degC per minute
+ * @param   tau_ms:             time constant of the rate average
+ * @retval
+ */
+FireDetector::FireDetector(uint8_t sensors, int16_t absolute_centi /*= FIRE_ABSOLUTE*/,
+                           int16_t rate_centi_per_min /*= FIRE_RATE*/, uint32_t tau_ms /*= FIRE_TAU_MS*/) :
+    _count(sensors > FIRE_MAX_SENSORS ? FIRE_MAX_SENSORS : sensors),
+    _absolute(absolute_centi),
+    _rate(rate_centi_per_min),
+    _tau_ms(tau_ms),
+    _alarms(0)
+{
+    reset();
+}
+
+/**
+ * @brief   Forgets all readings and clears the alarm.
+ * @note
+ * @param
+ * @retval
+ */
+void FireDetector::reset(void)
+{
+    for (uint8_t i = 0; i < FIRE_MAX_SENSORS; i++) {
+        _channels[i].temp = 0;
+        _channels[i].rate = 0;
+        _channels[i].baseline = 0;
+        _channels[i].last_ms = 0;
+        _channels[i].valid = false;
+    }
+
+    _fire = false;
+    _cause = FIRE_CAUSE_NONE;
+    _sensor = 0;
+}
+
+/**
+ * @brief   Checks all sensors against the thresholds.
+ * @note
+ * @param   sensor: set to the sensor that caused the alarm
+ * @retval  Cause of the alarm, FIRE_CAUSE_NONE if there is none
+ */
+FireCause FireDetector::evaluate(uint8_t& sensor) const
+{
+    uint8_t rising = 0;
+    int32_t full = (int32_t)_rate << 8;
+
+    for (uint8_t i = 0; i < _count; i++) {
+        const Channel&  ch = _channels[i];
+
+        if (!ch.valid)
+            continue;
+        if (ch.temp >= _absolute) {
+            sensor = i;
+            return FIRE_CAUSE_ABSOLUTE;
+        }
+        if (ch.rate >= full) {
+            sensor = i;
+            return FIRE_CAUSE_RATE;
+        }
+        if (((int32_t)ch.temp << 8) - ch.baseline >= ((int32_t)FIRE_RISE << 8)) {
+            sensor = i;
+            return FIRE_CAUSE_RISE;
+        }
+        if (ch.rate >= full / 2 && rising++ == 0)
+            sensor = i;
+    }
+
+    return rising >= FIRE_CORRELATED ? FIRE_CAUSE_CORRELATED : FIRE_CAUSE_NONE;
+}
+
+/**
+ * @brief   Adds a reading of one sensor.
+ * @note    rate += (slope - rate) * dt / (tau + dt), a first order average
+ *          that stays correct when readings are late or missing, the
+ *          baseline is averaged the same way.
+ * @param   sensor:     index of the sensor
+ * @param   temp_centi: temperature, 1/100 degC
+ * @param   now_ms:     time of the reading
+ * @retval  true when this reading raised the alarm
+ */
+bool FireDetector::add(uint8_t sensor, int16_t temp_centi, uint32_t now_ms)
+{
+    if (sensor >= _count)
+        return false;
+
+    Channel&    ch = _channels[sensor];
+    uint32_t    dt = now_ms - ch.last_ms;
+
+    if (ch.valid && dt) {
+        int32_t slope = (int32_t)(((int64_t)(temp_centi - ch.temp) * 60000 << 8) / dt);
+
+        ch.rate += (int32_t)(((int64_t)(slope - ch.rate) * dt) / (_tau_ms + dt));
+        ch.baseline += (int32_t)(((int64_t)(((int32_t)temp_centi << 8) - ch.baseline) * dt) / (FIRE_BASELINE_MS + dt));
+    }
+    else
+        ch.baseline = (int32_t)temp_centi << 8;
+    ch.temp = temp_centi;
+    ch.last_ms = now_ms;
+    ch.valid = true;
+
+    uint8_t     which = 0;
+    FireCause   cause = evaluate(which);
+    bool        raised = (cause != FIRE_CAUSE_NONE) && !_fire;
+
+    if (raised) {
+        _cause = cause;
+        _sensor = which;
+        _alarms++;
+    }
+    _fire = (cause != FIRE_CAUSE_NONE);
+
+    return raised;
+}
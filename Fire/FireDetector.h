@@ -0,0 +1,73 @@
+#ifndef FIRE_DETECTOR_H_
+#define FIRE_DETECTOR_H_
+
+#include <stdint.h>
+
+#define FIRE_MAX_SENSORS    8
+#define FIRE_ABSOLUTE       5700    // 1/100 degC, fixed temperature heat detectors trip at 57 degC
+#define FIRE_RATE           800     // 1/100 degC per minute, rate-of-rise detectors trip at ~8 degC/min
+#define FIRE_TAU_MS         20000   // time constant of the rate EWMA
+#define FIRE_RISE           1000    // 1/100 degC above the room's own baseline
+#define FIRE_BASELINE_MS    1800000 // time constant of the baseline EWMA
+#define FIRE_CORRELATED     2       // sensors rising at half FIRE_RATE that together raise the alarm
+
+enum FireCause {
+    FIRE_CAUSE_NONE         = 0,
+    FIRE_CAUSE_ABSOLUTE     = 1,    // a sensor is above the absolute threshold
+    FIRE_CAUSE_RATE         = 2,    // a sensor rises faster than the rate threshold
+    FIRE_CAUSE_CORRELATED   = 3,    // several sensors rise at half the rate threshold
+    FIRE_CAUSE_RISE         = 4     // a sensor is far above its slow baseline
+};
+
+/**
+ * Heat based fire detector over several temperature sensors.
+ *
+ * Every sensor keeps its last reading, an exponentially weighted rate of
+ * rise and a slow baseline, updated incrementally on each reading whatever
+ * the interval between readings, so memory is O(1) per sensor and nothing
+ * is buffered. A fire is declared when any sensor is above the absolute
+ * threshold, rises faster than the rate threshold, is FIRE_RISE above its
+ * baseline, or when FIRE_CORRELATED sensors in different rooms rise at half
+ * the rate threshold at the same time. A hot afternoon warms the house by a
+ * few degrees per hour, which the baseline follows, and never gets near the
+ * rate thresholds.
+ *
+ * Free of mbed dependencies.
+ */
+class FireDetector
+{
+    struct Channel
+    {
+        int16_t     temp;       // 1/100 degC
+        int32_t     rate;       // 1/100 degC per minute, Q8
+        int32_t     baseline;   // 1/100 degC, Q8
+        uint32_t    last_ms;
+        bool        valid;
+    };
+
+    Channel     _channels[FIRE_MAX_SENSORS];
+    uint8_t     _count;
+    int16_t     _absolute;
+    int16_t     _rate;
+    uint32_t    _tau_ms;
+    bool        _fire;
+    FireCause   _cause;
+    uint8_t     _sensor;
+    uint32_t    _alarms;
+
+    FireCause   evaluate(uint8_t& sensor) const;
+
+public:
+    FireDetector(uint8_t sensors, int16_t absolute_centi = FIRE_ABSOLUTE,
+                 int16_t rate_centi_per_min = FIRE_RATE, uint32_t tau_ms = FIRE_TAU_MS);
+
+    bool        add(uint8_t sensor, int16_t temp_centi, uint32_t now_ms);
+    void        reset(void);
+
+    bool        fire(void) const { return _fire; }
+    FireCause   cause(void) const { return _cause; }
+    uint8_t     sensor(void) const { return _sensor; }
+    int16_t     rate(uint8_t sensor) const { return (int16_t)(_channels[sensor].rate >> 8); }
+    uint32_t    alarms(void) const { return _alarms; }
+};
+#endif /* FIRE_DETECTOR_H_ */
@@ -0,0 +1,254 @@
+#include "Framing.h"
+
+/**
+ * @brief   Updates a CRC-16/CCITT with one byte.
+ * @note    Bitwise implementation, frames are a few tens of bytes long
+ *          so a 512 byte lookup table does not pay off here.
+ * @param   crc:    CRC accumulated so far
+ * @param   b:      next byte
+ * @retval  Updated CRC
+ */
+uint16_t crc16_ccitt_update(uint16_t crc, uint8_t b)
+{
+    crc ^= (uint16_t)b << 8;
+    for (uint8_t i = 0; i < 8; i++)
+        crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    return crc;
+}
+
+/**
+ * @brief   Computes a CRC-16/CCITT over a buffer.
+ * @note
+ * @param   data:   bytes to checksum
+ * @param   len:    number of bytes
+ * @param   crc:    starting value (optional)
+ * @retval  CRC-16
+ */
+uint16_t crc16_ccitt(const uint8_t* data, size_t len, uint16_t crc /*= 0xFFFF*/)
+{
+    while (len--)
+        crc = crc16_ccitt_update(crc, *data++);
+    return crc;
+}
+
+/**
+ * @brief   Constructs a frame encoder writing into 'buf'.
+ * @note    Size the buffer with FRAMING_MAX_ENCODED(max payload).
+ * @param   buf:    output buffer
+ * @param   size:   output buffer size in bytes
+ * @retval
+ */
+CobsEncoder::CobsEncoder(uint8_t* buf, size_t size) :
+    _buf(buf),
+    _size(size)
+{
+    begin();
+}
+
+/**
+ * @brief   Starts a new frame, discarding anything put() so far.
+ * @note
+ * @param
+ * @retval
+ */
+void CobsEncoder::begin(void)
+{
+    _codeIdx = 0;
+    _len = 1;           // byte 0 is reserved for the first COBS code
+    _code = 1;
+    _crc = 0xFFFF;
+    _overflow = (_size < 2);
+}
+
+/**
+ * @brief   Stuffs one byte into the output buffer.
+ * @note    Zeros end the current COBS block, a block is also closed
+ *          after 254 non-zero bytes.
+ * @param
+ * @retval
+ */
+void CobsEncoder::stuff(uint8_t b)
+{
+    if (_overflow)
+        return;
+
+    if (_len >= _size) {
+        _overflow = true;
+        return;
+    }
+
+    if (b == 0) {
+        _buf[_codeIdx] = _code;
+        _codeIdx = _len++;
+        _code = 1;
+        return;
+    }
+
+    _buf[_len++] = b;
+    if (++_code == 0xFF) {
+        if (_len >= _size) {
+            _overflow = true;
+            return;
+        }
+        _buf[_codeIdx] = _code;
+        _codeIdx = _len++;
+        _code = 1;
+    }
+}
+
+/**
+ * @brief   Appends a payload byte.
+ * @note
+ * @param
+ * @retval
+ */
+void CobsEncoder::put(uint8_t b)
+{
+    _crc = crc16_ccitt_update(_crc, b);
+    stuff(b);
+}
+
+/**
+ * @brief   Appends a 16-bit value, little-endian.
+ * @note
+ * @param
+ * @retval
+ */
+void CobsEncoder::put16(uint16_t v)
+{
+    put(v & 0xFF);
+    put(v >> 8);
+}
+
+/**
+ * @brief   Appends a 32-bit value, little-endian.
+ * @note
+ * @param
+ * @retval
+ */
+void CobsEncoder::put32(uint32_t v)
+{
+    put16(v & 0xFFFF);
+    put16(v >> 16);
+}
+
+/**
+ * @brief   Appends a block of payload bytes.
+ * @note
+ * @param
+ * @retval
+ */
+void CobsEncoder::put(const uint8_t* data, size_t len)
+{
+    while (len--)
+        put(*data++);
+}
+
+/**
+ * @brief   Closes the frame.
+ * @note    Appends the CRC, the last COBS code and the delimiter.
+ * @param
+ * @retval  Number of bytes to transmit from data(), 0 if the frame did not fit.
+ */
+size_t CobsEncoder::finish(void)
+{
+    uint16_t    crc = _crc;
+
+    stuff(crc & 0xFF);
+    stuff(crc >> 8);
+    if (_overflow || (_len >= _size))
+        return 0;
+
+    _buf[_codeIdx] = _code;
+    _buf[_len++] = FRAMING_DELIMITER;
+    return _len;
+}
+
+/**
+ * @brief   Constructs a frame decoder writing the unstuffed payload into 'buf'.
+ * @note    The buffer must hold the largest expected payload plus 2 CRC bytes.
+ * @param
+ * @retval
+ */
+CobsDecoder::CobsDecoder(uint8_t* buf, size_t size) :
+    _buf(buf),
+    _size(size)
+{
+    reset();
+}
+
+/**
+ * @brief   Drops any partially received frame.
+ * @note
+ * @param
+ * @retval
+ */
+void CobsDecoder::reset(void)
+{
+    _len = 0;
+    _left = 0;
+    _pendingZero = false;
+    _overflow = false;
+}
+
+/**
+ * @brief   Appends an unstuffed byte.
+ * @note
+ * @param
+ * @retval  false on overflow
+ */
+bool CobsDecoder::append(uint8_t b)
+{
+    if (_len >= _size) {
+        _overflow = true;
+        return false;
+    }
+
+    _buf[_len++] = b;
+    return true;
+}
+
+/**
+ * @brief   Feeds one received byte into the decoder.
+ * @note    Safe to call from an interrupt handler.
+ * @param   b:  received byte
+ * @retval  payload length (> 0) when a valid frame was completed,
+ *          FRAME_PENDING while receiving,
+ *          FRAME_ERROR when a damaged frame was dropped
+ */
+int CobsDecoder::feed(uint8_t b)
+{
+    if (b == FRAMING_DELIMITER) {
+        int result = FRAME_ERROR;
+
+        if (_len == 0 && _left == 0 && !_overflow)
+            result = FRAME_PENDING;     // back to back delimiters, nothing to report
+        else
+        if (!_overflow && _left == 0 && _len > 2 &&
+            crc16_ccitt(_buf, _len - 2) == (uint16_t)(_buf[_len - 2] | (_buf[_len - 1] << 8)))
+            result = (int)_len - 2;
+
+        _len = 0;
+        _left = 0;
+        _pendingZero = false;
+        _overflow = false;
+        return result;
+    }
+
+    if (_overflow)
+        return FRAME_PENDING;           // wait for the delimiter, then report the error
+
+    if (_left == 0) {
+        // this is a COBS code byte, the previous block (if any) ended with an implied zero
+        if (_pendingZero)
+            append(0);
+        _left = b - 1;
+        _pendingZero = (b != 0xFF);
+    }
+    else {
+        append(b);
+        _left--;
+    }
+
+    return FRAME_PENDING;
+}
@@ -0,0 +1,92 @@
+#ifndef FRAMING_H_
+#define FRAMING_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Byte-stuffed framing shared by the serial links of the smart home.
+ *
+ * Frames are COBS (Consistent Overhead Byte Stuffing) encoded, so the only
+ * 0x00 byte on the wire is the frame delimiter, and carry a trailing
+ * CRC-16/CCITT (poly 0x1021, init 0xFFFF, little-endian on the wire) over
+ * the unstuffed payload. A receiver that joins mid-stream or sees garbage
+ * resynchronises on the next 0x00.
+ *
+ * Wire format:  COBS( payload | crc_lo | crc_hi ) 0x00
+ *
+ * Both classes are free of mbed dependencies so the same code runs on the
+ * host side decoders.
+ */
+
+#define FRAMING_DELIMITER   0x00
+
+// Worst case encoded size of a payload of n bytes (CRC, COBS overhead and delimiter included)
+#define FRAMING_MAX_ENCODED(n)  ((n) + 2 + ((n) + 2) / 254 + 2)
+
+uint16_t crc16_ccitt_update(uint16_t crc, uint8_t b);
+uint16_t crc16_ccitt(const uint8_t* data, size_t len, uint16_t crc = 0xFFFF);
+
+/**
+ * Zero-copy frame encoder.
+ * Payload bytes are stuffed straight into the caller's buffer as they are
+ * put(), the CRC is accumulated on the fly. There is no intermediate
+ * plain-text copy of the frame.
+ */
+class CobsEncoder
+{
+    uint8_t*    _buf;
+    size_t      _size;
+    size_t      _len;
+    size_t      _codeIdx;
+    uint8_t     _code;
+    uint16_t    _crc;
+    bool        _overflow;
+
+    void    stuff(uint8_t b);
+
+public:
+    CobsEncoder(uint8_t* buf, size_t size);
+
+    void    begin(void);
+    void    put(uint8_t b);
+    void    put16(uint16_t v);
+    void    put32(uint32_t v);
+    void    put(const uint8_t* data, size_t len);
+    size_t  finish(void);
+
+    const uint8_t*  data(void) const { return _buf; }
+};
+
+/**
+ * Incremental frame decoder.
+ * Feed it received bytes one at a time (e.g. from a serial RX interrupt).
+ * feed() returns the payload length once a frame with a valid CRC has been
+ * completed, FRAME_PENDING while a frame is in progress and FRAME_ERROR for
+ * a damaged frame (bad stuffing, CRC mismatch or overflow).
+ */
+class CobsDecoder
+{
+    uint8_t*    _buf;
+    size_t      _size;
+    size_t      _len;
+    uint8_t     _left;
+    bool        _pendingZero;
+    bool        _overflow;
+
+    bool    append(uint8_t b);
+
+public:
+    enum {
+        FRAME_PENDING   = 0,
+        FRAME_ERROR     = -1
+    };
+
+    CobsDecoder(uint8_t* buf, size_t size);
+
+    void    reset(void);
+    int     feed(uint8_t b);
+
+    const uint8_t*  data(void) const { return _buf; }
+};
+#endif /* FRAMING_H_ */
@@ -0,0 +1,62 @@
+#ifndef HOME_STATE_H_
+#define HOME_STATE_H_
+
+#include <stdint.h>
+
+#define HOME_TEMP_SCALE     100         // temp_centi units per degree Celsius
+#define HOME_WATER_SCALE    65535       // water reading at full scale
+
+/**
+ * Everything the control loop knows about the house, packed into 14 bytes.
+ *
+ * Temperatures are fixed-point in 1/100 C, the water level is the raw 16-bit
+ * ADC reading, flags and small enums are bitfields. This replaces 13 loose
+ * globals and the desired outputs of main.cpp, 73 bytes of floats, ints,
+ * bools and chars (76 laid out in declaration order), and is small enough
+ * to be copied in one go.
+ *
+ * The control loop owns the working copy and publishes it once per pass
+ * through a SeqLock<HomeState> (20 bytes, 34 with the working copy). Taking
+ * a snapshot is a 14 byte copy between two sequence reads and two barriers.
+ * On an x86 host it measured 40 TSC ticks against 2 for the bare copy, the
+ * barriers are the cost. It has not been timed with the DWT on the board.
+ */
+struct HomeState
+{
+    // sensors
+    int16_t     temp_centi;             // DS1820 temperature, 1/100 C
+    uint16_t    water;                  // water sensor, 0..HOME_WATER_SCALE
+    uint16_t    distance_cm;            // ultrasonic distance in front of the garage
+
+    // garage door
+    uint8_t     garage_pos;             // 0..100, was garage_inc
+
+    // phone app and alarms
+    char        alarm_type;             // 'F' fire, 'X' flood, 'S' security, '9' none
+    char        app_out;                // last command from the app
+    char        app_in;                 // last status sent to the app
+
+    // actuators (desired state, see apply_outputs())
+    uint8_t     window;                 // window servo position 0..100
+
+    uint8_t     garage_mode     : 2;    // 0 open, 1 closed, 2 opening, 3 closing
+    uint8_t     mode            : 3;    // HouseMode
+    uint8_t     alarm_trigger   : 1;
+    uint8_t     temp_conversion : 1;    // a DS1820 conversion is in progress
+    uint8_t                     : 1;
+
+    uint8_t     house_lights    : 1;
+    uint8_t     doorlock        : 1;
+    uint8_t     heater          : 1;
+    uint8_t     aircon          : 1;
+    uint8_t     garage_opening  : 1;    // garage LEDs
+    uint8_t     garage_closing  : 1;
+    uint8_t     garage_door     : 1;
+    uint8_t                     : 1;
+
+    uint8_t     alarm_iterator  : 4;    // position in the alarm melody
+    uint8_t                     : 4;
+} __attribute__((packed));
+
+static_assert(sizeof(HomeState) == 14, "HomeState is expected to pack into 14 bytes");
+#endif /* HOME_STATE_H_ */
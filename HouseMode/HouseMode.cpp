@@ -0,0 +1,97 @@
+#include "HouseMode.h"
+#include "TraceRing.h"
+
+static const char*  MODE_NAMES[MODE_COUNT] = { "Normal", "Eco", "Security", "Fire", "Flood" };
+static const char*  EVENT_NAMES[EV_COUNT] = { "eco_on", "eco_off", "security_on", "security_off", "fire", "flood" };
+static const char*  GUARD_NAMES[GUARD_COUNT] = { "", "fire_cleared", "water_cleared" };
+
+/**
+ * @brief   Constructs the state machine in its initial mode.
+ * @note    The entry action of the initial mode is not run.
+ * @param   actions:    entry/exit actions and guards
+ * @param   initial:    starting mode
+ * @retval
+ */
+ModeMachine::ModeMachine(const ModeActions& actions, HouseMode initial /*= MODE_NORMAL*/) :
+    _actions(actions),
+    _mode(initial),
+    _transitions(0),
+    _rejected(0)
+{ }
+
+/**
+ * @brief   Feeds an event into the state machine.
+ * @note    Runs the exit action of the current mode, then the entry action
+ *          of the next one. Events without a transition are ignored, which
+ *          makes repeating an event harmless.
+ * @param   event: what happened
+ * @retval  true if the mode changed
+ */
+bool ModeMachine::dispatch(HouseEvent event)
+{
+    if (event >= EV_COUNT)
+        return false;
+
+    const ModeTransition&   t = HOUSE_MODE_TABLE[_mode][event];
+
+    if (t.next == MODE_COUNT)
+        return false;
+
+    if (t.guard != GUARD_NONE && _actions.guard[t.guard] != NULL && !_actions.guard[t.guard]()) {
+        _rejected++;
+        return false;
+    }
+
+    TRACE_MARK(TP_MODE, (_mode << 8) | t.next);
+    if (_actions.exit[_mode] != NULL)
+        _actions.exit[_mode]();
+    _mode = (HouseMode)t.next;
+    if (_actions.enter[_mode] != NULL)
+        _actions.enter[_mode]();
+    _transitions++;
+    return true;
+}
+
+const char* ModeMachine::modeName(uint8_t mode)
+{
+    return mode < MODE_COUNT ? MODE_NAMES[mode] : "?";
+}
+
+const char* ModeMachine::eventName(uint8_t event)
+{
+    return event < EV_COUNT ? EVENT_NAMES[event] : "?";
+}
+
+const char* ModeMachine::guardName(uint8_t guard)
+{
+    return guard < GUARD_COUNT ? GUARD_NAMES[guard] : "?";
+}
+
+/**
+ * @brief   Writes the transition table as a Graphviz graph.
+ * @note    Render with: dot -Tpng house_modes.dot -o house_modes.png
+ * @param   out: where to write the graph
+ * @retval
+ */
+void ModeMachine::writeDot(FILE* out)
+{
+    fprintf(out, "digraph house_modes {\n");
+    fprintf(out, "    rankdir=LR;\n");
+    for (int m = 0; m < MODE_COUNT; m++)
+        fprintf(out, "    %s [shape=%s];\n", MODE_NAMES[m], m == MODE_NORMAL ? "doublecircle" : "circle");
+    for (int m = 0; m < MODE_COUNT; m++) {
+        for (int e = 0; e < EV_COUNT; e++) {
+            const ModeTransition&   t = HOUSE_MODE_TABLE[m][e];
+
+            if (t.next == MODE_COUNT)
+                continue;
+            if (t.guard == GUARD_NONE)
+                fprintf(out, "    %s -> %s [label=\"%s\"];\n", MODE_NAMES[m], MODE_NAMES[t.next], EVENT_NAMES[e]);
+            else
+                fprintf(out, "    %s -> %s [label=\"%s [%s]\"];\n", MODE_NAMES[m], MODE_NAMES[t.next],
+                        EVENT_NAMES[e], GUARD_NAMES[t.guard]);
+        }
+    }
+
+    fprintf(out, "}\n");
+}
@@ -0,0 +1,130 @@
+#ifndef HOUSE_MODE_H_
+#define HOUSE_MODE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+Global modes of operation for the automated smart home.
+Mode 0: Normal Mode
+Mode 1: Eco Mode
+Mode 2: Security Mode
+Mode 3: Fire Emergency Mode
+Mode 4: Flood Emergency Mode
+*/
+enum HouseMode {
+    MODE_NORMAL     = 0,
+    MODE_ECO        = 1,
+    MODE_SECURITY   = 2,
+    MODE_FIRE       = 3,
+    MODE_FLOOD      = 4,
+    MODE_COUNT
+};
+
+enum HouseEvent {
+    EV_ECO_ON       = 0,    // app '2'
+    EV_ECO_OFF      = 1,    // app '4'
+    EV_SECURITY_ON  = 2,    // app '6'
+    EV_SECURITY_OFF = 3,    // app '7', also acknowledges a fire or flood
+    EV_FIRE         = 4,    // fire detected
+    EV_FLOOD        = 5,    // water detected
+    EV_COUNT
+};
+
+enum ModeGuard {
+    GUARD_NONE          = 0,
+    GUARD_FIRE_CLEARED  = 1,    // temperature back below the fire threshold
+    GUARD_WATER_CLEARED = 2,    // water sensor dry again
+    GUARD_COUNT
+};
+
+struct ModeTransition
+{
+    uint8_t next;   // MODE_COUNT: the event is ignored in this mode
+    uint8_t guard;
+};
+
+#define MODE_STAY   { MODE_COUNT, GUARD_NONE }
+
+/*
+Transition table, indexed by [current mode][event].
+Emergencies always win: fire takes over any mode but flood, flood takes
+over every mode. Leaving an emergency needs the hazard to be gone.
+*/
+static constexpr ModeTransition HOUSE_MODE_TABLE[MODE_COUNT][EV_COUNT] = {
+    //  EV_ECO_ON                   EV_ECO_OFF                  EV_SECURITY_ON                  EV_SECURITY_OFF                         EV_FIRE                     EV_FLOOD
+    {   { MODE_ECO, GUARD_NONE },   MODE_STAY,                  { MODE_SECURITY, GUARD_NONE },  MODE_STAY,                              { MODE_FIRE, GUARD_NONE },  { MODE_FLOOD, GUARD_NONE } },  // MODE_NORMAL
+    {   MODE_STAY,                  { MODE_NORMAL, GUARD_NONE },{ MODE_SECURITY, GUARD_NONE },  MODE_STAY,                              { MODE_FIRE, GUARD_NONE },  { MODE_FLOOD, GUARD_NONE } },  // MODE_ECO
+    {   MODE_STAY,                  MODE_STAY,                  MODE_STAY,                      { MODE_NORMAL, GUARD_NONE },            { MODE_FIRE, GUARD_NONE },  { MODE_FLOOD, GUARD_NONE } },  // MODE_SECURITY
+    {   MODE_STAY,                  MODE_STAY,                  MODE_STAY,                      { MODE_NORMAL, GUARD_FIRE_CLEARED },    MODE_STAY,                  { MODE_FLOOD, GUARD_NONE } },  // MODE_FIRE
+    {   MODE_STAY,                  MODE_STAY,                  MODE_STAY,                      { MODE_NORMAL, GUARD_WATER_CLEARED },   MODE_STAY,                  MODE_STAY                  }   // MODE_FLOOD
+};
+
+// Compile time checks of the table (C++11 constexpr, hence the recursion)
+constexpr bool mode_table_reaches(int mode, int event, int target)
+{
+    return mode == MODE_COUNT ? true :
+           (HOUSE_MODE_TABLE[mode][event].next == target || mode == target) &&
+           mode_table_reaches(mode + 1, event, target);
+}
+
+constexpr bool mode_table_valid(int index)
+{
+    return index == MODE_COUNT * EV_COUNT ? true :
+           HOUSE_MODE_TABLE[index / EV_COUNT][index % EV_COUNT].next <= MODE_COUNT &&
+           HOUSE_MODE_TABLE[index / EV_COUNT][index % EV_COUNT].guard < GUARD_COUNT &&
+           mode_table_valid(index + 1);
+}
+
+static_assert(mode_table_valid(0), "HOUSE_MODE_TABLE has an invalid mode or guard");
+static_assert(mode_table_reaches(0, EV_FLOOD, MODE_FLOOD), "every mode must enter MODE_FLOOD on EV_FLOOD");
+
+/**
+ * Entry/exit actions and guards, supplied by the application.
+ * Any pointer may be NULL. Guards without a function always pass.
+ */
+struct ModeActions
+{
+    void    (*enter[MODE_COUNT])(void);
+    void    (*exit[MODE_COUNT])(void);
+    bool    (*guard[GUARD_COUNT])(void);
+};
+
+/**
+ * Table driven house mode state machine.
+ * dispatch() is one table lookup, the guard call and the exit/entry actions.
+ *
+ * Example of use:
+ *
+ * @code
+ *
+ * ModeMachine house_mode(actions);
+ *
+ * if (temp > 30)
+ *     house_mode.dispatch(EV_FIRE);
+ * if (house_mode.mode() == MODE_ECO)
+ *     ...
+ *
+ * @endcode
+ */
+class ModeMachine
+{
+    const ModeActions&  _actions;
+    HouseMode           _mode;
+    uint32_t            _transitions;
+    uint32_t            _rejected;
+
+public:
+    ModeMachine(const ModeActions& actions, HouseMode initial = MODE_NORMAL);
+
+    bool        dispatch(HouseEvent event);
+    HouseMode   mode(void) const { return _mode; }
+    uint32_t    transitions(void) const { return _transitions; }
+    uint32_t    rejected(void) const { return _rejected; }
+
+    static const char*  modeName(uint8_t mode);
+    static const char*  eventName(uint8_t event);
+    static const char*  guardName(uint8_t guard);
+    static void         writeDot(FILE* out);
+};
+#endif /* HOUSE_MODE_H_ */
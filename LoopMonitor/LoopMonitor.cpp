@@ -0,0 +1,226 @@
+#include "LoopMonitor.h"
+#include <stddef.h>
+
+#define LOOP_MAGIC      0x4C4F4F50  // "LOOP"
+
+// Reset source identification register of the LPC1768
+#define RSID_POR        (1UL << 0)
+#define RSID_EXTR       (1UL << 1)
+#define RSID_WDTR       (1UL << 2)
+#define RSID_BODR       (1UL << 3)
+
+// Watchdog mode register
+#define WDMOD_WDEN      (1UL << 0)
+#define WDMOD_WDRESET   (1UL << 1)
+
+/*
+AHBSRAM1 is the Ethernet RAM bank, unused here. The GCC linker script of the
+LPC1768 places it NOLOAD and the startup code neither loads nor clears it.
+*/
+static LoopRecord   loop_record __attribute__((section("AHBSRAM1")));
+
+/**
+ * @brief   Constructs the monitor.
+ * @note    Nothing is timed and the watchdog is off until start().
+ * @param   tasks:          the subsystems of the loop in the order they run
+ * @param   count:          number of tasks, up to LOOP_MAX_TASKS
+ * @param   stall_ms:       a task running longer resets the board
+ * @param   watchdog_ms:    hardware watchdog period
+ * @retval
+ */
+LoopMonitor::LoopMonitor(const LoopTask* tasks, uint8_t count, uint32_t stall_ms /*= LOOP_STALL_MS*/,
+                         uint32_t watchdog_ms /*= LOOP_WATCHDOG_MS*/) :
+    _tasks(tasks),
+    _count(count < LOOP_MAX_TASKS ? count : LOOP_MAX_TASKS),
+    _stall_us(stall_ms * 1000),
+    _watchdog_ms(watchdog_ms),
+    _start_us(0),
+    _unreported(0)
+{ }
+
+/**
+ * @brief   Checksum of the counters.
+ * @note
+ * @param
+ * @retval
+ */
+uint32_t LoopMonitor::checksum(void) const
+{
+    const uint8_t*  p = (const uint8_t*)&loop_record + offsetof(LoopRecord, boots);
+    const uint8_t*  end = (const uint8_t*)&loop_record + offsetof(LoopRecord, current);
+    uint32_t        sum = LOOP_MAGIC;
+
+    while (p < end)
+        sum = sum * 31 + *p++;
+    return sum;
+}
+
+/**
+ * @brief   Updates the checksum after the counters changed.
+ * @note
+ * @param
+ * @retval
+ */
+void LoopMonitor::seal(void)
+{
+    loop_record.magic = LOOP_MAGIC;
+    loop_record.check = checksum();
+}
+
+/**
+ * @brief   Finds out why the board started, then starts the stall check
+ *          and the watchdog.
+ * @note    Call once the start up waits are over.
+ * @param
+ * @retval
+ */
+void LoopMonitor::start(void)
+{
+    uint32_t    rsid = LPC_SC->RSID;
+
+    LPC_SC->RSID = rsid;    // the flags are cleared by writing them
+    if ((rsid & RSID_POR) || loop_record.magic != LOOP_MAGIC || loop_record.check != checksum()) {
+        memset(&loop_record, 0, sizeof(loop_record));
+        loop_record.cause = LOOP_RESET_POWER_ON;
+        loop_record.stalled = LOOP_NO_TASK;
+    }
+    else if (loop_record.stalling || (rsid & RSID_WDTR)) {
+        uint8_t task = loop_record.current;
+
+        loop_record.cause = loop_record.stalling ? LOOP_RESET_STALL : LOOP_RESET_WATCHDOG;
+        loop_record.stalled = task;
+        if (loop_record.resets < 0xFFFF)
+            loop_record.resets++;
+
+        // the task that hung overran by at least the stall limit
+        if (task < _count) {
+            uint32_t    over = _stall_us > _tasks[task].budget_us ? _stall_us - _tasks[task].budget_us : 0;
+
+            if (loop_record.overruns[task] < 0xFFFF)
+                loop_record.overruns[task]++;
+            if (over > loop_record.worst_us[task])
+                loop_record.worst_us[task] = over;
+        }
+    }
+    else
+        loop_record.cause = (rsid & RSID_BODR) ? LOOP_RESET_BROWNOUT : LOOP_RESET_EXTERNAL;
+
+    loop_record.boots++;
+    loop_record.current = LOOP_NO_TASK;
+    loop_record.stalling = 0;
+    seal();
+
+    for (uint8_t i = 0; i < _count; i++)
+        if (loop_record.overruns[i] > 0)
+            _unreported |= 1 << i;
+
+    _timer.start();
+    _ticker.attach_us(callback(this, &LoopMonitor::check), LOOP_CHECK_MS * 1000);
+
+    // IRC clock (4 MHz), divided by 4 the counter runs at 1 MHz
+    LPC_WDT->WDCLKSEL = 0;
+    LPC_WDT->WDTC = _watchdog_ms * 1000;
+    LPC_WDT->WDMOD = WDMOD_WDEN | WDMOD_WDRESET;
+    feed();     // the first feed starts the watchdog
+}
+
+/**
+ * @brief   Ticker handler, resets the board when a task hangs.
+ * @note
+ * @param
+ * @retval
+ */
+void LoopMonitor::check(void)
+{
+    if (loop_record.current == LOOP_NO_TASK || (uint32_t)_timer.read_us() - _start_us < _stall_us)
+        return;
+
+    loop_record.stalling = 1;
+    NVIC_SystemReset();
+}
+
+/**
+ * @brief   Runs a task and counts it when it goes over its budget.
+ * @note
+ * @param   task: index in the task table
+ * @retval
+ */
+void LoopMonitor::run(uint8_t task)
+{
+    // the start first, the stall check only looks at it while a task is set
+    _start_us = _timer.read_us();
+    loop_record.current = task;
+    _tasks[task].run();
+
+    uint32_t    elapsed = (uint32_t)_timer.read_us() - _start_us;
+
+    loop_record.current = LOOP_NO_TASK;
+    if (elapsed <= _tasks[task].budget_us)
+        return;
+
+    uint32_t    over = elapsed - _tasks[task].budget_us;
+
+    if (loop_record.overruns[task] < 0xFFFF)
+        loop_record.overruns[task]++;
+    if (over > loop_record.worst_us[task])
+        loop_record.worst_us[task] = over;
+    _unreported |= 1 << task;
+    seal();
+}
+
+/**
+ * @brief   One pass of the loop: every task in order, then the watchdog is fed.
+ * @note
+ * @param
+ * @retval
+ */
+void LoopMonitor::pass(void)
+{
+    for (uint8_t i = 0; i < _count; i++)
+        run(i);
+    feed();
+}
+
+/**
+ * @brief   Feeds the hardware watchdog.
+ * @note    The two writes must not be split by another access to the watchdog.
+ * @param
+ * @retval
+ */
+void LoopMonitor::feed(void)
+{
+    uint32_t    primask = __get_PRIMASK();
+
+    __disable_irq();
+    LPC_WDT->WDFEED = 0xAA;
+    LPC_WDT->WDFEED = 0x55;
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief   Gets a task that overran since it was last returned.
+ * @note    After a reset the tasks with overruns from before are returned once.
+ * @param   task: filled with the index of the task
+ * @retval  false when there is none
+ */
+bool LoopMonitor::nextOverrun(uint8_t& task)
+{
+    for (uint8_t i = 0; i < _count; i++)
+        if (_unreported & (1 << i)) {
+            _unreported &= ~(1 << i);
+            task = i;
+            return true;
+        }
+    return false;
+}
+
+/**
+ * @brief   The counters and the cause of the last reset.
+ * @note
+ * @param
+ * @retval
+ */
+const LoopRecord& LoopMonitor::record(void) const
+{
+    return loop_record;
+}
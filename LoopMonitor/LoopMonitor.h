@@ -0,0 +1,116 @@
+#ifndef LOOP_MONITOR_H_
+#define LOOP_MONITOR_H_
+
+#include "mbed.h"
+
+#define LOOP_MAX_TASKS      12
+#define LOOP_NO_TASK        0xFF
+#ifndef LOOP_STALL_MS
+#define LOOP_STALL_MS       2000    // a task running longer than this resets the board
+#endif
+
+#ifndef LOOP_WATCHDOG_MS
+#define LOOP_WATCHDOG_MS    4000    // hardware watchdog, for a stall with the interrupts off
+#endif
+
+#define LOOP_CHECK_MS       100     // period of the stall check
+
+/**
+ * Why the board last started.
+ */
+enum LoopResetCause {
+    LOOP_RESET_POWER_ON = 0,
+    LOOP_RESET_EXTERNAL = 1,        // reset button or debugger
+    LOOP_RESET_STALL    = 2,        // a task ran past the stall limit
+    LOOP_RESET_WATCHDOG = 3,        // the hardware watchdog was not fed
+    LOOP_RESET_BROWNOUT = 4
+};
+
+/**
+ * A subsystem of the control loop and the time it may take in a pass.
+ */
+struct LoopTask
+{
+    void        (*run)(void);
+    uint32_t    budget_us;
+};
+
+/**
+ * Overrun counters. They are kept in RAM the startup code does not clear,
+ * so they survive a reset (not a power cycle), a checksum tells them from
+ * the random content after power on.
+ */
+struct LoopRecord
+{
+    uint32_t            magic;
+    uint32_t            check;                      // of the fields from 'boots' to 'worst_us'
+    uint16_t            boots;
+    uint16_t            resets;                     // stall and watchdog resets
+    uint8_t             cause;                      // of the last reset, LOOP_RESET_xxx
+    uint8_t             stalled;                    // task that ran at the last stall or watchdog reset
+    uint16_t            overruns[LOOP_MAX_TASKS];   // passes over the budget
+    uint32_t            worst_us[LOOP_MAX_TASKS];   // longest time past the budget
+    volatile uint8_t    current;                    // task running, LOOP_NO_TASK between tasks
+    volatile uint8_t    stalling;                   // set by the stall check before it resets
+};
+
+/**
+ * Deadline monitor of the control loop.
+ *
+ * pass() runs the tasks in order and times each one against its budget. A
+ * task over its budget is counted with the time it went over, the largest
+ * overrun of each task is kept. A ticker checks the running task every
+ * LOOP_CHECK_MS and resets the board when it has been running longer than
+ * the stall limit, e.g. on a wedged 1-Wire bus or a getc() that never
+ * returns. The hardware watchdog is fed once per pass and resets the board
+ * when even the ticker cannot run. After either reset the task that was
+ * running is known, the reset leaves every pin an input so all the
+ * actuators are off until the loop runs again.
+ *
+ * Waits outside the tasks (the safe state) must call feed() more often
+ * than the watchdog period.
+ *
+ * Example of use:
+ *
+ * @code
+ *
+ * const LoopTask  tasks[] = { { read_sensors, 2000 }, { control, 500 } };
+ * LoopMonitor     monitor(tasks, 2);
+ * uint8_t         task;
+ *
+ * monitor.start();
+ * while (1) {
+ *     monitor.pass();
+ *     while (monitor.nextOverrun(task))
+ *         printf("task %d: %d overruns\r\n", task, monitor.record().overruns[task]);
+ * }
+ *
+ * @endcode
+ */
+class LoopMonitor
+{
+    const LoopTask*     _tasks;
+    uint8_t             _count;
+    uint32_t            _stall_us;
+    uint32_t            _watchdog_ms;
+    Timer               _timer;
+    Ticker              _ticker;
+    volatile uint32_t   _start_us;
+    uint16_t            _unreported;    // bit n: task n overran since nextOverrun() returned it
+
+    void        check(void);
+    void        run(uint8_t task);
+    void        seal(void);
+    uint32_t    checksum(void) const;
+
+public:
+    LoopMonitor(const LoopTask* tasks, uint8_t count, uint32_t stall_ms = LOOP_STALL_MS, uint32_t watchdog_ms = LOOP_WATCHDOG_MS);
+
+    void    start(void);
+    void    pass(void);
+    void    feed(void);
+    bool    nextOverrun(uint8_t& task);
+
+    const LoopRecord&   record(void) const;
+};
+#endif /* LOOP_MONITOR_H_ */
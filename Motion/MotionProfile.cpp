@@ -0,0 +1,257 @@
+#include "MotionProfile.h"
+
+static int32_t iabs(int32_t x)
+{
+    return x < 0 ? -x : x;
+}
+
+static uint32_t isqrt64(uint64_t x)
+{
+    uint64_t    r = 0;
+    uint64_t    bit = (uint64_t)1 << 62;
+
+    while (bit > x)
+        bit >>= 2;
+    while (bit) {
+        if (x >= r + bit) {
+            x -= r + bit;
+            r = (r >> 1) + bit;
+        }
+        else
+            r >>= 1;
+        bit >>= 2;
+    }
+
+    return (uint32_t)r;
+}
+
+/**
+ * @brief   Constructs a motion profile at rest in position 0.
+ * @note
+ * @param   rate_hz:        rate at which step() will be called
+ * @param   vmax_per_s:     maximum velocity, units per second
+ * @param   amax_per_s2:    maximum acceleration, units per second^2
+ * @param   shape:          trapezoid or S-curve
+ * @retval
+ */
+MotionProfile::MotionProfile(uint32_t rate_hz, int32_t vmax_per_s, int32_t amax_per_s2,
+                             MotionShape shape /*= MOTION_TRAPEZOID*/) :
+    _vmax((int32_t)(((int64_t)vmax_per_s << 16) / rate_hz)),
+    _amax((int32_t)(((int64_t)amax_per_s2 << 16) / ((int64_t)rate_hz * rate_hz))),
+    _shape(shape)
+{
+    if (_amax < 1)
+        _amax = 1;
+    reset(0);
+}
+
+/**
+ * @brief   Puts the axis at rest in 'position'.
+ * @note
+ * @param
+ * @retval
+ */
+void MotionProfile::reset(int32_t position)
+{
+    _pos = position << 16;
+    _target = _pos;
+    _vel = 0;
+    _done = true;
+    _elapsed = 0;
+    _duration = 0;
+}
+
+/**
+ * @brief   Sets a new target, also while moving.
+ * @note    A trapezoid in motion away from the new target decelerates and
+ *          reverses, an S-curve replans from where it is.
+ * @param
+ * @retval
+ */
+void MotionProfile::setTarget(int32_t target)
+{
+    if ((target << 16) == _target && !_done)
+        return;
+
+    _target = target << 16;
+    _done = (_target == _pos && _vel == 0);
+    if (_shape == MOTION_SCURVE && !_done)
+        planScurve();
+}
+
+/**
+ * @brief   Corrects the position from a feedback sensor.
+ * @note    The velocity is kept so the motion continues smoothly.
+ * @param
+ * @retval
+ */
+void MotionProfile::resync(int32_t position)
+{
+    _pos = position << 16;
+    if (_shape == MOTION_SCURVE && !_done)
+        planScurve();
+}
+
+/**
+ * @brief   Stops the axis dead where it is.
+ * @note    No deceleration, for emergency stops. The next target is
+ *          approached from rest.
+ * @param
+ * @retval
+ */
+void MotionProfile::halt(void)
+{
+    _target = _pos;
+    _vel = 0;
+    _done = true;
+}
+
+/**
+ * @brief   Tells if the axis currently moves away from its target.
+ * @note
+ * @param
+ * @retval
+ */
+bool MotionProfile::reversing(void) const
+{
+    return (_vel > 0 && _target < _pos) || (_vel < 0 && _target > _pos);
+}
+
+/**
+ * @brief   Position where the axis comes to rest when braking now.
+ * @note    Used to cancel a move without reversing.
+ * @param
+ * @retval
+ */
+int32_t MotionProfile::stoppingPoint(void) const
+{
+    int64_t stop = ((int64_t)_vel * _vel) / (2 * (int64_t)_amax);
+
+    return (int32_t)((_pos + (_vel < 0 ? -stop : stop) + 0x8000) >> 16);
+}
+
+/**
+ * @brief   Travel time of an S-curve move.
+ * @note    The quintic 10u^3 - 15u^4 + 6u^5 peaks at 1.875 D/T velocity and
+ *          5.774 D/T^2 acceleration, T is the smallest time within both limits.
+ * @param
+ * @retval  Number of ticks
+ */
+uint32_t MotionProfile::scurveTicks(int32_t distance, uint32_t rate_hz, int32_t vmax_per_s, int32_t amax_per_s2)
+{
+    uint64_t    d = iabs(distance);
+    uint64_t    byVel = (d * 1875 * rate_hz) / ((uint64_t)vmax_per_s * 1000);
+    uint64_t    byAcc = isqrt64((d * 5774 * rate_hz * rate_hz) / ((uint64_t)amax_per_s2 * 1000));
+    uint64_t    ticks = byVel > byAcc ? byVel : byAcc;
+
+    return ticks ? (uint32_t)ticks : 1;
+}
+
+/**
+ * @brief   Plans an S-curve from the current position to the target.
+ * @note
+ * @param
+ * @retval
+ */
+void MotionProfile::planScurve(void)
+{
+    _start = _pos;
+    _distance = _target - _pos;
+    _elapsed = 0;
+
+    // limits per tick -> same formula with rate 1
+    uint64_t    d = iabs(_distance);
+    uint64_t    byVel = (d * 1875) / ((uint64_t)_vmax * 1000);
+    uint64_t    byAcc = isqrt64((d * 5774) / ((uint64_t)_amax * 1000));
+
+    _duration = (uint32_t)(byVel > byAcc ? byVel : byAcc);
+    if (_duration == 0)
+        _duration = 1;
+}
+
+/**
+ * @brief   Advances the trapezoid by one tick.
+ * @note    Decelerates as soon as the remaining distance is within the
+ *          stopping distance v^2 / 2a.
+ * @param
+ * @retval  true when the target was reached at this tick
+ */
+bool MotionProfile::stepTrapezoid(void)
+{
+    int32_t dist = _target - _pos;
+    int32_t dir = dist > 0 ? 1 : -1;
+    int64_t stop = ((int64_t)_vel * _vel) / (2 * (int64_t)_amax);
+
+    if (_vel != 0 && (_vel > 0) != (dist > 0)) {
+        // moving the wrong way (reversed target), brake first
+        if (iabs(_vel) <= _amax)
+            _vel = 0;
+        else
+            _vel -= (_vel > 0 ? _amax : -_amax);
+    }
+    else
+    if ((int64_t)iabs(dist) <= stop + iabs(_vel)) {
+        int32_t v = iabs(_vel) - _amax;
+
+        _vel = dir * (v > _amax ? v : _amax);   // keep creeping until the target is reached
+    }
+    else {
+        _vel += dir * _amax;
+        if (iabs(_vel) > _vmax)
+            _vel = dir * _vmax;
+    }
+
+    if (iabs(dist) <= iabs(_vel) && (_vel > 0) == (dist > 0)) {
+        _pos = _target;
+        _vel = 0;
+        return true;
+    }
+
+    _pos += _vel;
+    return false;
+}
+
+/**
+ * @brief   Advances the S-curve by one tick.
+ * @note    p = start + D * (10u^3 - 15u^4 + 6u^5), u = elapsed / duration,
+ *          evaluated in Q16 with 64-bit intermediates.
+ * @param
+ * @retval  true when the target was reached at this tick
+ */
+bool MotionProfile::stepScurve(void)
+{
+    int32_t prev = _pos;
+
+    if (++_elapsed >= _duration) {
+        _pos = _target;
+        _vel = 0;
+        return true;
+    }
+
+    int64_t u = ((int64_t)_elapsed << 16) / _duration;     // Q16
+    int64_t u2 = (u * u) >> 16;
+    int64_t u3 = (u2 * u) >> 16;
+    int64_t s = (u3 * ((10 << 16) - 15 * u + ((6 * u2)))) >> 16;   // Q16, 0..1
+
+    _pos = _start + (int32_t)(((int64_t)_distance * s) >> 16);
+    _vel = _pos - prev;
+    return false;
+}
+
+/**
+ * @brief   Computes the next setpoint.
+ * @note    Call at the rate given to the constructor.
+ * @param
+ * @retval  true once, at the tick the move completes
+ */
+bool MotionProfile::step(void)
+{
+    if (_done)
+        return false;
+
+    bool    arrived = (_shape == MOTION_SCURVE) ? stepScurve() : stepTrapezoid();
+
+    if (arrived)
+        _done = true;
+    return arrived;
+}
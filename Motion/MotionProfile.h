@@ -0,0 +1,58 @@
+#ifndef MOTION_PROFILE_H_
+#define MOTION_PROFILE_H_
+
+#include <stdint.h>
+
+enum MotionShape {
+    MOTION_TRAPEZOID    = 0,    // acceleration limited, can be retargeted smoothly at any time
+    MOTION_SCURVE       = 1     // jerk limited (quintic), retargeting replans from the current position
+};
+
+/**
+ * Fixed rate setpoint generator for one axis.
+ *
+ * Positions are in caller defined units (e.g. permille of the servo travel),
+ * internally Q16.16 fixed point, so step() uses integer arithmetic only.
+ * Velocity and acceleration limits are given per second and converted to
+ * per tick once, the travel time of a move therefore only depends on the
+ * distance and the limits, never on when step() is called.
+ *
+ * Free of mbed dependencies.
+ */
+class MotionProfile
+{
+    int32_t     _pos;       // Q16
+    int32_t     _vel;       // Q16 per tick
+    int32_t     _target;    // Q16
+    int32_t     _vmax;      // Q16 per tick
+    int32_t     _amax;      // Q16 per tick^2
+    MotionShape _shape;
+    bool        _done;
+
+    // S-curve plan
+    int32_t     _start;     // Q16
+    int32_t     _distance;  // Q16
+    uint32_t    _elapsed;   // ticks
+    uint32_t    _duration;  // ticks
+
+    void    planScurve(void);
+    bool    stepTrapezoid(void);
+    bool    stepScurve(void);
+
+public:
+    MotionProfile(uint32_t rate_hz, int32_t vmax_per_s, int32_t amax_per_s2, MotionShape shape = MOTION_TRAPEZOID);
+
+    void        reset(int32_t position);
+    void        setTarget(int32_t target);
+    void        resync(int32_t position);
+    void        halt(void);
+    bool        step(void);
+
+    int32_t     position(void) const { return (_pos + 0x8000) >> 16; }
+    int32_t     target(void) const { return (_target + 0x8000) >> 16; }
+    bool        done(void) const { return _done; }
+    bool        reversing(void) const;
+    int32_t     stoppingPoint(void) const;
+    static uint32_t scurveTicks(int32_t distance, uint32_t rate_hz, int32_t vmax_per_s, int32_t amax_per_s2);
+};
+#endif /* MOTION_PROFILE_H_ */
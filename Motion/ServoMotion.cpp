@@ -0,0 +1,161 @@
+#include "ServoMotion.h"
+
+/**
+ * @brief   Constructs the servo motion.
+ * @note    start() sets the initial position and starts the ticker.
+ * @param   servo:          servo to drive
+ * @param   vmax_per_s:     maximum velocity, permille per second
+ * @param   amax_per_s2:    maximum acceleration, permille per second^2
+ * @param   shape:          trapezoid or S-curve
+ * @retval
+ */
+ServoMotion::ServoMotion(Servo& servo, int32_t vmax_per_s, int32_t amax_per_s2,
+                         MotionShape shape /*= MOTION_TRAPEZOID*/) :
+    _servo(servo),
+    _profile(MOTION_RATE_HZ, vmax_per_s, amax_per_s2, shape),
+    _request(0),
+    _pending(false),
+    _cancel(false),
+    _halt(false),
+    _moving(false),
+    _position(0),
+    _written(-1),
+    _moves(0),
+    _reversals(0),
+    _stalls(0),
+    _onComplete(NULL),
+    _feedback(NULL)
+{ }
+
+/**
+ * @brief   Puts the servo in 'position' and starts the ticker.
+ * @note
+ * @param   position:   permille of the travel
+ * @retval
+ */
+void ServoMotion::start(int32_t position)
+{
+    _profile.reset(position);
+    _position = position;
+    write(position);
+    _ticker.attach_us(callback(this, &ServoMotion::tick), 1000000 / MOTION_RATE_HZ);
+}
+
+/**
+ * @brief   Stops the ticker, the servo stays where it is.
+ * @note
+ * @param
+ * @retval
+ */
+void ServoMotion::stop(void)
+{
+    _ticker.detach();
+    _moving = false;
+}
+
+/**
+ * @brief   Requests a move to 'position'.
+ * @note    Interrupt safe, applied at the next tick. A move in the opposite
+ *          direction brakes and reverses without a velocity step.
+ * @param   position:   permille of the travel
+ * @retval
+ */
+void ServoMotion::moveTo(int32_t position)
+{
+    if (!_pending && position == _profile.target())
+        return;
+
+    _request = position;
+    _cancel = false;
+    _pending = true;
+    _moving = true;
+}
+
+/**
+ * @brief   Requests the move to stop as soon as the deceleration allows.
+ * @note    Interrupt safe, applied at the next tick.
+ * @param
+ * @retval
+ */
+void ServoMotion::cancel(void)
+{
+    _cancel = true;
+    _pending = true;
+}
+
+/**
+ * @brief   Requests a hard stop at the current setpoint.
+ * @note    Interrupt safe, applied at the next tick. There is no braking, the
+ *          setpoint stays where it is and drops the requests made before.
+ *          A moveTo() after it starts from rest.
+ * @param
+ * @retval
+ */
+void ServoMotion::halt(void)
+{
+    _pending = false;
+    _cancel = false;
+    _halt = true;
+}
+
+/**
+ * @brief   Writes the servo, only when the position changed.
+ * @note
+ * @param
+ * @retval
+ */
+void ServoMotion::write(int32_t position)
+{
+    if (position == _written)
+        return;
+
+    _servo = (float)position / MOTION_FULL_SCALE;
+    _written = position;
+}
+
+/**
+ * @brief   Ticker handler, one setpoint.
+ * @note
+ * @param
+ * @retval
+ */
+void ServoMotion::tick(void)
+{
+    if (_halt) {
+        _halt = false;
+        _profile.halt();
+    }
+    if (_pending) {
+        int32_t target = _cancel ? _profile.stoppingPoint() : _request;
+
+        _pending = false;
+        _cancel = false;
+        if (target != _profile.target() || _profile.done()) {
+            _profile.setTarget(target);
+            if (_profile.reversing())
+                _reversals++;
+            _moves++;
+        }
+    }
+
+    if (_feedback) {
+        int32_t actual = _feedback();
+
+        // a door held back by hand or a jammed window must not run away from its setpoint
+        if (actual >= 0 && (actual - _profile.position() > MOTION_TOLERANCE ||
+                            _profile.position() - actual > MOTION_TOLERANCE)) {
+            _profile.resync(actual);
+            _stalls++;
+        }
+    }
+
+    bool    arrived = _profile.step();
+
+    _position = _profile.position();
+    write(_position);
+
+    if (!_pending)
+        _moving = !_profile.done();
+    if (arrived && _onComplete)
+        _onComplete(_position);
+}
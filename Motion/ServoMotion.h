@@ -0,0 +1,74 @@
+#ifndef SERVO_MOTION_H_
+#define SERVO_MOTION_H_
+
+#include "mbed.h"
+#include "Servo.h"
+#include "MotionProfile.h"
+
+#define MOTION_RATE_HZ      100     // setpoint rate, the servo pulse is 50 Hz
+#define MOTION_FULL_SCALE   1000    // positions are in permille of the servo travel
+#define MOTION_TOLERANCE    50      // feedback error that counts as a stall
+
+/**
+ * Servo driven along a MotionProfile from a Ticker.
+ *
+ * The setpoints are computed in the ticker interrupt at a fixed rate, so the
+ * travel time of a move is the same whatever the main loop is doing. moveTo(),
+ * cancel() and halt() only leave a request for the next tick and can be called
+ * from any interrupt, e.g. to re-open a door as soon as an obstacle is seen.
+ *
+ * Example of use:
+ *
+ * @code
+ *
+ * Servo       motor(p24);
+ * ServoMotion door(motor, 350, 700);  // 350 permille/s, 700 permille/s^2
+ *
+ * void arrived(int32_t position) { ... }  // runs in interrupt context
+ *
+ * door.onComplete(arrived);
+ * door.start(1000);                   // servo is at the end of its travel
+ * door.moveTo(0);
+ *
+ * @endcode
+ */
+class ServoMotion
+{
+    Servo&              _servo;
+    Ticker              _ticker;
+    MotionProfile       _profile;
+    volatile int32_t    _request;
+    volatile bool       _pending;
+    volatile bool       _cancel;
+    volatile bool       _halt;
+    volatile bool       _moving;
+    volatile int32_t    _position;
+    int32_t             _written;
+    volatile uint32_t   _moves;
+    volatile uint32_t   _reversals;
+    volatile uint32_t   _stalls;
+    void                (*_onComplete)(int32_t position);
+    int32_t             (*_feedback)(void);
+
+    void    tick(void);
+    void    write(int32_t position);
+
+public:
+    ServoMotion(Servo& servo, int32_t vmax_per_s, int32_t amax_per_s2, MotionShape shape = MOTION_TRAPEZOID);
+
+    void        start(int32_t position);
+    void        stop(void);
+    void        moveTo(int32_t position);
+    void        cancel(void);
+    void        halt(void);
+    void        onComplete(void (*handler)(int32_t position)) { _onComplete = handler; }
+    void        setFeedback(int32_t (*feedback)(void)) { _feedback = feedback; }
+
+    int32_t     position(void) const { return _position; }
+    int32_t     target(void) const { return _pending ? _request : _profile.target(); }
+    bool        moving(void) const { return _moving; }
+    uint32_t    moves(void) const { return _moves; }
+    uint32_t    reversals(void) const { return _reversals; }
+    uint32_t    stalls(void) const { return _stalls; }
+};
+#endif /* SERVO_MOTION_H_ */
@@ -0,0 +1,160 @@
+#include "OccupancyModel.h"
+
+#define EPOCH_WEEKDAY_HOURS 72      // 1970-01-01 was a Thursday, Monday is 3 days earlier
+
+/**
+ * @brief   Constructs a model that learned nothing yet.
+ * @note
+ * @param   zones:  number of zones, at most OCCUPANCY_MAX_ZONES
+ * @retval
+ */
+OccupancyModel::OccupancyModel(uint8_t zones) :
+    _zones(zones > OCCUPANCY_MAX_ZONES ? OCCUPANCY_MAX_ZONES : zones),
+    _events(0)
+{
+    clear();
+}
+
+/**
+ * @brief   Forgets everything learned.
+ * @note    Every slot goes back to OCCUPANCY_PRIOR, expected occupied.
+ * @param
+ * @retval
+ */
+void OccupancyModel::clear(void)
+{
+    for (uint8_t z = 0; z < OCCUPANCY_MAX_ZONES; z++)
+        for (uint16_t s = 0; s < OCCUPANCY_SLOTS; s++)
+            _scores[z][s] = OCCUPANCY_PRIOR;
+
+    _seen = 0;
+    _slot = 0;
+    _hour = 0;
+    _last_s = 0;
+    _started = false;
+}
+
+/**
+ * @brief   Hour of the week of 'time_s', 0 is Monday 00:00 - 00:59.
+ * @note
+ * @param
+ * @retval
+ */
+uint16_t OccupancyModel::slotOf(uint32_t time_s)
+{
+    return (uint16_t)((time_s / 3600 + EPOCH_WEEKDAY_HOURS) % OCCUPANCY_SLOTS);
+}
+
+/**
+ * @brief   Closes the slots that ended before 'now_s'.
+ * @note    The slot that just ended learns what was seen, slots skipped
+ *          entirely (no tick() for over an hour) learn they were empty.
+ *          A clock set backwards restarts the current slot.
+ * @param
+ * @retval
+ */
+void OccupancyModel::advance(uint32_t now_s)
+{
+    uint32_t    hour = now_s / 3600;
+
+    if (!_started || hour < _hour) {
+        _hour = hour;
+        _slot = slotOf(now_s);
+        _seen = 0;
+        _started = true;
+        return;
+    }
+
+    uint32_t    ended = hour - _hour;
+
+    if (ended > OCCUPANCY_SLOTS)
+        ended = OCCUPANCY_SLOTS;
+
+    while (ended--) {
+        for (uint8_t z = 0; z < _zones; z++) {
+            uint8_t&    s = _scores[z][_slot];
+
+            if (_seen & (1 << z))
+                s += (uint8_t)((255 - s + (1 << OCCUPANCY_LEARN_SHIFT) - 1) >> OCCUPANCY_LEARN_SHIFT);
+            else
+                s -= (uint8_t)((s + (1 << OCCUPANCY_LEARN_SHIFT) - 1) >> OCCUPANCY_LEARN_SHIFT);
+        }
+        _seen = 0;
+        _slot = (_slot + 1) % OCCUPANCY_SLOTS;
+    }
+
+    _hour = hour;
+    _slot = slotOf(now_s);
+}
+
+/**
+ * @brief   Records motion in 'zone'.
+ * @note
+ * @param
+ * @retval
+ */
+void OccupancyModel::motion(uint8_t zone, uint32_t now_s)
+{
+    if (zone >= _zones)
+        return;
+
+    advance(now_s);
+    _seen |= (1 << zone);
+    _last_s = now_s;
+    _events++;
+}
+
+/**
+ * @brief   Lets the model close ended hours without motion.
+ * @note    Call regularly, at least once an hour.
+ * @param
+ * @retval
+ */
+void OccupancyModel::tick(uint32_t now_s)
+{
+    advance(now_s);
+}
+
+/**
+ * @brief   Learned occupancy of 'zone' in the hour of 'time_s'.
+ * @note
+ * @param
+ * @retval  0 (never occupied) .. 255 (always occupied)
+ */
+uint8_t OccupancyModel::score(uint8_t zone, uint32_t time_s) const
+{
+    return zone < _zones ? _scores[zone][slotOf(time_s)] : 0;
+}
+
+/**
+ * @brief   Tells if 'zone' is expected occupied from now up to 'lead_s' ahead.
+ * @note    Used to start heating or cooling before people arrive.
+ * @param
+ * @retval
+ */
+bool OccupancyModel::expected(uint8_t zone, uint32_t now_s, uint32_t lead_s) const
+{
+    if (occupiedNow(zone))
+        return true;
+
+    for (uint32_t t = now_s; t <= now_s + lead_s; t += 3600)
+        if (score(zone, t) >= OCCUPANCY_THRESHOLD)
+            return true;
+
+    return score(zone, now_s + lead_s) >= OCCUPANCY_THRESHOLD;
+}
+
+/**
+ * @brief   Tells if no zone is expected occupied within 'lead_s'.
+ * @note    The heater and aircon can idle.
+ * @param
+ * @retval
+ */
+bool OccupancyModel::expectedEmpty(uint32_t now_s, uint32_t lead_s) const
+{
+    for (uint8_t z = 0; z < _zones; z++)
+        if (expected(z, now_s, lead_s))
+            return false;
+
+    return true;
+}
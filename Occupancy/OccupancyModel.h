@@ -0,0 +1,71 @@
+#ifndef OCCUPANCY_MODEL_H_
+#define OCCUPANCY_MODEL_H_
+
+#include <stdint.h>
+
+#define OCCUPANCY_SLOTS         168     // one slot per hour of the week
+#define OCCUPANCY_MAX_ZONES     4       // RAM: OCCUPANCY_MAX_ZONES * OCCUPANCY_SLOTS bytes
+#define OCCUPANCY_LEARN_SHIFT   2       // each week moves a slot 1/4 of the way to what was seen
+#define OCCUPANCY_THRESHOLD     128     // score from which a slot is expected occupied (0..255)
+#define OCCUPANCY_PRIOR         OCCUPANCY_THRESHOLD     // score of a slot that learned nothing yet
+
+/**
+ * Learns when each zone of the house is occupied, per hour of the week.
+ *
+ * Every zone has one byte per hour of the week, the probability that the
+ * zone is occupied in that hour (0..255). Motion only sets a bit for the
+ * current hour; when the hour ends its score moves towards 255 if there
+ * was motion and towards 0 if not. Each event and each hour is O(1) and the
+ * RAM is fixed at OCCUPANCY_MAX_ZONES * OCCUPANCY_SLOTS bytes.
+ *
+ * A slot starts at OCCUPANCY_PRIOR, expected occupied, so a new board keeps
+ * the comfort setpoints until it has seen an hour empty.
+ *
+ * Times are seconds since 1970-01-01 (time(NULL) from the RTC), weeks start
+ * on Monday 00:00.
+ *
+ * Free of mbed dependencies.
+ *
+ * Example of use:
+ *
+ * @code
+ *
+ * OccupancyModel  occupancy(1);
+ *
+ * if (pir)
+ *     occupancy.motion(0, time(NULL));
+ * occupancy.tick(time(NULL));
+ * if (occupancy.expected(0, time(NULL), 3600))
+ *     ...                             // someone is due within the hour, pre-heat
+ *
+ * @endcode
+ */
+class OccupancyModel
+{
+    uint8_t     _scores[OCCUPANCY_MAX_ZONES][OCCUPANCY_SLOTS];
+    uint8_t     _seen;      // motion in the current slot, one bit per zone
+    uint8_t     _zones;
+    uint16_t    _slot;      // current slot
+    uint32_t    _hour;      // hours since 1970 of the current slot
+    uint32_t    _last_s;    // time of the last motion in any zone
+    bool        _started;
+    uint32_t    _events;
+
+    void        advance(uint32_t now_s);
+
+public:
+    OccupancyModel(uint8_t zones);
+
+    void        motion(uint8_t zone, uint32_t now_s);
+    void        tick(uint32_t now_s);
+    void        clear(void);
+
+    static uint16_t slotOf(uint32_t time_s);
+    uint8_t     score(uint8_t zone, uint32_t time_s) const;
+    bool        expected(uint8_t zone, uint32_t now_s, uint32_t lead_s) const;
+    bool        expectedEmpty(uint32_t now_s, uint32_t lead_s) const;
+    bool        recent(uint32_t now_s, uint32_t window_s) const { return _events && (now_s - _last_s) < window_s; }
+    bool        occupiedNow(uint8_t zone) const { return _seen & (1 << zone); }
+    uint32_t    events(void) const { return _events; }
+};
+#endif /* OCCUPANCY_MODEL_H_ */
@@ -0,0 +1,293 @@
+#include "PhoneLink.h"
+#include "TraceRing.h"
+
+/**
+ * @brief   Constructs the phone link on an already configured serial port.
+ * @note    start() must be called to enable reception.
+ * @param   serial: serial port connected to the Bluetooth module
+ * @retval
+ */
+PhoneLink::PhoneLink(RawSerial& serial) :
+    _serial(serial),
+    _decoder(_rxPayload, sizeof(_rxPayload)),
+    _encoder(_txFrame, sizeof(_txFrame)),
+    _alertSeq(0),
+    _haveCmdSeq(false),
+    _lastCmdSeq(0),
+    _lastAccepted(0),
+    _status('O'),
+    _rxOverruns(0),
+    _badFrames(0),
+    _commandsReceived(0),
+    _retransmits(0),
+    _alertsAcked(0),
+    _lastAlertLatency_ms(0)
+{
+    memset(_alerts, 0, sizeof(_alerts));
+}
+
+/**
+ * @brief   Starts the link clock and attaches the RX interrupt.
+ * @note
+ * @param
+ * @retval
+ */
+void PhoneLink::start(void)
+{
+    _clock.start();
+    _serial.attach(callback(this, &PhoneLink::rxIrq), SerialBase::RxIrq);
+}
+
+/**
+ * @brief   Serial RX interrupt handler.
+ * @note    Only moves bytes into the queue, decoding is done by poll().
+ * @param
+ * @retval
+ */
+void PhoneLink::rxIrq(void)
+{
+    while (_serial.readable()) {
+        uint8_t b = _serial.getc();
+
+        if (!_rx.push(b))
+            _rxOverruns++;
+    }
+}
+
+/**
+ * @brief   Processes received bytes and pending alerts.
+ * @note    Call once per main loop pass. Sends at most one alert per call
+ *          so the time spent here stays bounded.
+ * @param
+ * @retval
+ */
+void PhoneLink::poll(void)
+{
+    uint8_t b;
+
+    while (_rx.pop(b)) {
+        int n = _decoder.feed(b);
+
+        if (n > 0)
+            handleFrame(_rxPayload, n);
+        else
+        if (n == CobsDecoder::FRAME_ERROR)
+            _badFrames++;
+    }
+
+    serviceAlerts();
+}
+
+/**
+ * @brief   Returns the next received app command.
+ * @note    Commands of a batch come out in the order they were sent.
+ * @param   cmd: set to the command character
+ * @retval  false if there are no more commands
+ */
+bool PhoneLink::nextCommand(char& cmd)
+{
+    return _commands.pop(cmd);
+}
+
+/**
+ * @brief   Raises a push alert to the phone.
+ * @note    An alert of the same type still waiting for its ack is not duplicated.
+ *          When all slots are busy the lowest priority alert below 'priority'
+ *          is replaced.
+ * @param   type:       alarm type ('F', 'X', 'S')
+ * @param   priority:   PHONE_PRIORITY_xxx, urgent alerts are always sent first
+ * @retval  false if the alert could not be queued
+ */
+bool PhoneLink::alert(char type, uint8_t priority)
+{
+    Alert*  slot = NULL;
+
+    for (int i = 0; i < PHONE_MAX_ALERTS; i++) {
+        if (_alerts[i].active && _alerts[i].type == type)
+            return true;
+    }
+
+    for (int i = 0; i < PHONE_MAX_ALERTS; i++) {
+        if (!_alerts[i].active) {
+            slot = &_alerts[i];
+            break;
+        }
+
+        if (_alerts[i].priority < priority && (slot == NULL || _alerts[i].priority < slot->priority))
+            slot = &_alerts[i];
+    }
+
+    if (slot == NULL)
+        return false;
+
+    uint32_t    now = _clock.read_us();
+
+    slot->active = true;
+    slot->type = type;
+    slot->priority = priority;
+    slot->seq = _alertSeq++;
+    slot->attempts = 0;
+    slot->raised_us = now;
+    slot->due_us = now;
+    slot->backoff_ms = PHONE_RETRY_FIRST_MS;
+    return true;
+}
+
+/**
+ * @brief   Tells if any alert is still waiting for the phone's ack.
+ * @note
+ * @param
+ * @retval
+ */
+bool PhoneLink::alertPending(void) const
+{
+    for (int i = 0; i < PHONE_MAX_ALERTS; i++) {
+        if (_alerts[i].active)
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief   Handles one received frame payload.
+ * @note
+ * @param
+ * @retval
+ */
+void PhoneLink::handleFrame(const uint8_t* p, int len)
+{
+    if (len < 2)
+        return;
+
+    uint8_t seq = p[1];
+
+    switch (p[0]) {
+        case PHONE_CMD:
+            {
+                if (len < 3 || p[2] > len - 3) {
+                    _badFrames++;
+                    return;
+                }
+
+                // a repeated seq means our ack got lost, ack again without re-running
+                if (!_haveCmdSeq || seq != _lastCmdSeq) {
+                    uint8_t accepted = 0;
+
+                    for (uint8_t i = 0; i < p[2]; i++) {
+                        if (_commands.push((char)p[3 + i]))
+                            accepted++;
+                    }
+
+                    _commandsReceived += accepted;
+                    _haveCmdSeq = true;
+                    _lastCmdSeq = seq;
+                    _lastAccepted = accepted;
+                }
+
+                sendAck(seq, _lastAccepted);
+            }
+            break;
+
+        case PHONE_ALERT_ACK:
+            for (int i = 0; i < PHONE_MAX_ALERTS; i++) {
+                Alert&  a = _alerts[i];
+
+                if (a.active && a.seq == seq) {
+                    a.active = false;
+                    _alertsAcked++;
+                    _lastAlertLatency_ms = ((uint32_t)_clock.read_us() - a.raised_us) / 1000;
+                }
+            }
+            break;
+
+        default:
+            _badFrames++;
+    }
+}
+
+/**
+ * @brief   Closes the frame in the encoder and writes it out.
+ * @note
+ * @param
+ * @retval
+ */
+void PhoneLink::send(void)
+{
+    size_t  len = _encoder.finish();
+
+    TRACE_BEGIN_ARG(TP_PHONE_TX, len);
+    for (size_t i = 0; i < len; i++)
+        _serial.putc(_txFrame[i]);
+    TRACE_END(TP_PHONE_TX, 0);
+}
+
+/**
+ * @brief   Acknowledges a command frame.
+ * @note
+ * @param
+ * @retval
+ */
+void PhoneLink::sendAck(uint8_t seq, uint8_t accepted)
+{
+    _encoder.begin();
+    _encoder.put(PHONE_ACK);
+    _encoder.put(seq);
+    _encoder.put(accepted);
+    _encoder.put(_status);
+    send();
+}
+
+/**
+ * @brief   (Re)transmits an alert and schedules the next attempt.
+ * @note    The retry interval doubles up to PHONE_RETRY_MAX_MS.
+ * @param
+ * @retval
+ */
+void PhoneLink::sendAlert(Alert& alert, uint32_t now)
+{
+    uint32_t    age_ms = (now - alert.raised_us) / 1000;
+
+    if (alert.attempts > 0)
+        _retransmits++;
+    if (alert.attempts < 0xFF)
+        alert.attempts++;
+
+    _encoder.begin();
+    _encoder.put(PHONE_ALERT);
+    _encoder.put(alert.seq);
+    _encoder.put(alert.priority);
+    _encoder.put(alert.type);
+    _encoder.put(alert.attempts);
+    _encoder.put16(age_ms > 0xFFFF ? 0xFFFF : age_ms);
+    send();
+
+    alert.due_us = now + alert.backoff_ms * 1000;
+    alert.backoff_ms *= 2;
+    if (alert.backoff_ms > PHONE_RETRY_MAX_MS)
+        alert.backoff_ms = PHONE_RETRY_MAX_MS;
+}
+
+/**
+ * @brief   Sends the most urgent alert that is due.
+ * @note
+ * @param
+ * @retval
+ */
+void PhoneLink::serviceAlerts(void)
+{
+    uint32_t    now = _clock.read_us();
+    Alert*      best = NULL;
+
+    for (int i = 0; i < PHONE_MAX_ALERTS; i++) {
+        Alert&  a = _alerts[i];
+
+        if (!a.active || (int32_t)(now - a.due_us) < 0)
+            continue;
+        if (best == NULL || a.priority > best->priority)
+            best = &a;
+    }
+
+    if (best != NULL)
+        sendAlert(*best, now);
+}
@@ -0,0 +1,97 @@
+#ifndef PHONE_LINK_H_
+#define PHONE_LINK_H_
+
+#include "mbed.h"
+#include "Framing.h"
+#include "RingBuffer.h"
+#include "PhoneProtocol.h"
+
+#define PHONE_MAX_ALERTS    4
+
+/**
+ * Board side of the phone app protocol (see PhoneProtocol.h).
+ *
+ * Received bytes are queued by the serial RX interrupt, poll() decodes them
+ * in the main loop, answers commands and (re)transmits pending alerts.
+ *
+ * Example of use:
+ *
+ * @code
+ *
+ * RawSerial   device(p9, p10);
+ * PhoneLink   link(device);
+ *
+ * link.start();
+ * while (1) {
+ *     char cmd;
+ *
+ *     link.poll();
+ *     while (link.nextCommand(cmd))
+ *         handle_command(cmd);
+ *     if (fire)
+ *         link.alert('F', PHONE_PRIORITY_URGENT);
+ * }
+ *
+ * @endcode
+ */
+class PhoneLink
+{
+    struct Alert
+    {
+        bool        active;
+        char        type;
+        uint8_t     priority;
+        uint8_t     seq;
+        uint8_t     attempts;
+        uint32_t    raised_us;
+        uint32_t    due_us;
+        uint32_t    backoff_ms;
+    };
+
+    RawSerial&              _serial;
+    Timer                   _clock;
+    RingBuffer<uint8_t, 128> _rx;
+    RingBuffer<char, 32>    _commands;
+    uint8_t                 _rxPayload[PHONE_MAX_PAYLOAD + 2];
+    CobsDecoder             _decoder;
+    uint8_t                 _txFrame[FRAMING_MAX_ENCODED(PHONE_MAX_PAYLOAD)];
+    CobsEncoder             _encoder;
+    Alert                   _alerts[PHONE_MAX_ALERTS];
+    uint8_t                 _alertSeq;
+    bool                    _haveCmdSeq;
+    uint8_t                 _lastCmdSeq;
+    uint8_t                 _lastAccepted;
+    char                    _status;
+
+    volatile uint32_t       _rxOverruns;
+    uint32_t                _badFrames;
+    uint32_t                _commandsReceived;
+    uint32_t                _retransmits;
+    uint32_t                _alertsAcked;
+    uint32_t                _lastAlertLatency_ms;
+
+    void    rxIrq(void);
+    void    handleFrame(const uint8_t* p, int len);
+    void    send(void);
+    void    sendAck(uint8_t seq, uint8_t accepted);
+    void    sendAlert(Alert& alert, uint32_t now);
+    void    serviceAlerts(void);
+
+public:
+    PhoneLink(RawSerial& serial);
+
+    void    start(void);
+    void    poll(void);
+    bool    nextCommand(char& cmd);
+    bool    alert(char type, uint8_t priority);
+    void    setStatus(char status) { _status = status; }
+    bool    alertPending(void) const;
+
+    uint32_t    rxOverruns(void) const { return _rxOverruns; }
+    uint32_t    badFrames(void) const { return _badFrames; }
+    uint32_t    commandsReceived(void) const { return _commandsReceived; }
+    uint32_t    retransmits(void) const { return _retransmits; }
+    uint32_t    alertsAcked(void) const { return _alertsAcked; }
+    uint32_t    lastAlertLatency_ms(void) const { return _lastAlertLatency_ms; }
+};
+#endif /* PHONE_LINK_H_ */
@@ -0,0 +1,50 @@
+#ifndef PHONE_PROTOCOL_H_
+#define PHONE_PROTOCOL_H_
+
+#include <stdint.h>
+
+/*
+Request/response protocol between the phone app and the board over the
+Bluetooth serial link (device, p9/p10).
+
+Every message is one frame as defined in Framing.h (COBS + CRC-16). The
+frame payload is:
+
+    type(1) seq(1) body...
+
+Phone -> board
+PHONE_CMD        (0x01)  count(1) command(count)   batch of app commands '0'..'7',
+                                                   count 0 is a ping
+PHONE_ALERT_ACK  (0x04)  -                          acknowledges the alert with 'seq'
+
+Board -> phone
+PHONE_ACK        (0x02)  accepted(1) status(1)      answers PHONE_CMD with the same
+                                                   seq; status is 'O' or the alarm type
+PHONE_ALERT      (0x03)  priority(1) alarm(1) attempt(1) age_ms(2)
+                                                   push notification, resent with
+                                                   exponential backoff until acked
+
+A PHONE_CMD repeated with the same seq (lost ACK) is acknowledged again but
+its commands are not queued a second time. age_ms is the time since the
+alert was raised on the board, the phone adds half a round trip to get the
+delivery latency without synchronised clocks.
+*/
+
+#define PHONE_MAX_PAYLOAD       32
+#define PHONE_MAX_BATCH         (PHONE_MAX_PAYLOAD - 3)
+
+#define PHONE_RETRY_FIRST_MS    200
+#define PHONE_RETRY_MAX_MS      5000
+
+enum PhoneMessage {
+    PHONE_CMD       = 0x01,
+    PHONE_ACK       = 0x02,
+    PHONE_ALERT     = 0x03,
+    PHONE_ALERT_ACK = 0x04
+};
+
+enum PhonePriority {
+    PHONE_PRIORITY_NORMAL   = 1,    // security
+    PHONE_PRIORITY_URGENT   = 2     // fire, flood
+};
+#endif /* PHONE_PROTOCOL_H_ */
@@ -0,0 +1,133 @@
+#include "DistanceFilter.h"
+
+/**
+ * @brief   Constructs a distance filter.
+ * @note
+ * @param   threshold_cm:   obstacle when the distance drops below this
+ * @param   hysteresis_cm:  obstacle cleared above threshold + hysteresis
+ * @retval
+ */
+DistanceFilter::DistanceFilter(uint16_t threshold_cm /*= 10*/, uint16_t hysteresis_cm /*= 3*/) :
+    _threshold(threshold_cm),
+    _hysteresis(hysteresis_cm)
+{
+    reset();
+}
+
+/**
+ * @brief   Forgets all readings.
+ * @note
+ * @param
+ * @retval
+ */
+void DistanceFilter::reset(void)
+{
+    _count = 0;
+    _next = 0;
+    _value = 0;
+    _havePending = false;
+    _obstacle = false;
+    _rejected = 0;
+    _misses = 0;
+}
+
+/**
+ * @brief   Changes the obstacle threshold.
+ * @note
+ * @param
+ * @retval
+ */
+void DistanceFilter::setThreshold(uint16_t threshold_cm, uint16_t hysteresis_cm)
+{
+    _threshold = threshold_cm;
+    _hysteresis = hysteresis_cm;
+}
+
+/**
+ * @brief   Puts an accepted reading into the median window.
+ * @note
+ * @param
+ * @retval
+ */
+void DistanceFilter::push(uint16_t cm)
+{
+    _window[_next] = cm;
+    _next = (_next + 1) % DISTANCE_MEDIAN;
+    if (_count < DISTANCE_MEDIAN)
+        _count++;
+}
+
+/**
+ * @brief   Adds a raw reading.
+ * @note    Safe to call from the echo interrupt, it's a handful of compares.
+ * @param   cm: raw distance, DISTANCE_MAX_CM if no echo was received
+ * @retval  true if the obstacle flag changed
+ */
+bool DistanceFilter::add(uint16_t cm)
+{
+    if (cm < DISTANCE_MIN_CM || cm > DISTANCE_MAX_CM) {
+        _rejected++;
+        return false;
+    }
+
+    if (cm == DISTANCE_MAX_CM) {
+        if (_misses < DISTANCE_MISS_LIMIT)
+            _misses++;
+        if (_misses < DISTANCE_MISS_LIMIT) {
+            _rejected++;
+            return false;       // no echo: unknown until enough of them agree
+        }
+    }
+    else
+        _misses = 0;
+
+    if (_count > 0 && (cm > _value + DISTANCE_JUMP_CM || cm + DISTANCE_JUMP_CM < _value)) {
+        if (!_havePending || cm > _pending + DISTANCE_JUMP_CM || cm + DISTANCE_JUMP_CM < _pending) {
+            _pending = cm;          // hold it back until the next reading agrees
+            _havePending = true;
+            _agreed = 1;
+            _rejected++;
+            return false;
+        }
+
+        // clearing an obstacle by mistake is the dangerous side, a step away from it needs one more reading
+        if (_obstacle && cm > _value && _agreed < DISTANCE_CLEAR_AGREE) {
+            _agreed++;
+            _rejected++;
+            return false;
+        }
+
+        push(_pending);
+    }
+
+    _havePending = false;
+    push(cm);
+
+    // median of the readings so far (insertion sort of at most DISTANCE_MEDIAN values)
+    uint16_t    sorted[DISTANCE_MEDIAN];
+
+    for (uint8_t i = 0; i < _count; i++) {
+        uint16_t    v = _window[i];
+        uint8_t     j = i;
+
+        for (; j > 0 && sorted[j - 1] > v; j--)
+            sorted[j] = sorted[j - 1];
+        sorted[j] = v;
+    }
+
+    _value = sorted[_count / 2];
+
+    bool    obstacle = _obstacle;
+
+    if (!_obstacle && _value < _threshold)
+        obstacle = true;
+    else
+    if (_obstacle && _value > _threshold + _hysteresis)
+        obstacle = false;
+
+    if (obstacle == _obstacle)
+        return false;
+
+    _obstacle = obstacle;
+    return true;
+}
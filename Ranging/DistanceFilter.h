@@ -0,0 +1,57 @@
+#ifndef DISTANCE_FILTER_H_
+#define DISTANCE_FILTER_H_
+
+#include <stdint.h>
+
+#define DISTANCE_MIN_CM     2       // HC-SR04 blind zone
+#define DISTANCE_MAX_CM     400     // HC-SR04 range, also reported when no echo came back
+#define DISTANCE_MISS_LIMIT 5       // consecutive missing echoes before the range is taken as clear
+#define DISTANCE_MEDIAN     3       // median window, odd
+#define DISTANCE_JUMP_CM    20      // readings further than this from the current value need confirmation
+#define DISTANCE_CLEAR_AGREE 2      // agreeing jump readings before a step away from an obstacle is taken
+
+/**
+ * Median filter and obstacle detector for the ultrasonic distance stream.
+ *
+ * Readings outside the sensor's range (blind zone, glitches) are dropped.
+ * A reading that jumps away from the current value is held back until the
+ * next reading confirms it, so isolated spikes never reach the median.
+ * While an obstacle is flagged a step away from it needs a third agreeing
+ * reading, two spikes of similar length in a row must not clear it.
+ * A missing echo is unknown, not far: it leaves the median alone and only a
+ * run of DISTANCE_MISS_LIMIT of them is taken as a clear range, so dropouts
+ * in front of an obstacle cannot clear it. The obstacle flag is set when the filtered
+ * distance falls below the threshold and cleared when it rises above the
+ * threshold plus hysteresis.
+ *
+ * Free of mbed dependencies, it runs unchanged in the host simulation.
+ */
+class DistanceFilter
+{
+    uint16_t    _window[DISTANCE_MEDIAN];
+    uint8_t     _count;
+    uint8_t     _next;
+    uint16_t    _value;
+    uint16_t    _pending;
+    bool        _havePending;
+    uint8_t     _agreed;
+    bool        _obstacle;
+    uint16_t    _threshold;
+    uint16_t    _hysteresis;
+    uint32_t    _rejected;
+    uint8_t     _misses;
+
+    void    push(uint16_t cm);
+
+public:
+    DistanceFilter(uint16_t threshold_cm = 10, uint16_t hysteresis_cm = 3);
+
+    void        reset(void);
+    bool        add(uint16_t cm);
+    void        setThreshold(uint16_t threshold_cm, uint16_t hysteresis_cm);
+
+    uint16_t    value(void) const { return _value; }
+    bool        obstacle(void) const { return _obstacle; }
+    uint32_t    rejected(void) const { return _rejected; }
+};
+#endif /* DISTANCE_FILTER_H_ */
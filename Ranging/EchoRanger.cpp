@@ -0,0 +1,125 @@
+#include "EchoRanger.h"
+#include "TraceRing.h"
+
+/**
+ * @brief   Constructs an HC-SR04 ranger.
+ * @note    start() begins the measurements.
+ * @param   triggerPin: pin connected to TRIG
+ * @param   echoPin:    pin connected to ECHO (interrupt capable)
+ * @param   period_us:  time between two pings
+ * @retval
+ */
+EchoRanger::EchoRanger(PinName triggerPin, PinName echoPin, uint32_t period_us /*= ECHO_RANGER_PERIOD_US*/) :
+    _trigger(triggerPin, 0),
+    _echo(echoPin),
+    _period_us(period_us),
+    _rise_us(0),
+    _waiting(false),
+    _measurements(0),
+    _timeouts(0),
+    _onObstacle(NULL)
+{ }
+
+/**
+ * @brief   Starts pinging at the configured cadence.
+ * @note
+ * @param
+ * @retval
+ */
+void EchoRanger::start(void)
+{
+    _timer.start();
+    _echo.rise(callback(this, &EchoRanger::echoRise));
+    _echo.fall(callback(this, &EchoRanger::echoFall));
+    _ticker.attach_us(callback(this, &EchoRanger::ping), _period_us);
+}
+
+/**
+ * @brief   Stops pinging.
+ * @note
+ * @param
+ * @retval
+ */
+void EchoRanger::stop(void)
+{
+    _ticker.detach();
+    _echo.rise(NULL);
+    _echo.fall(NULL);
+    _timer.stop();
+}
+
+/**
+ * @brief   Sets the obstacle handler.
+ * @note    The handler runs in interrupt context, keep it short.
+ * @param   handler:        called with true when an obstacle appears, false when it's gone
+ * @param   threshold_cm:   obstacle distance
+ * @param   hysteresis_cm:  margin before the obstacle is considered gone
+ * @retval
+ */
+void EchoRanger::onObstacle(void (*handler)(bool present), uint16_t threshold_cm, uint16_t hysteresis_cm /*= 3*/)
+{
+    _filter.setThreshold(threshold_cm, hysteresis_cm);
+    _onObstacle = handler;
+}
+
+/**
+ * @brief   Ticker handler, emits a 10 us trigger pulse.
+ * @note    An echo still pending from the previous ping is counted as a
+ *          timeout. The sensor didn't answer at all, so nothing is known
+ *          about the distance and the filter isn't fed.
+ * @param
+ * @retval
+ */
+void EchoRanger::ping(void)
+{
+    if (_waiting)
+        _timeouts++;
+
+    _waiting = true;
+    _trigger = 1;
+    wait_us(10);
+    _trigger = 0;
+}
+
+/**
+ * @brief   Echo rising edge, the sound burst has left.
+ * @note
+ * @param
+ * @retval
+ */
+void EchoRanger::echoRise(void)
+{
+    _rise_us = _timer.read_us();
+}
+
+/**
+ * @brief   Echo falling edge, the echo came back.
+ * @note
+ * @param
+ * @retval
+ */
+void EchoRanger::echoFall(void)
+{
+    if (!_waiting)
+        return;     // stray edge
+
+    uint32_t    cm = ((uint32_t)_timer.read_us() - _rise_us) / ECHO_US_PER_CM;
+
+    // the sensor answers a ~38 ms pulse when nothing reflects, that is far away, not an error
+    _waiting = false;
+    TRACE_MARK(TP_RANGER_ECHO, cm > DISTANCE_MAX_CM ? DISTANCE_MAX_CM : cm);
+    add(cm > DISTANCE_MAX_CM ? DISTANCE_MAX_CM : cm);
+}
+
+/**
+ * @brief   Feeds a reading to the filter and fires the obstacle handler.
+ * @note
+ * @param
+ * @retval
+ */
+void EchoRanger::add(uint16_t cm)
+{
+    _measurements++;
+    if (_filter.add(cm) && _onObstacle != NULL)
+        _onObstacle(_filter.obstacle());
+}
@@ -0,0 +1,67 @@
+#ifndef ECHO_RANGER_H_
+#define ECHO_RANGER_H_
+
+#include "mbed.h"
+#include "DistanceFilter.h"
+
+#define ECHO_RANGER_PERIOD_US   60000   // HC-SR04 needs ~60 ms between pings
+#define ECHO_US_PER_CM          58      // round trip time of sound per cm
+
+/**
+ * Interrupt driven HC-SR04 ultrasonic ranger.
+ *
+ * A Ticker fires the trigger pulse at a fixed cadence, the echo pulse width
+ * is timestamped on both edges by InterruptIn, so the main loop never waits
+ * for a measurement. Every reading goes through a DistanceFilter; the
+ * obstacle handler is called from the echo interrupt as soon as the filtered
+ * distance crosses the threshold, i.e. within one ping period of the
+ * obstacle being confirmed.
+ *
+ * Example of use:
+ *
+ * @code
+ *
+ * EchoRanger  ranger(p29, p30);   // trigger, echo
+ *
+ * void obstacle(bool present) { ... }  // runs in interrupt context
+ *
+ * ranger.onObstacle(obstacle, 10);
+ * ranger.start();
+ * while (1)
+ *     pc.printf("%u cm\r\n", ranger.distance_cm());
+ *
+ * @endcode
+ */
+class EchoRanger
+{
+    DigitalOut          _trigger;
+    InterruptIn         _echo;
+    Timer               _timer;
+    Ticker              _ticker;
+    DistanceFilter      _filter;
+    uint32_t            _period_us;
+    volatile uint32_t   _rise_us;
+    volatile bool       _waiting;
+    volatile uint32_t   _measurements;
+    volatile uint32_t   _timeouts;
+    void                (*_onObstacle)(bool present);
+
+    void    ping(void);
+    void    echoRise(void);
+    void    echoFall(void);
+    void    add(uint16_t cm);
+
+public:
+    EchoRanger(PinName triggerPin, PinName echoPin, uint32_t period_us = ECHO_RANGER_PERIOD_US);
+
+    void        start(void);
+    void        stop(void);
+    void        onObstacle(void (*handler)(bool present), uint16_t threshold_cm, uint16_t hysteresis_cm = 3);
+
+    uint16_t    distance_cm(void) const { return _filter.value(); }
+    bool        obstacle(void) const { return _filter.obstacle(); }
+    uint32_t    measurements(void) const { return _measurements; }
+    uint32_t    timeouts(void) const { return _timeouts; }
+    uint32_t    rejected(void) const { return _filter.rejected(); }
+};
+#endif /* ECHO_RANGER_H_ */
@@ -0,0 +1,115 @@
+#include "SafeState.h"
+
+/**
+ * @brief   Constructs the safe state.
+ * @note
+ * @param   shutdown:   steps run in order when the safe state is entered
+ * @param   steps:      number of steps
+ * @param   wake_ms:    wakeup period
+ * @retval
+ */
+SafeState::SafeState(const SafeStep* shutdown, uint8_t steps, uint32_t wake_ms /*= SAFE_WAKE_MS*/) :
+    _shutdown(shutdown),
+    _steps(steps),
+    _wake_ms(wake_ms),
+    _woken(false),
+    _active(false),
+    _onWake(NULL),
+    _hazard(NULL),
+    _waking(false),
+    _wakeups(0),
+    _interrupts(0),
+    _awake_us(0),
+    _maxWake_us(0)
+{ }
+
+/**
+ * @brief   Ticker handler.
+ * @note
+ * @param
+ * @retval
+ */
+void SafeState::wake(void)
+{
+    _woken = true;
+}
+
+/**
+ * @brief   Average time awake per wakeup since the safe state was entered.
+ * @note    The duty cycle is wake_us() / (wake_ms * 1000).
+ * @param
+ * @retval  us
+ */
+uint32_t SafeState::wake_us(void)
+{
+    uint64_t    awake = _awake_us + (_waking ? _timer.read_us() : 0);
+
+    return _wakeups ? (uint32_t)(awake / _wakeups) : 0;
+}
+
+/**
+ * @brief   Longest wakeup since the safe state was entered.
+ * @note
+ * @param
+ * @retval  us
+ */
+uint32_t SafeState::maxWake_us(void)
+{
+    uint32_t    awake = _waking ? _timer.read_us() : 0;
+
+    return awake > _maxWake_us ? awake : _maxWake_us;
+}
+
+/**
+ * @brief   Shuts down and stays in the safe state until the hazard is gone.
+ * @note    Blocks. Without a hazard handler it never returns.
+ * @param
+ * @retval
+ */
+void SafeState::run(void)
+{
+    for (uint8_t i = 0; i < _steps; i++)
+        if (_shutdown[i])
+            _shutdown[i]();
+
+    _active = true;
+    _wakeups = 0;
+    _interrupts = 0;
+    _awake_us = 0;
+    _maxWake_us = 0;
+    _woken = false;
+    _timer.start();
+    _ticker.attach_us(callback(this, &SafeState::wake), _wake_ms * 1000);
+
+    while (1) {
+        // whatever else woke the core (UART) goes back to sleep after its interrupt
+        while (!_woken) {
+            sleep();
+            if (!_woken)
+                _interrupts++;
+        }
+        _woken = false;
+
+        _timer.reset();
+        _waking = true;
+        _wakeups++;
+
+        if (_onWake)
+            _onWake();
+        bool    hazard = _hazard ? _hazard() : true;
+
+        uint32_t    awake = _timer.read_us();
+
+        _waking = false;
+        _awake_us += awake;
+        if (awake > _maxWake_us)
+            _maxWake_us = awake;
+
+        if (!hazard)
+            break;
+    }
+
+    _ticker.detach();
+    _timer.stop();
+    _active = false;
+}
@@ -0,0 +1,76 @@
+#ifndef SAFE_STATE_H_
+#define SAFE_STATE_H_
+
+#include "mbed.h"
+
+#define SAFE_WAKE_MS    1000    // wakeup period in the safe state
+
+/**
+ * Low power safe state the board falls back to in an emergency it cannot
+ * handle, e.g. a flood.
+ *
+ * run() executes the shutdown steps in the given order, then sleeps and
+ * wakes every 'wake_ms' to run the wake handler (check the sensors, beacon
+ * alerts) until the hazard handler reports the hazard gone. The time spent
+ * awake per wakeup is measured, average and longest, so the duty cycle of
+ * the safe state is known. A call from the wake handler includes the part of
+ * the current wakeup so far.
+ *
+ * On the LPC1768 the microsecond ticker stops in deep sleep and only the RTC
+ * could wake the chip, so the wakeups use sleep(): the core clock is gated
+ * and any interrupt (the wake ticker, the phone UART) resumes it. The other
+ * interrupts that wake the core (e.g. a watchdog ticker, UART bytes) are
+ * counted by interrupts(), the time their handlers take is not part of the
+ * awake time.
+ *
+ * Example of use:
+ *
+ * @code
+ *
+ * const SafeStep  shutdown[] = { silence, park_servos, heating_off, sensors_off };
+ * SafeState       safe(shutdown, 4);
+ *
+ * bool flooded() { return water.flooded(); }
+ * void beacon() { water.burst(); phone.poll(); }
+ *
+ * safe.onWake(beacon);
+ * safe.onHazard(flooded);
+ * safe.run();                 // returns once the water is gone
+ *
+ * @endcode
+ */
+typedef void (*SafeStep)(void);
+
+class SafeState
+{
+    const SafeStep*     _shutdown;
+    uint8_t             _steps;
+    uint32_t            _wake_ms;
+    Ticker              _ticker;
+    Timer               _timer;
+    volatile bool       _woken;
+    bool                _active;
+    void                (*_onWake)(void);
+    bool                (*_hazard)(void);
+    bool                _waking;
+    uint32_t            _wakeups;
+    uint32_t            _interrupts;
+    uint64_t            _awake_us;
+    uint32_t            _maxWake_us;
+
+    void    wake(void);
+
+public:
+    SafeState(const SafeStep* shutdown, uint8_t steps, uint32_t wake_ms = SAFE_WAKE_MS);
+
+    void        onWake(void (*handler)(void)) { _onWake = handler; }
+    void        onHazard(bool (*hazard)(void)) { _hazard = hazard; }
+    void        run(void);
+
+    bool        active(void) const { return _active; }
+    uint32_t    wakeups(void) const { return _wakeups; }
+    uint32_t    interrupts(void) const { return _interrupts; }
+    uint32_t    wake_us(void);
+    uint32_t    maxWake_us(void);
+};
+#endif /* SAFE_STATE_H_ */
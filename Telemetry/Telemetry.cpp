@@ -0,0 +1,252 @@
+#include "Telemetry.h"
+
+/**
+ * @brief   Constructs a telemetry encoder sending over 'serial'.
+ * @note    The first update() is always a keyframe.
+ * @param   serial: serial port connected to the monitoring PC
+ * @retval
+ */
+Telemetry::Telemetry(Serial& serial) :
+    _serial(serial),
+    _encoder(_frame, sizeof(_frame)),
+    _seq(0),
+    _framesToKeyframe(0),
+    _bytesSent(0)
+{
+    memset(&_last, 0, sizeof(_last));
+}
+
+/**
+ * @brief   Starts a frame with the version and sequence number header.
+ * @note
+ * @param
+ * @retval
+ */
+void Telemetry::beginFrame(void)
+{
+    _encoder.begin();
+    _encoder.put(TELEMETRY_VERSION);
+    _encoder.put(_seq++);
+}
+
+/**
+ * @brief   Closes the current frame and writes it to the serial port.
+ * @note
+ * @param
+ * @retval
+ */
+void Telemetry::sendFrame(void)
+{
+    size_t  len = _encoder.finish();
+
+    TRACE_BEGIN_ARG(TP_TELEMETRY_TX, len);
+    for (size_t i = 0; i < len; i++)
+        _serial.putc(_frame[i]);
+    _bytesSent += len;
+    TRACE_END(TP_TELEMETRY_TX, 0);
+}
+
+/**
+ * @brief   Announces a (re)started board.
+ * @note    Also forces the next update() to be a keyframe.
+ * @param
+ * @retval
+ */
+void Telemetry::boot(void)
+{
+    beginFrame();
+    _encoder.put(TLM_TAG(TLM_BOOT, 1));
+    _encoder.put(TELEMETRY_VERSION);
+    sendFrame();
+    _framesToKeyframe = 0;
+}
+
+/**
+ * @brief   Reports the current state of the house.
+ * @note    Only the records that differ from the last frame are sent.
+ *          Nothing is transmitted when nothing changed and no keyframe is due.
+ *          Every TELEMETRY_KEYFRAME_INTERVAL calls a full keyframe is sent.
+ * @param   sample: current state
+ * @retval
+ */
+void Telemetry::update(const TelemetrySample& sample)
+{
+    bool    key = (_framesToKeyframe == 0);
+    bool    any = false;
+
+    beginFrame();
+
+    if (key || sample.temp_centi != _last.temp_centi) {
+        _encoder.put(TLM_TAG(TLM_TEMPERATURE, 2));
+        _encoder.put16((uint16_t)sample.temp_centi);
+        any = true;
+    }
+
+    if (key || sample.water != _last.water) {
+        _encoder.put(TLM_TAG(TLM_WATER, 2));
+        _encoder.put16(sample.water);
+        any = true;
+    }
+
+    if (key || sample.distance_cm != _last.distance_cm) {
+        _encoder.put(TLM_TAG(TLM_DISTANCE, 2));
+        _encoder.put16(sample.distance_cm);
+        any = true;
+    }
+
+    if (key || sample.garage_pos != _last.garage_pos || sample.garage_mode != _last.garage_mode) {
+        _encoder.put(TLM_TAG(TLM_GARAGE, 2));
+        _encoder.put(sample.garage_pos);
+        _encoder.put(sample.garage_mode);
+        any = true;
+    }
+
+    if (key || sample.mode != _last.mode) {
+        _encoder.put(TLM_TAG(TLM_MODE, 1));
+        _encoder.put(sample.mode);
+        any = true;
+    }
+
+    if (key || sample.alarm_type != _last.alarm_type || sample.alarm_active != _last.alarm_active) {
+        _encoder.put(TLM_TAG(TLM_ALARM, 2));
+        _encoder.put(sample.alarm_type);
+        _encoder.put(sample.alarm_active);
+        any = true;
+    }
+
+    if (key || sample.app_out != _last.app_out || sample.app_in != _last.app_in) {
+        _encoder.put(TLM_TAG(TLM_APP_LINK, 2));
+        _encoder.put(sample.app_out);
+        _encoder.put(sample.app_in);
+        any = true;
+    }
+
+    if (key) {
+        _encoder.put(TLM_TAG(TLM_ACTUATORS, 8));
+        _encoder.put32(sample.actuator_writes);
+        _encoder.put32(sample.actuator_suppressed);
+    }
+
+    _framesToKeyframe = key ? TELEMETRY_KEYFRAME_INTERVAL : _framesToKeyframe - 1;
+    if (!any) {
+        _seq--;     // nothing to say, the frame is dropped
+        return;
+    }
+
+    sendFrame();
+    _last = sample;
+}
+
+/**
+ * @brief   Reports a device error right away.
+ * @note
+ * @param   device: TLM_DEV_xxx
+ * @param   code:   device specific error code (e.g. DS1820::read() result)
+ * @retval
+ */
+void Telemetry::fault(uint8_t device, uint8_t code)
+{
+    beginFrame();
+    _encoder.put(TLM_TAG(TLM_FAULT, 2));
+    _encoder.put(device);
+    _encoder.put(code);
+    sendFrame();
+}
+
+/**
+ * @brief   Reports the safe state, sent on its own like a fault.
+ * @note
+ * @param   active:         the board is in the safe state
+ * @param   wake_us:        average time awake per wakeup
+ * @param   maxWake_us:     longest wakeup
+ * @param   alert_ms:       latency of the last acked alert
+ * @param   wakeups:        wakeups since the safe state was entered
+ * @param   interrupts:     other interrupts that woke the core meanwhile
+ * @retval
+ */
+void Telemetry::safeState(bool active, uint16_t wake_us, uint16_t maxWake_us, uint16_t alert_ms,
+                          uint32_t wakeups, uint32_t interrupts)
+{
+    beginFrame();
+    _encoder.put(TLM_TAG(TLM_SAFE_STATE, 15));
+    _encoder.put(active ? 1 : 0);
+    _encoder.put16(wake_us);
+    _encoder.put16(maxWake_us);
+    _encoder.put16(alert_ms);
+    _encoder.put32(wakeups);
+    _encoder.put32(interrupts);
+    sendFrame();
+}
+
+/**
+ * @brief   Reports the loop deadline monitor, sent on its own like a fault.
+ * @note
+ * @param   cause:      of the last reset
+ * @param   stalled:    task that hung before the last reset
+ * @param   resets:     stall and watchdog resets
+ * @param   task:       task the counters are about
+ * @param   overruns:   passes of the task over its budget
+ * @param   worst_us:   longest time of the task past its budget
+ * @retval
+ */
+void Telemetry::loop(uint8_t cause, uint8_t stalled, uint16_t resets, uint8_t task, uint16_t overruns, uint32_t worst_us)
+{
+    beginFrame();
+    _encoder.put(TLM_TAG(TLM_LOOP, 11));
+    _encoder.put(cause);
+    _encoder.put(stalled);
+    _encoder.put16(resets);
+    _encoder.put(task);
+    _encoder.put16(overruns);
+    _encoder.put32(worst_us);
+    sendFrame();
+}
+
+/**
+ * @brief   Reports the error counters of a 1-Wire device, sent on its own like a fault.
+ * @note
+ * @param   device:             number of the device, 0xFF for the bus
+ * @param   quarantined:        the device is left alone for a while
+ * @param   presence_failures:  attempts without a presence pulse
+ * @param   crc_errors:         attempts that read a bad CRC
+ * @param   retries:            attempts that were retries
+ * @param   quarantines:        times the device was put in quarantine
+ * @param   skipped:            transactions not tried because of a quarantine
+ * @retval
+ */
+void Telemetry::oneWire(uint8_t device, bool quarantined, uint16_t presence_failures, uint16_t crc_errors,
+                        uint16_t retries, uint16_t quarantines, uint16_t skipped)
+{
+    beginFrame();
+    _encoder.put(TLM_TAG(TLM_ONEWIRE, 12));
+    _encoder.put(device);
+    _encoder.put(quarantined ? 1 : 0);
+    _encoder.put16(presence_failures);
+    _encoder.put16(crc_errors);
+    _encoder.put16(retries);
+    _encoder.put16(quarantines);
+    _encoder.put16(skipped);
+    sendFrame();
+}
+
+#if HOUSE_TRACE
+/**
+ * @brief   Sends events of a trace dump, on their own like a fault.
+ * @note    At most TELEMETRY_TRACE_EVENTS events fit in a frame.
+ * @param   events: events read out of the trace ring
+ * @param   count:  number of events
+ * @retval
+ */
+void Telemetry::trace(const TraceEvent* events, uint8_t count)
+{
+    beginFrame();
+    for (uint8_t i = 0; i < count && i < TELEMETRY_TRACE_EVENTS; i++) {
+        _encoder.put(TLM_TAG(TLM_TRACE, 8));
+        _encoder.put32(events[i].cycles);
+        _encoder.put(events[i].point);
+        _encoder.put(events[i].kind);
+        _encoder.put16(events[i].arg);
+    }
+    sendFrame();
+}
+#endif
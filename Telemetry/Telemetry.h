@@ -0,0 +1,78 @@
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include "mbed.h"
+#include "Framing.h"
+#include "TelemetryProtocol.h"
+#include "TraceRing.h"
+
+/**
+ * Snapshot of everything the board reports. Fields are already in their
+ * wire representation so encoding is a plain copy.
+ */
+struct TelemetrySample
+{
+    int16_t     temp_centi;     // 1/100 C
+    uint16_t    water;          // raw ADC reading
+    uint16_t    distance_cm;
+    uint8_t     garage_pos;     // 0..100
+    uint8_t     garage_mode;
+    uint8_t     mode;           // TLM_MODE_xxx
+    uint8_t     alarm_type;
+    uint8_t     alarm_active;
+    uint8_t     app_out;
+    uint8_t     app_in;
+    uint32_t    actuator_writes;
+    uint32_t    actuator_suppressed;
+};
+
+/**
+ * Binary telemetry encoder for the pc serial channel.
+ * See TelemetryProtocol.h for the wire format.
+ *
+ * Example of use:
+ *
+ * @code
+ *
+ * Serial          pc(USBTX, USBRX);
+ * Telemetry       telemetry(pc);
+ * TelemetrySample sample;
+ *
+ * telemetry.boot();
+ * while (1) {
+ *     sample.temp_centi = ...;
+ *     telemetry.update(sample);   // sends only what changed
+ * }
+ *
+ * @endcode
+ */
+class Telemetry
+{
+    Serial&         _serial;
+    uint8_t         _frame[FRAMING_MAX_ENCODED(TELEMETRY_MAX_PAYLOAD)];
+    CobsEncoder     _encoder;
+    TelemetrySample _last;
+    uint8_t         _seq;
+    uint8_t         _framesToKeyframe;
+    uint32_t        _bytesSent;
+
+    void    beginFrame(void);
+    void    sendFrame(void);
+
+public:
+    Telemetry(Serial& serial);
+
+    void        boot(void);
+    void        update(const TelemetrySample& sample);
+    void        fault(uint8_t device, uint8_t code);
+    void        safeState(bool active, uint16_t wake_us, uint16_t maxWake_us, uint16_t alert_ms,
+                          uint32_t wakeups, uint32_t interrupts);
+    void        loop(uint8_t cause, uint8_t stalled, uint16_t resets, uint8_t task, uint16_t overruns, uint32_t worst_us);
+    void        oneWire(uint8_t device, bool quarantined, uint16_t presence_failures, uint16_t crc_errors,
+                        uint16_t retries, uint16_t quarantines, uint16_t skipped);
+#if HOUSE_TRACE
+    void        trace(const TraceEvent* events, uint8_t count);
+#endif
+    uint32_t    bytesSent(void) const { return _bytesSent; }
+};
+#endif /* TELEMETRY_H_ */
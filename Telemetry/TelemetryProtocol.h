@@ -0,0 +1,100 @@
+#ifndef TELEMETRY_PROTOCOL_H_
+#define TELEMETRY_PROTOCOL_H_
+
+#include <stdint.h>
+
+/*
+Binary telemetry sent over the pc serial channel.
+
+Every frame is framed by Framing.h (COBS + CRC-16) and its payload is:
+
+    version(1) seq(1) record record ...
+
+A record is a tag byte followed by a fixed size payload. The high nibble of
+the tag is the record type, the low nibble is the payload length, so a
+decoder can skip record types it does not know. All multi-byte fields are
+little-endian.
+
+Record                    payload
+TLM_TEMPERATURE   (0x1)   int16  temperature in 1/100 C
+TLM_WATER         (0x2)   uint16 raw water sensor reading (0..65535)
+TLM_DISTANCE      (0x3)   uint16 ultrasonic distance in cm
+TLM_GARAGE        (0x4)   uint8  door position 0..100, uint8 garage mode
+TLM_MODE          (0x5)   uint8  house mode (TLM_MODE_xxx, same values as HouseMode)
+TLM_ALARM         (0x6)   uint8  alarm type character, uint8 active flag
+TLM_FAULT         (0x7)   uint8  device (TLM_DEV_xxx), uint8 error code (TLM_FAULT_xxx)
+TLM_APP_LINK      (0x8)   uint8  last command from the phone, uint8 last status sent to it
+TLM_BOOT          (0x9)   uint8  firmware protocol version
+TLM_ACTUATORS     (0xA)   uint32 actuator writes, uint32 writes suppressed (no change)
+TLM_SAFE_STATE    (0xB)   uint8  active flag, uint16 average us awake per wakeup,
+                          uint16 longest wakeup in us, uint16 last alert
+                          latency in ms, uint32 wakeups, uint32 other
+                          interrupts that woke the core (see SafeState.h)
+TLM_TRACE         (0xC)   uint32 DWT cycles, uint8 trace point, uint8 kind,
+                          uint16 argument (see TraceRing.h)
+TLM_LOOP          (0xD)   uint8  cause of the last reset, uint8 task that hung,
+                          uint16 stall and watchdog resets, uint8 task,
+                          uint16 overruns of the task, uint32 its worst overrun
+                          in us (see LoopMonitor.h, task 0xFF: none)
+TLM_ONEWIRE       (0xE)   uint8  device (0xFF: the bus), uint8 quarantined flag,
+                          uint16 presence failures, uint16 CRC errors,
+                          uint16 retries, uint16 quarantines, uint16
+                          transactions skipped (see OneWireHealth.h)
+
+Only the records that changed since the previous frame are sent, every
+TELEMETRY_KEYFRAME_INTERVAL reports all records are repeated so a receiver
+that joined late catches up. TLM_ACTUATORS is only sent in keyframes,
+TLM_SAFE_STATE only on its own while the board is in its safe state.
+TLM_TRACE records only come in the frames of a trace dump, requested by
+sending 'T' to the board (builds with HOUSE_TRACE=1 only).
+TLM_LOOP is sent on its own after TLM_BOOT, then whenever a task of the
+control loop goes over its time budget. TLM_ONEWIRE is sent on its own
+when a 1-Wire transaction fails or is retried and when a quarantine ends.
+*/
+
+#define TELEMETRY_VERSION           1
+#define TELEMETRY_MAX_PAYLOAD       48
+#define TELEMETRY_KEYFRAME_INTERVAL 20
+#define TELEMETRY_TRACE_EVENTS      5   // TLM_TRACE records in a frame
+
+#define TLM_TAG(type, len)      (uint8_t)(((type) << 4) | ((len) & 0x0F))
+#define TLM_TAG_TYPE(tag)       ((tag) >> 4)
+#define TLM_TAG_LEN(tag)        ((tag) & 0x0F)
+
+enum TelemetryRecord {
+    TLM_TEMPERATURE = 0x1,
+    TLM_WATER       = 0x2,
+    TLM_DISTANCE    = 0x3,
+    TLM_GARAGE      = 0x4,
+    TLM_MODE        = 0x5,
+    TLM_ALARM       = 0x6,
+    TLM_FAULT       = 0x7,
+    TLM_APP_LINK    = 0x8,
+    TLM_BOOT        = 0x9,
+    TLM_ACTUATORS   = 0xA,
+    TLM_SAFE_STATE  = 0xB,
+    TLM_TRACE       = 0xC,
+    TLM_LOOP        = 0xD,
+    TLM_ONEWIRE     = 0xE
+};
+
+enum TelemetryMode {
+    TLM_MODE_NORMAL     = 0,
+    TLM_MODE_ECO        = 1,
+    TLM_MODE_SECURITY   = 2,
+    TLM_MODE_FIRE       = 3,
+    TLM_MODE_FLOOD      = 4
+};
+
+enum TelemetryDevice {
+    TLM_DEV_DS1820      = 0x01
+};
+
+// Error codes of TLM_DEV_DS1820, 1..3 are the OneWireResult codes
+enum TelemetryFault {
+    TLM_FAULT_NO_PRESENCE   = 1,
+    TLM_FAULT_CRC_ERROR     = 2,
+    TLM_FAULT_QUARANTINED   = 3,    // the sensor went into quarantine, no readings until TLM_FAULT_RELEASED
+    TLM_FAULT_RELEASED      = 4     // the quarantine is over, the sensor is tried again
+};
+#endif /* TELEMETRY_PROTOCOL_H_ */
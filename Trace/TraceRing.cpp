@@ -0,0 +1,102 @@
+#include "TraceRing.h"
+
+#if HOUSE_TRACE
+#include "mbed.h"
+
+TraceRing   trace_ring;
+
+/**
+ * @brief   Constructs an empty ring and starts the DWT cycle counter.
+ * @note
+ * @param
+ * @retval
+ */
+TraceRing::TraceRing() :
+    _head(0),
+    _read(0),
+    _left(0),
+    _mark(false),
+    _dumping(false)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+ * @brief   Adds an event stamped with the cycle counter.
+ * @note    Safe from interrupts, does nothing while a dump is read out.
+ * @param   point:  TP_xxx
+ * @param   kind:   TRACE_KIND_xxx
+ * @param   arg:    point specific value
+ * @retval
+ */
+void TraceRing::record(uint8_t point, uint8_t kind, uint16_t arg)
+{
+    if (_dumping)
+        return;
+
+    uint32_t    primask = __get_PRIMASK();
+
+    __disable_irq();
+
+    TraceEvent& e = _events[_head++ & (TRACE_RING_SIZE - 1)];
+
+    e.cycles = DWT->CYCCNT;
+    e.point = point;
+    e.kind = kind;
+    e.arg = arg;
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief   Freezes the ring and starts reading it out.
+ * @note    next() gives a TP_DUMP mark first, then the events from the oldest.
+ * @param
+ * @retval
+ */
+void TraceRing::dump(void)
+{
+    if (_dumping)
+        return;
+
+    uint32_t    primask = __get_PRIMASK();
+
+    __disable_irq();
+
+    // the mark takes a slot of the ring too
+    uint32_t    count = _head + 1 < TRACE_RING_SIZE ? _head + 1 : TRACE_RING_SIZE;
+
+    record(TP_DUMP, TRACE_KIND_MARK, (uint16_t)(count - 1));
+    _dumping = true;
+    _mark = true;
+    _read = _head - count;
+    _left = count - 1;
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief   Gets the next event of the dump.
+ * @note    The ring records again once the dump has been read out.
+ * @param   event: filled with the event
+ * @retval  false when the dump is over
+ */
+bool TraceRing::next(TraceEvent& event)
+{
+    if (!_dumping)
+        return false;
+
+    if (_mark) {
+        event = _events[(_head - 1) & (TRACE_RING_SIZE - 1)];
+        _mark = false;
+        return true;
+    }
+    if (_left == 0) {
+        _dumping = false;
+        return false;
+    }
+    event = _events[_read++ & (TRACE_RING_SIZE - 1)];
+    _left--;
+    return true;
+}
+#endif /* HOUSE_TRACE */
@@ -0,0 +1,105 @@
+#ifndef TRACE_RING_H_
+#define TRACE_RING_H_
+
+#include <stdint.h>
+
+/**
+ * Cycle-stamped trace points for field debugging.
+ *
+ * The drivers mark the start and the end of their bus transactions, sensor
+ * reads and serial writes, and the mode changes, with the TRACE_xxx macros
+ * below. Each event takes the DWT cycle counter of the Cortex-M3 (96 MHz,
+ * wraps every 44 s) and goes into a fixed ring in RAM, the oldest events
+ * are overwritten. A 'T' from the pc sends the ring out as TLM_TRACE
+ * telemetry records (see TelemetryProtocol.h), host/trace_view turns them
+ * into latency tables, timelines and flame graphs.
+ *
+ * Tracing is off unless the firmware is built with HOUSE_TRACE=1. Off, the
+ * macros are empty and the ring does not exist, so the trace points cost
+ * neither bytes nor cycles and stay in the production code.
+ */
+
+#ifndef HOUSE_TRACE
+#define HOUSE_TRACE         0
+#endif
+
+#ifndef TRACE_RING_SIZE
+#define TRACE_RING_SIZE     256     // events of 8 bytes, a power of two
+#endif
+
+/**
+ * What an event is about. New points go at the end, host/trace_view knows
+ * them by their value.
+ */
+enum TracePoint {
+    TP_DUMP             = 0,    // mark: start of a dump, arg = events that follow
+    TP_ONEWIRE_RESET    = 1,    // end arg: presence pulse seen
+    TP_DS1820_CONVERT   = 2,
+    TP_DS1820_READ      = 3,    // end arg: error code
+    TP_RANGER_ECHO      = 4,    // mark arg: distance in cm
+    TP_WATER_BURST      = 5,    // end arg: reading
+    TP_PIR              = 6,    // mark arg: zone << 8 | motion
+    TP_MODE             = 7,    // mark arg: old mode << 8 | new mode
+    TP_TELEMETRY_TX     = 8,    // begin arg: frame length
+    TP_PHONE_TX         = 9,    // begin arg: frame length
+    TP_COUNT
+};
+
+enum TraceKind {
+    TRACE_KIND_BEGIN    = 0,
+    TRACE_KIND_END      = 1,
+    TRACE_KIND_MARK     = 2
+};
+
+struct TraceEvent
+{
+    uint32_t    cycles;
+    uint8_t     point;
+    uint8_t     kind;
+    uint16_t    arg;
+};
+
+#if HOUSE_TRACE
+
+/**
+ * Ring of the last TRACE_RING_SIZE events.
+ * record() may be called from interrupts. While a dump is read out with
+ * next() nothing is recorded, so the dump does not trace itself.
+ */
+class TraceRing
+{
+    TraceEvent          _events[TRACE_RING_SIZE];
+    volatile uint32_t   _head;
+    uint32_t            _read;
+    uint32_t            _left;
+    bool                _mark;
+    volatile bool       _dumping;
+
+public:
+    TraceRing();
+
+    void        record(uint8_t point, uint8_t kind, uint16_t arg);
+    void        dump(void);
+    bool        next(TraceEvent& event);
+    bool        dumping(void) const { return _dumping; }
+
+private:
+    static_assert((TRACE_RING_SIZE & (TRACE_RING_SIZE - 1)) == 0, "TRACE_RING_SIZE must be a power of two");
+};
+
+extern TraceRing trace_ring;
+
+#define TRACE_BEGIN(point)          trace_ring.record((point), TRACE_KIND_BEGIN, 0)
+#define TRACE_BEGIN_ARG(point, arg) trace_ring.record((point), TRACE_KIND_BEGIN, (uint16_t)(arg))
+#define TRACE_END(point, arg)       trace_ring.record((point), TRACE_KIND_END, (uint16_t)(arg))
+#define TRACE_MARK(point, arg)      trace_ring.record((point), TRACE_KIND_MARK, (uint16_t)(arg))
+
+#else
+
+#define TRACE_BEGIN(point)          ((void)0)
+#define TRACE_BEGIN_ARG(point, arg) ((void)0)
+#define TRACE_END(point, arg)       ((void)0)
+#define TRACE_MARK(point, arg)      ((void)0)
+
+#endif /* HOUSE_TRACE */
+#endif /* TRACE_RING_H_ */
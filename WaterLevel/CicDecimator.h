@@ -0,0 +1,58 @@
+#ifndef CIC_DECIMATOR_H_
+#define CIC_DECIMATOR_H_
+
+#include <stdint.h>
+
+/**
+ * Second order CIC (cascaded integrator-comb) decimator for 16-bit samples.
+ *
+ * Two integrators run at the input rate, two combs at the output rate, the
+ * result is scaled back to 16 bits. That is a triangular moving average over
+ * 2R - 1 input samples using only additions; the integrators are allowed to
+ * wrap, modular arithmetic makes the combs cancel that out. R = 2^log2Rate,
+ * at most 2^8 so the R^2 gain still fits 32 bits.
+ */
+class CicDecimator
+{
+    uint32_t    _int1;
+    uint32_t    _int2;
+    uint32_t    _comb1;
+    uint32_t    _comb2;
+    uint16_t    _rate;
+    uint16_t    _phase;
+    uint8_t     _shift;
+
+public:
+    CicDecimator(uint8_t log2Rate) :
+        _int1(0), _int2(0), _comb1(0), _comb2(0),
+        _rate(1 << log2Rate), _phase(0), _shift(2 * log2Rate)
+    { }
+
+    /**
+     * @brief   Adds one input sample.
+     * @param   x:      input sample
+     * @param   out:    decimated sample, valid when true is returned
+     * @retval  true every R samples
+     */
+    bool add(uint16_t x, uint16_t& out)
+    {
+        _int1 += x;
+        _int2 += _int1;
+        if (++_phase < _rate)
+            return false;
+
+        _phase = 0;
+
+        uint32_t    c1 = _int2 - _comb1;
+        uint32_t    c2;
+
+        _comb1 = _int2;
+        c2 = c1 - _comb2;
+        _comb2 = c1;
+        out = (uint16_t)(c2 >> _shift);
+        return true;
+    }
+
+    uint16_t    rate(void) const { return _rate; }
+};
+#endif /* CIC_DECIMATOR_H_ */
@@ -0,0 +1,55 @@
+#include "FloodDetector.h"
+
+/**
+ * @brief   Constructs a flood detector.
+ * @note
+ * @param   onLevel:    level above which water is present
+ * @param   offLevel:   level below which the sensor is dry again (hysteresis)
+ * @param   debounce:   consecutive samples needed to change state
+ * @retval
+ */
+FloodDetector::FloodDetector(uint16_t onLevel, uint16_t offLevel, uint8_t debounce /*= 3*/) :
+    _onLevel(onLevel),
+    _offLevel(offLevel),
+    _debounce(debounce),
+    _onsets(0)
+{
+    reset();
+}
+
+/**
+ * @brief   Back to dry.
+ * @note
+ * @param
+ * @retval
+ */
+void FloodDetector::reset(void)
+{
+    _count = 0;
+    _flooded = false;
+}
+
+/**
+ * @brief   Adds a decimated water level sample.
+ * @note
+ * @param   level: filtered water level
+ * @retval  true on flood onset (rising edge only)
+ */
+bool FloodDetector::add(uint16_t level)
+{
+    bool    changing = _flooded ? (level < _offLevel) : (level > _onLevel);
+
+    if (!changing) {
+        _count = 0;
+        return false;
+    }
+
+    if (++_count < _debounce)
+        return false;
+
+    _count = 0;
+    _flooded = !_flooded;
+    if (_flooded)
+        _onsets++;
+    return _flooded;
+}
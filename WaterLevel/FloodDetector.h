@@ -0,0 +1,32 @@
+#ifndef FLOOD_DETECTOR_H_
+#define FLOOD_DETECTOR_H_
+
+#include <stdint.h>
+
+/**
+ * Debounced rising-edge detector on the decimated water level.
+ *
+ * The level has to stay above 'onLevel' for 'debounce' consecutive samples
+ * before a flood is declared, and below 'offLevel' for as many samples
+ * before it is cleared. A lone spike that survives the decimation filter is
+ * therefore never enough to raise the alarm.
+ */
+class FloodDetector
+{
+    uint16_t    _onLevel;
+    uint16_t    _offLevel;
+    uint8_t     _debounce;
+    uint8_t     _count;
+    bool        _flooded;
+    uint32_t    _onsets;
+
+public:
+    FloodDetector(uint16_t onLevel, uint16_t offLevel, uint8_t debounce = 3);
+
+    bool        add(uint16_t level);
+    void        reset(void);
+
+    bool        flooded(void) const { return _flooded; }
+    uint32_t    onsets(void) const { return _onsets; }
+};
+#endif /* FLOOD_DETECTOR_H_ */
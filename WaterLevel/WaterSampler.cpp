@@ -0,0 +1,78 @@
+#include "WaterSampler.h"
+#include "TraceRing.h"
+
+/**
+ * @brief   Constructs the water sampler.
+ * @note    start() begins sampling.
+ * @param   pin:        analog input connected to the water sensor
+ * @param   onLevel:    flood threshold (read_u16() units)
+ * @param   offLevel:   dry threshold (read_u16() units)
+ * @retval
+ */
+WaterSampler::WaterSampler(PinName pin, uint16_t onLevel, uint16_t offLevel) :
+    _adc(pin),
+    _cic(WATER_LOG2_DECIM),
+    _detector(onLevel, offLevel, WATER_DEBOUNCE),
+    _level(0),
+    _flooded(false),
+    _samples(0)
+{ }
+
+/**
+ * @brief   Starts sampling.
+ * @note    The mbed AnalogIn API has no burst or DMA mode, each sample is
+ *          a single conversion started from the Ticker interrupt.
+ * @param
+ * @retval
+ */
+void WaterSampler::start(void)
+{
+    _ticker.attach_us(callback(this, &WaterSampler::sample), 1000000 / WATER_SAMPLE_HZ);
+}
+
+/**
+ * @brief   Stops sampling, the last level and flood state are kept.
+ * @note
+ * @param
+ * @retval
+ */
+void WaterSampler::stop(void)
+{
+    _ticker.detach();
+}
+
+/**
+ * @brief   Takes one decimation period of samples right away.
+ * @note    For use while stopped, e.g. on a wakeup from sleep: gives one
+ *          new level and one step of the flood detector in ~1 ms.
+ * @param
+ * @retval  The new level
+ */
+uint16_t WaterSampler::burst(void)
+{
+    TRACE_BEGIN(TP_WATER_BURST);
+    for (int i = 0; i < (1 << WATER_LOG2_DECIM); i++)
+        sample();
+
+    TRACE_END(TP_WATER_BURST, _level);
+    return _level;
+}
+
+/**
+ * @brief   Ticker handler, one ADC sample.
+ * @note
+ * @param
+ * @retval
+ */
+void WaterSampler::sample(void)
+{
+    uint16_t    level;
+
+    _samples++;
+    if (!_cic.add(_adc.read_u16(), level))
+        return;
+
+    _level = level;
+    _detector.add(level);
+    _flooded = _detector.flooded();
+}
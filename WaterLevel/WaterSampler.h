@@ -0,0 +1,60 @@
+#ifndef WATER_SAMPLER_H_
+#define WATER_SAMPLER_H_
+
+#include "mbed.h"
+#include "CicDecimator.h"
+#include "FloodDetector.h"
+
+#define WATER_SAMPLE_HZ     1000    // ADC sample rate
+#define WATER_LOG2_DECIM    5       // decimation by 32 -> 31.25 Hz level stream
+#define WATER_DEBOUNCE      4       // decimated samples above the threshold for an onset
+
+/**
+ * Oversampled water sensor.
+ *
+ * A Ticker samples the ADC at WATER_SAMPLE_HZ, a second order CIC decimates
+ * by 32 and the FloodDetector runs on the 31.25 Hz output, all in interrupt
+ * context. A flood onset is recognised about WATER_DEBOUNCE decimated periods
+ * after the water reaches the sensor, ~130 ms (~150 ms worst case on the
+ * host/flood_eval traces). A single spike affects at most two decimated
+ * samples, so it can never raise the alarm on its own.
+ *
+ * Example of use:
+ *
+ * @code
+ *
+ * WaterSampler    water(p20, 655, 328);
+ *
+ * water.start();
+ * while (1) {
+ *     if (water.flooded())
+ *         ...
+ * }
+ *
+ * @endcode
+ */
+class WaterSampler
+{
+    AnalogIn            _adc;
+    Ticker              _ticker;
+    CicDecimator        _cic;
+    FloodDetector       _detector;
+    volatile uint16_t   _level;
+    volatile bool       _flooded;
+    volatile uint32_t   _samples;
+
+    void    sample(void);
+
+public:
+    WaterSampler(PinName pin, uint16_t onLevel, uint16_t offLevel);
+
+    void        start(void);
+    void        stop(void);
+    uint16_t    burst(void);
+
+    uint16_t    level(void) const { return _level; }
+    bool        flooded(void) const { return _flooded; }
+    uint32_t    samples(void) const { return _samples; }
+    uint32_t    onsets(void) const { return _detector.onsets(); }
+};
+#endif /* WATER_SAMPLER_H_ */
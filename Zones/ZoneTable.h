@@ -0,0 +1,165 @@
+#ifndef ZONE_TABLE_H_
+#define ZONE_TABLE_H_
+
+#include <stdint.h>
+
+/**
+ * House wide rules applied to every zone by ZoneTable::evaluate().
+ */
+struct ZoneRules
+{
+    uint32_t    light_ms;       // lights stay on this long after the last motion
+    bool        lights;         // false: all lights off (eco mode)
+    int16_t     fire_centi;     // over temperature alarm
+    uint16_t    water_level;    // flood alarm
+};
+
+/**
+ * State of N zones stored structure-of-arrays.
+ *
+ * Inputs (temperature, water level, time of the last motion), setpoints and
+ * actuator states are contiguous arrays, one entry per zone. A control tick
+ * runs each rule as a branch free loop over the arrays it needs, which the
+ * compiler can unroll and vectorize, so the cost grows linearly with N and
+ * stays cache friendly. The outputs that changed during the tick are kept
+ * too, so only those zones need their hardware written.
+ *
+ * The lights, climate and alarm rules can also be run on their own, a house
+ * that controls its climate and alarms elsewhere only pays for the lights.
+ * The climate setpoints are zero until the owner sets them.
+ *
+ * Free of mbed dependencies.
+ *
+ * Example of use:
+ *
+ * @code
+ *
+ * ZoneTable<16>   zones;
+ * ZoneRules       rules = { 10000, true, 5700, 655 };
+ *
+ * zones.temp_centi[3] = 2310;
+ * zones.motion(3, now_ms);
+ * zones.evaluate(now_ms, rules);
+ * for (uint32_t z = 0; z < 16; z++)
+ *     if (zones.test(zones.lights_changed, z))
+ *         light[z] = zones.test(zones.lights, z);
+ *
+ * @endcode
+ */
+template <uint32_t N>
+class ZoneTable
+{
+public:
+    // inputs
+    int16_t     temp_centi[N];
+    uint16_t    water[N];
+    uint32_t    motion_ms[N];
+    uint8_t     moved[N];       // the zone saw motion since boot
+
+    // setpoints
+    int16_t     heat_on[N];     // heater on below
+    int16_t     cool_on[N];     // aircon on above
+    int16_t     band[N];        // hysteresis, both off past setpoint +/- band
+
+    // outputs (0 or 1) and what changed at the last evaluate()
+    uint8_t     lights[N];
+    uint8_t     heater[N];
+    uint8_t     aircon[N];
+    uint8_t     fire[N];
+    uint8_t     flood[N];
+    uint8_t     lights_changed[N];
+    uint8_t     heater_changed[N];
+    uint8_t     aircon_changed[N];
+
+    ZoneTable()
+    {
+        for (uint32_t z = 0; z < N; z++) {
+            temp_centi[z] = 0;
+            water[z] = 0;
+            motion_ms[z] = 0;
+            moved[z] = 0;
+            heat_on[z] = 0;
+            cool_on[z] = 0;
+            band[z] = 0;
+            lights[z] = heater[z] = aircon[z] = fire[z] = flood[z] = 0;
+            lights_changed[z] = heater_changed[z] = aircon_changed[z] = 0;
+        }
+    }
+
+    static uint32_t size(void) { return N; }
+
+    static bool any(const uint8_t* flags)
+    {
+        uint8_t all = 0;
+
+        for (uint32_t z = 0; z < N; z++)
+            all |= flags[z];
+        return all != 0;
+    }
+
+    void motion(uint32_t zone, uint32_t now_ms)
+    {
+        motion_ms[zone] = now_ms;
+        moved[zone] = 1;
+    }
+
+    // all lights off until the next motion
+    void clearMotion(void)
+    {
+        for (uint32_t z = 0; z < N; z++) {
+            moved[z] = 0;
+            lights_changed[z] = lights[z];
+            lights[z] = 0;
+        }
+    }
+
+    /**
+     * One control tick over all zones, all rules.
+     * Each rule is a separate loop over only the arrays it reads, without
+     * data dependent branches.
+     */
+    void evaluate(uint32_t now_ms, const ZoneRules& rules)
+    {
+        evaluateLights(now_ms, rules);
+        evaluateClimate();
+        evaluateAlarms(rules);
+    }
+
+    // lights on while there was motion within rules.light_ms
+    void evaluateLights(uint32_t now_ms, const ZoneRules& rules)
+    {
+        uint8_t lightsOn = rules.lights ? 1 : 0;
+
+        for (uint32_t z = 0; z < N; z++) {
+            uint8_t l = lightsOn & moved[z] & (uint8_t)((now_ms - motion_ms[z]) < rules.light_ms);
+
+            lights_changed[z] = lights[z] ^ l;
+            lights[z] = l;
+        }
+    }
+
+    // on below the setpoint, stays on until setpoint + band
+    void evaluateClimate(void)
+    {
+        for (uint32_t z = 0; z < N; z++) {
+            int16_t t = temp_centi[z];
+            uint8_t h = (uint8_t)(t < heat_on[z]) | (heater[z] & (uint8_t)(t < heat_on[z] + band[z]));
+            uint8_t c = (uint8_t)(t > cool_on[z]) | (aircon[z] & (uint8_t)(t > cool_on[z] - band[z]));
+
+            heater_changed[z] = heater[z] ^ h;
+            aircon_changed[z] = aircon[z] ^ c;
+            heater[z] = h;
+            aircon[z] = c;
+        }
+    }
+
+    void evaluateAlarms(const ZoneRules& rules)
+    {
+        for (uint32_t z = 0; z < N; z++)
+            fire[z] = (uint8_t)(temp_centi[z] > rules.fire_centi);
+
+        for (uint32_t z = 0; z < N; z++)
+            flood[z] = (uint8_t)(water[z] > rules.water_level);
+    }
+};
+#endif /* ZONE_TABLE_H_ */
@@ -0,0 +1,201 @@
+/*
+Compares the climate control laws on a simulated room.
+
+The room is a first order thermal plant: it relaxes to the outdoor
+temperature with time constant TAU_S, full heater power lifts the
+equilibrium by HEAT_RISE degC and the aircon lowers it as much. The outdoor
+temperature follows a daily sine around a mean that sweeps from winter to
+summer over the simulated days. The DS1820 is read every 2 s with its
+1/16 degC resolution, exactly as smart_heating() does (every 10 s for the
+old logic).
+
+Evaluated:
+    legacy      today's logic, heater below 24 degC and aircon above 27 degC
+    hysteresis  HysteresisController pair through a ClimateZone
+    pid         PidController pair through a ClimateZone
+
+and the cost of one ClimateZone::update() call.
+
+Build:
+    g++ -O2 -I../../Climate -o climate_sim climate_sim.cpp ../../Climate/ClimateController.cpp ../../Climate/ClimateZone.cpp
+
+Use:
+    ./climate_sim [days]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "ClimateController.h"
+#include "ClimateZone.h"
+
+#define TAU_S           10800.0     // room time constant
+#define HEAT_RISE       25.0        // degC at full heater power
+#define COOL_DROP       15.0        // degC at full aircon power
+#define READ_S          2           // DS1820 read period in smart_heating()
+#define LEGACY_READ_S   10          // read period of the old logic
+#define COMFORT_LOW     24.0
+#define COMFORT_HIGH    27.0
+
+#define HEAT_SETPOINT   2425
+#define COOL_SETPOINT   2675
+#define BAND            100         // hysteresis band, kept inside the comfort range
+
+static const PidGains   gains = { PID_GAIN(20.0), PID_GAIN(0.02), PID_GAIN(0.0) };
+
+struct Result
+{
+    double  heat_h;
+    double  cool_h;
+    int     switches;
+    double  over;       // worst excursion above COMFORT_HIGH
+    double  under;      // worst excursion below COMFORT_LOW
+    double  outside_pct;
+};
+
+class Law
+{
+public:
+    virtual ~Law() {}
+    virtual int  period(void) { return READ_S; }
+    virtual void read(int16_t temp_centi) = 0;
+    virtual void outputs(uint32_t now_ms, bool& heat, bool& cool) = 0;
+};
+
+class LegacyLaw : public Law
+{
+    bool    _heat, _cool;
+
+public:
+    LegacyLaw() : _heat(false), _cool(false) {}
+
+    int period(void) { return LEGACY_READ_S; }
+
+    void read(int16_t t)
+    {
+        if (t > 2700)
+            _cool = true;
+        else if (t < 2700)
+            _cool = false;
+        if (t < 2400)
+            _heat = true;
+        else if (t > 2400)
+            _heat = false;
+    }
+
+    void outputs(uint32_t, bool& heat, bool& cool) { heat = _heat; cool = _cool; }
+};
+
+class ZoneLaw : public Law
+{
+    ClimateZone _zone;
+
+public:
+    ZoneLaw(ClimateController& heat, ClimateController& cool) : _zone(heat, cool) {}
+
+    void read(int16_t t) { _zone.update(t, READ_S * 1000); }
+    void outputs(uint32_t now_ms, bool& heat, bool& cool)
+    {
+        heat = _zone.heating(now_ms);
+        cool = _zone.cooling(now_ms);
+    }
+};
+
+static double outdoor(double t_s, int days)
+{
+    double  day = t_s / 86400.0;
+    double  mean = 12.0 + 14.0 * sin(M_PI * day / days);   // winter -> summer -> winter
+    double  daily = 8.0 * sin(2 * M_PI * (day - 0.375));    // warmest mid afternoon
+
+    return mean + daily;
+}
+
+static Result simulate(Law& law, int days)
+{
+    Result  r = { 0, 0, 0, 0, 0, 0 };
+    double  room = 25.0;
+    bool    heat = false, cool = false;
+    long    outside = 0;
+    long    seconds = (long)days * 86400;
+
+    for (long s = 0; s < seconds; s++) {
+        if (s % law.period() == 0) {
+            int16_t reading = (int16_t)(floor(room * 16.0) * 100 / 16.0);   // 1/16 degC steps
+            law.read(reading);
+        }
+
+        bool    h, c;
+
+        law.outputs((uint32_t)(s * 1000), h, c);
+        if (h != heat)
+            r.switches++;
+        if (c != cool)
+            r.switches++;
+        heat = h;
+        cool = c;
+
+        double  target = outdoor(s, days) + (heat ? HEAT_RISE : 0) - (cool ? COOL_DROP : 0);
+
+        room += (target - room) / TAU_S;
+        r.heat_h += heat ? 1.0 / 3600 : 0;
+        r.cool_h += cool ? 1.0 / 3600 : 0;
+        if (room > COMFORT_HIGH && room - COMFORT_HIGH > r.over)
+            r.over = room - COMFORT_HIGH;
+        if (room < COMFORT_LOW && COMFORT_LOW - room > r.under)
+            r.under = COMFORT_LOW - room;
+        if (room < COMFORT_LOW || room > COMFORT_HIGH)
+            outside++;
+    }
+
+    r.outside_pct = 100.0 * outside / seconds;
+    return r;
+}
+
+static void print(const char* name, const Result& r, int days)
+{
+    printf("%-11s %9.1f %9.1f %12.1f %9.2f %9.2f %9.2f\n", name, r.heat_h, r.cool_h,
+           (double)r.switches / days, r.over, r.under, r.outside_pct);
+}
+
+static void benchmark(void)
+{
+    PidController   heat(HEAT_SETPOINT, gains, 0, CLIMATE_FULL_DEMAND);
+    PidController   cool(COOL_SETPOINT, gains, -CLIMATE_FULL_DEMAND, 0);
+    ClimateZone     zone(heat, cool);
+    const long      n = 10000000;
+    volatile int32_t sink = 0;
+    clock_t         start = clock();
+
+    for (long i = 0; i < n; i++)
+        sink += zone.update((int16_t)(2300 + (i & 511)), READ_S * 1000);
+
+    double  ns = 1e9 * (double)(clock() - start) / CLOCKS_PER_SEC / n;
+
+    printf("\nClimateZone::update() with two PID loops: %.1f ns per call on this host\n", ns);
+}
+
+int main(int argc, char* argv[])
+{
+    int days = argc > 1 ? atoi(argv[1]) : 60;
+
+    if (days < 1)
+        days = 1;
+
+    HysteresisController    hyst_heat(COMFORT_LOW * 100 + BAND / 2, BAND, CLIMATE_FULL_DEMAND);
+    HysteresisController    hyst_cool(COMFORT_HIGH * 100 - BAND / 2, BAND, -CLIMATE_FULL_DEMAND);
+    PidController           pid_heat(HEAT_SETPOINT, gains, 0, CLIMATE_FULL_DEMAND);
+    PidController           pid_cool(COOL_SETPOINT, gains, -CLIMATE_FULL_DEMAND, 0);
+    LegacyLaw               legacy;
+    ZoneLaw                 hysteresis(hyst_heat, hyst_cool);
+    ZoneLaw                 pid(pid_heat, pid_cool);
+
+    printf("%d simulated days\n\n", days);
+    printf("%-11s %9s %9s %12s %9s %9s %9s\n", "law", "heat [h]", "cool [h]", "switch/day",
+           "over [C]", "under [C]", "outside %");
+    print("legacy", simulate(legacy, days), days);
+    print("hysteresis", simulate(hysteresis, days), days);
+    print("pid", simulate(pid, days), days);
+    benchmark();
+
+    return 0;
+}
@@ -0,0 +1,102 @@
+/*
+Host simulation of the HC-SR04 echo timing fed through DistanceFilter.
+
+Every ping the simulated sensor returns an echo pulse of 58 us per cm of the
+true distance plus timing jitter. Some pings get no echo (38 ms pulse), some
+return a spurious short echo. An obstacle steps in front of the garage door
+and leaves again; the simulation reports how many pings the filter took to
+raise and clear the obstacle event and how many false events it produced,
+counting separately the false clears while the obstacle was still there.
+
+Build:
+    g++ -O2 -I../../Ranging -o echo_sim echo_sim.cpp ../../Ranging/DistanceFilter.cpp
+
+Use:
+    ./echo_sim [runs] [spike probability] [dropout probability]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "DistanceFilter.h"
+
+#define PING_MS         60
+#define NO_ECHO_US      38000
+#define FREE_CM         150
+#define OBSTACLE_CM     6
+#define THRESHOLD_CM    10
+
+static double uniform(void)
+{
+    return rand() / (RAND_MAX + 1.0);
+}
+
+// echo pulse width the sensor would produce for a target at 'cm'
+static uint32_t echo_us(double cm, double spikeP, double dropP)
+{
+    double  r = uniform();
+
+    if (r < dropP)
+        return NO_ECHO_US;
+    if (r < dropP + spikeP)
+        return (uint32_t)(uniform() * 400 * 58);       // reflection off anything
+    return (uint32_t)(cm * 58 + (uniform() - 0.5) * 60);    // ~ +-0.5 cm jitter
+}
+
+int main(int argc, char* argv[])
+{
+    int     runs = argc > 1 ? atoi(argv[1]) : 1000;
+    double  spikeP = argc > 2 ? atof(argv[2]) : 0.05;
+    double  dropP = argc > 3 ? atof(argv[3]) : 0.05;
+    long    detectPings = 0, clearPings = 0, worstDetect = 0, falseEvents = 0, falseClears = 0, missed = 0;
+
+    srand(1);
+    for (int run = 0; run < runs; run++) {
+        DistanceFilter  filter(THRESHOLD_CM, 3);
+        int             appear = 50 + rand() % 50;     // ping index the obstacle steps in
+        int             leave = appear + 30 + rand() % 30;
+        int             detected = -1, cleared = -1;
+
+        for (int ping = 0; ping < leave + 60; ping++) {
+            bool        present = ping >= appear && ping < leave;
+            uint32_t    cm = echo_us(present ? OBSTACLE_CM : FREE_CM, spikeP, dropP) / 58;
+
+            if (cm > DISTANCE_MAX_CM)
+                cm = DISTANCE_MAX_CM;
+            if (!filter.add(cm))
+                continue;
+
+            if (filter.obstacle() && ping >= appear && ping < leave && detected < 0)
+                detected = ping;
+            else
+            if (!filter.obstacle() && ping >= leave && cleared < 0 && detected >= 0)
+                cleared = ping;
+            else {
+                falseEvents++;
+                if (!filter.obstacle() && present)
+                    falseClears++;
+            }
+        }
+
+        if (detected < 0) {
+            missed++;
+            continue;
+        }
+
+        detectPings += detected - appear + 1;
+        if (detected - appear + 1 > worstDetect)
+            worstDetect = detected - appear + 1;
+        if (cleared >= 0)
+            clearPings += cleared - leave + 1;
+    }
+
+    int found = runs - missed;
+
+    printf("runs %d, spike p=%.2f, dropout p=%.2f, ping period %d ms\n", runs, spikeP, dropP, PING_MS);
+    printf("obstacle detected after %.2f pings on average (%.0f ms), worst %ld pings (%ld ms)\n",
+           found ? (double)detectPings / found : 0.0, found ? (double)detectPings / found * PING_MS : 0.0,
+           worstDetect, worstDetect * PING_MS);
+    printf("obstacle cleared after %.2f pings on average\n", found ? (double)clearPings / found : 0.0);
+    printf("missed obstacles %ld, false events %ld (%ld clears with the obstacle present)\n",
+           missed, falseEvents, falseClears);
+    return 0;
+}
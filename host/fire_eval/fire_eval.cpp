@@ -0,0 +1,240 @@
+/*
+Validates the FireDetector on host.
+
+Synthetic mode simulates a house with SENSORS rooms, one temperature sensor
+each, read every READ_MS with the DS1820 1/16 degC resolution:
+  - non-fire days: a daily swing that can pass 30 degC in the afternoon,
+    cooking in the kitchen, sun on a sensor and a fan heater blowing at one,
+    to count false alarms per day
+  - fires: t-squared growth (slow, medium and fast) in a random room at a
+    random time, the heat reaching the other rooms later and weaker, to
+    measure the detection latency
+The old logic, one sensor read every 10 s and compared against 30 degC, runs
+on the same traces.
+
+Replay mode reads a recorded trace, one reading per line as
+"time_ms,sensor,temp_centi", and prints every alarm.
+
+Build:
+    g++ -O2 -I../../Fire -o fire_eval fire_eval.cpp ../../Fire/FireDetector.cpp
+
+Use:
+    ./fire_eval [days] [fires per class]
+    ./fire_eval trace.csv
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <ctype.h>
+#include <algorithm>
+#include <vector>
+#include "FireDetector.h"
+
+#define SENSORS         4
+#define READ_MS         2000
+#define LEGACY_READ_MS  10000
+#define LEGACY_TEMP     3000
+#define KITCHEN         1
+
+static double noise(void)
+{
+    return ((double)rand() / RAND_MAX - 0.5) * 0.1;
+}
+
+static int16_t reading(double t)
+{
+    return (int16_t)(floor(t * 16.0) * 100 / 16.0);
+}
+
+// bump rising over 'rise' seconds by 'amplitude', decaying after with time constant 'decay'
+static double bump(double t, double start, double rise, double amplitude, double decay)
+{
+    if (t < start)
+        return 0;
+    if (t < start + rise)
+        return amplitude * (t - start) / rise;
+    return amplitude * exp(-(t - start - rise) / decay);
+}
+
+struct Day
+{
+    double  base;
+    double  swing;
+    double  cooking[3];     // start times
+    double  sun;
+    int     sun_room;
+    double  blower;
+    int     blower_room;
+};
+
+static Day randomDay(void)
+{
+    Day d;
+
+    d.base = 20 + rand() % 6;
+    d.swing = 3 + rand() % 8;                       // afternoons up to 35 degC
+    for (int i = 0; i < 3; i++)
+        d.cooking[i] = (7 + 5 * i) * 3600 + rand() % 3600;
+    d.sun = 10 * 3600 + rand() % (6 * 3600);
+    d.sun_room = rand() % SENSORS;
+    d.blower = rand() % 86400;
+    d.blower_room = rand() % SENSORS;
+    return d;
+}
+
+static double dayTemp(const Day& d, int room, double t)
+{
+    double  temp = d.base + d.swing * sin(2 * M_PI * (t / 86400.0 - 0.375));
+
+    if (room == KITCHEN)
+        for (int i = 0; i < 3; i++)
+            temp += bump(t, d.cooking[i], 240, 6, 600);  // 1.5 degC/min
+    if (room == d.sun_room)
+        temp += bump(t, d.sun, 900, 4, 1800);
+    if (room == d.blower_room)
+        temp += bump(t, d.blower, 120, 5, 300);     // 2.5 degC/min
+    return temp + noise();
+}
+
+struct Counts
+{
+    int detector;
+    int legacy;
+};
+
+static Counts falseAlarms(int days)
+{
+    Counts  c = { 0, 0 };
+
+    for (int day = 0; day < days; day++) {
+        Day             d = randomDay();
+        FireDetector    detector(SENSORS);
+        bool            legacy = false;
+
+        for (uint32_t ms = 0; ms < 86400000u; ms += READ_MS) {
+            for (int room = 0; room < SENSORS; room++) {
+                int16_t t = reading(dayTemp(d, room, ms / 1000.0));
+
+                if (detector.add(room, t, ms))
+                    c.detector++;
+                if (room == 0 && ms % LEGACY_READ_MS == 0) {
+                    if (t > LEGACY_TEMP && !legacy)
+                        c.legacy++;
+                    legacy = t > LEGACY_TEMP;
+                }
+            }
+        }
+    }
+
+    return c;
+}
+
+// temperature rise of a t-squared fire reaching +10 degC after 't10' seconds
+static double fireRise(double t, double t10)
+{
+    return t > 0 ? 10.0 * pow(t / t10, 4.0 / 3.0) : 0;
+}
+
+static double percentile(std::vector<double> v, double p)
+{
+    if (v.empty())
+        return NAN;
+    std::sort(v.begin(), v.end());
+    return v[(size_t)(p * (v.size() - 1))];
+}
+
+static void fires(const char* name, double t10, int runs)
+{
+    std::vector<double> detector, legacy;
+    int                 missed = 0, legacyMissed = 0;
+
+    for (int run = 0; run < runs; run++) {
+        Day             d = randomDay();
+        int             room = rand() % SENSORS;
+        double          ignition = rand() % 86400;
+        FireDetector    detector_(SENSORS);
+        double          found = -1, legacyFound = -1;
+
+        d.blower = -1e9;
+        for (uint32_t ms = 0; ms < 86400000u + 1800000u && (found < 0 || legacyFound < 0); ms += READ_MS) {
+            double  t = ms / 1000.0;
+
+            if (t > ignition + 1800)
+                break;
+            for (int r = 0; r < SENSORS; r++) {
+                double  temp = dayTemp(d, r, t);
+
+                temp += (r == room) ? fireRise(t - ignition, t10) : 0.35 * fireRise(t - ignition - 60, t10);
+
+                int16_t v = reading(temp);
+
+                if (detector_.add(r, v, ms) && found < 0 && t >= ignition)
+                    found = t - ignition;
+                if (r == 0 && ms % LEGACY_READ_MS == 0 && v > LEGACY_TEMP && legacyFound < 0 && t >= ignition)
+                    legacyFound = t - ignition;
+            }
+        }
+
+        if (found < 0)
+            missed++;
+        else
+            detector.push_back(found);
+        if (legacyFound < 0)
+            legacyMissed++;
+        else
+            legacy.push_back(legacyFound);
+    }
+
+    printf("%-7s %-9s %8.0f %8.0f %8d\n", name, "detector", percentile(detector, 0.5),
+           percentile(detector, 1.0), missed);
+    printf("%-7s %-9s %8.0f %8.0f %8d\n", "", "legacy", percentile(legacy, 0.5),
+           percentile(legacy, 1.0), legacyMissed);
+}
+
+static int replay(const char* path)
+{
+    FILE*           f = fopen(path, "r");
+    FireDetector    detector(FIRE_MAX_SENSORS);
+    unsigned long   ms;
+    int             sensor, temp;
+    static const char* causes[] = { "none", "absolute", "rate", "correlated", "rise" };
+
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+
+    while (fscanf(f, "%lu,%d,%d", &ms, &sensor, &temp) == 3)
+        if (detector.add((uint8_t)sensor, (int16_t)temp, (uint32_t)ms))
+            printf("%10lu ms  alarm, sensor %u, cause %s, rate %d centi/min\n", ms, detector.sensor(),
+                   causes[detector.cause()], detector.rate(detector.sensor()));
+
+    printf("%lu alarms\n", (unsigned long)detector.alarms());
+    fclose(f);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc > 1 && !isdigit((unsigned char)argv[1][0]))
+        return replay(argv[1]);
+
+    int days = argc > 1 ? atoi(argv[1]) : 30;
+    int runs = argc > 2 ? atoi(argv[2]) : 50;
+
+    srand(1);
+
+    Counts  c = falseAlarms(days);
+
+    printf("%d non-fire days, %d rooms\n", days, SENSORS);
+    printf("false alarms per day: detector %.3f, legacy %.3f\n\n", (double)c.detector / days,
+           (double)c.legacy / days);
+
+    printf("%d fires per class, latency from ignition [s]\n", runs);
+    printf("%-7s %-9s %8s %8s %8s\n", "class", "", "p50", "max", "missed");
+    fires("fast", 75, runs);
+    fires("medium", 150, runs);
+    fires("slow", 300, runs);
+
+    return 0;
+}
@@ -0,0 +1,160 @@
+/*
+Validates the water level chain (CicDecimator + FloodDetector) on host.
+
+Synthetic mode runs dry traces (sensor noise plus random spikes) to count
+false flood alarms per hour, and flood traces (water reaching the sensor at
+a random time) to measure the onset latency. The old logic, one sample
+every 20 s compared against the threshold, is evaluated on the same traces.
+
+Recorded mode replays a trace of raw read_u16() values sampled at 1 kHz,
+one value per line, and prints every onset.
+
+Build:
+    g++ -O2 -I../../WaterLevel -o flood_eval flood_eval.cpp ../../WaterLevel/FloodDetector.cpp
+
+Use:
+    ./flood_eval [hours of dry trace] [flood runs]
+    ./flood_eval trace.csv
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include "CicDecimator.h"
+#include "FloodDetector.h"
+
+#define SAMPLE_HZ       1000
+#define LOG2_DECIM      5
+#define DEBOUNCE        4
+#define ON_LEVEL        655         // 0.01 of full scale, as in main.cpp
+#define OFF_LEVEL       (ON_LEVEL / 2)
+#define OLD_PERIOD_MS   20000
+
+#define NOISE_COUNTS    80          // sensor noise, 1 sigma
+#define SPIKE_P         0.0005      // probability of an impulse per sample
+#define WET_LEVEL       12000       // sensor reading once submerged
+#define RISE_MS         40          // time for the reading to settle when water arrives
+
+static double uniform(void)
+{
+    return rand() / (RAND_MAX + 1.0);
+}
+
+static double gaussian(void)
+{
+    return sqrt(-2 * log(uniform() + 1e-12)) * cos(2 * M_PI * uniform());
+}
+
+static uint16_t clamp16(double v)
+{
+    return v < 0 ? 0 : v > 65535 ? 65535 : (uint16_t)v;
+}
+
+// one raw sample of the synthetic sensor, 'wet' is 0..1
+static uint16_t synth(double wet)
+{
+    double  v = 150 + wet * WET_LEVEL + gaussian() * NOISE_COUNTS;
+
+    if (uniform() < SPIKE_P)
+        v += uniform() * 30000;    // relay switching, ESD, a drop of condensation
+    return clamp16(v);
+}
+
+static int replay(const char* path)
+{
+    FILE*           in = fopen(path, "r");
+    CicDecimator    cic(LOG2_DECIM);
+    FloodDetector   detector(ON_LEVEL, OFF_LEVEL, DEBOUNCE);
+    unsigned        raw;
+    long            n = 0;
+    uint16_t        level;
+
+    if (in == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    while (fscanf(in, "%u", &raw) == 1) {
+        bool    was = detector.flooded();
+
+        if (cic.add(raw, level) && detector.add(level))
+            printf("flood onset at %.3f s (level %u)\n", (double)n / SAMPLE_HZ, level);
+        else
+        if (was && !detector.flooded())
+            printf("dry again at %.3f s\n", (double)n / SAMPLE_HZ);
+        n++;
+    }
+
+    printf("%ld samples, %u onsets\n", n, detector.onsets());
+    fclose(in);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc == 2 && atof(argv[1]) == 0)
+        return replay(argv[1]);
+
+    double  hours = argc > 1 ? atof(argv[1]) : 24;
+    int     runs = argc > 2 ? atoi(argv[2]) : 1000;
+
+    srand(1);
+
+    // dry trace: every onset is a false alarm
+    CicDecimator    cic(LOG2_DECIM);
+    FloodDetector   detector(ON_LEVEL, OFF_LEVEL, DEBOUNCE);
+    long            samples = (long)(hours * 3600 * SAMPLE_HZ);
+    long            oldFalse = 0;
+    uint16_t        level;
+
+    for (long i = 0; i < samples; i++) {
+        uint16_t    raw = synth(0);
+
+        if (cic.add(raw, level))
+            detector.add(level);
+        if (i % OLD_PERIOD_MS == 0 && raw > ON_LEVEL)
+            oldFalse++;
+    }
+
+    // flood traces: water arrives at t0
+    std::vector<double> latency, oldLatency;
+
+    for (int run = 0; run < runs; run++) {
+        CicDecimator    c(LOG2_DECIM);
+        FloodDetector   d(ON_LEVEL, OFF_LEVEL, DEBOUNCE);
+        long            t0 = 5000 + rand() % 20000;
+        long            phase = rand() % OLD_PERIOD_MS;   // where the old 20 s timer happened to be
+        bool            found = false, oldFound = false;
+
+        for (long i = 0; i < t0 + 60000 && !(found && oldFound); i++) {
+            double      wet = i < t0 ? 0 : std::min(1.0, (double)(i - t0) / RISE_MS);
+            uint16_t    raw = synth(wet);
+
+            if (!found && c.add(raw, level) && d.add(level) && i >= t0) {
+                latency.push_back(i - t0);
+                found = true;
+            }
+
+            if (!oldFound && (i + phase) % OLD_PERIOD_MS == 0 && raw > ON_LEVEL && i >= t0) {
+                oldLatency.push_back(i - t0);
+                oldFound = true;
+            }
+        }
+    }
+
+    std::sort(latency.begin(), latency.end());
+    std::sort(oldLatency.begin(), oldLatency.end());
+
+    printf("dry trace %.1f h: %u false onsets (%.3f/h), old logic %ld false alarms (%.3f/h)\n",
+           hours, detector.onsets(), detector.onsets() / hours, oldFalse, oldFalse / hours);
+    if (!latency.empty())
+        printf("onset latency: p50 %.0f ms, p99 %.0f ms, max %.0f ms (%zu/%d detected)\n",
+               latency[latency.size() / 2], latency[(size_t)(latency.size() * 0.99)],
+               latency.back(), latency.size(), runs);
+    if (!oldLatency.empty())
+        printf("old logic:     p50 %.0f ms, p99 %.0f ms, max %.0f ms\n",
+               oldLatency[oldLatency.size() / 2], oldLatency[(size_t)(oldLatency.size() * 0.99)],
+               oldLatency.back());
+    return 0;
+}
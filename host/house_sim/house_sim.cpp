@@ -0,0 +1,665 @@
+/*
+Runs the smart home firmware (main.cpp, unchanged) on Linux on top of the
+host stand-in of mbed.h in host/mbed. The clock is virtual, so a day of the
+house takes minutes and every run of the same script gives the same result.
+
+The inputs come from a script, a DS18B20 and an HC-SR04 are simulated on
+their pins from HouseConfig.h and the phone acks the alerts of the board.
+Every output pin change and every frame the board sends goes to the trace,
+with its time in us:
+    <time_us> <pin> out <level>
+    <time_us> <pin> pwm <period_us> <pulse_us>
+    <time_us> <pin> phone ack <seq> <accepted> <status>
+    <time_us> <pin> phone alert <alarm> <priority> <seq> <attempt>
+    <time_us> USBTX tlm <payload bytes in hex>
+
+'measure' lines time the responses of the house to a stimulus, the run
+reports p50/p99/max per event and response. A run fails (exit code 1)
+when a p99 is over its 'budget', a budgeted response never came, or the
+trace differs from the golden trace given with -g. A golden trace is the
+-o trace of a good run, times may differ by the tolerance of -j, the rest
+of each line must be the same. The scenarios are run like:
+    ./house_sim -t 170 -g scenarios/fire.golden scenarios/fire.txt
+
+Build:
+    g++ -O2 -std=c++11 -I../mbed $(find ../.. -maxdepth 2 -type d -path '../../[A-Z]*' | sed 's/^/-I/') \
+        -o house_sim house_sim.cpp ../mbed/mbed.cpp ../mbed/HostHal.cpp ../mbed/HostDevices.cpp \
+        $(find ../.. -maxdepth 3 -path '../../[A-Z]*' -name '*.cpp')
+
+Use:
+    ./house_sim [options] [script]
+    options: -t <seconds>   simulated time (default 60)
+             -o <file>      trace (default: stdout, none with -g)
+             -g <file>      golden trace to compare the trace with
+             -j <us>        time tolerance against the golden trace (default 5000)
+             -s <file>      capture of the telemetry (USBTX), for telemetry_dump
+             -b <file>      capture of what the board sends to the phone
+             -c <ns>        simulated time taken by one HAL call (default 1000)
+
+Script, one line each, times in ms after reset, '#' starts a comment:
+    <ms> pin <pin> <0|1>        digital input level, e.g. a PIR on p5
+    <ms> adc <pin> <0..1>       analog input as a fraction of full scale
+    <ms> temp <celsius>         temperature at the DS18B20
+    <ms> sensor <0|1>           DS18B20 connected or not
+    <ms> range <cm>             distance in front of the HC-SR04
+    <ms> phone <commands>       command batch from the phone app, e.g. 35
+    <ms> rx <pin> <hex>...      raw bytes into the serial port receiving on <pin>
+    <ms> rtc <seconds>          set the real time clock (Unix time)
+    <ms> measure <event> <response>...
+                                times each response from now, a response is:
+                                alarm, silence      the buzzer starts, stops
+                                tone:<period_us>    the buzzer plays a note of that period,
+                                                    e.g. the first of a melody
+                                alert:<alarm>       alert sent to the phone
+                                fault:<code>        TLM_FAULT of the DS1820 with that code
+                                ack                 command batch acked
+                                <pin>=<level>       output pin set to level
+                                reverse:<pin>       servo on pin turns around
+                                halt:<pin>          servo on pin stops going the way
+                                                    it went, timed to its last move
+                                                    that way, taken when it turns
+    <ms> repeat <count> <period_ms>
+    ...
+    end                         the lines in between run 'count' times, their
+                                times count from the start of each repetition
+    budget <event> <response> <p99_ms>
+    quiet <pin>                 pin left out of the trace, e.g. a trigger, its
+                                responses are still timed
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include "HostDevices.h"
+#include "Framing.h"
+#include "PhoneProtocol.h"
+
+#define main firmware_main
+#include "../../main.cpp"
+#undef main
+
+#define SIM_PHONE_ACK_MS    30      // the phone acks an alert after a Bluetooth round trip
+#define SIM_LINE_MAX        320
+
+struct SimMeasure
+{
+    std::string                     event;
+    uint64_t                        start_us;
+    std::vector<std::string>        waiting;
+    std::map<std::string, int>      halt_direction;     // of the servo at the event, per halt: response
+    std::map<std::string, uint64_t> halt_moved_us;      // its last move that way
+};
+
+struct SimLatency
+{
+    std::vector<double> ms;
+    uint32_t            missed;
+    double              budget_ms;
+
+    SimLatency() : missed(0), budget_ms(-1) { }
+};
+
+struct SimPort
+{
+    uint8_t     buf[256];
+    CobsDecoder decoder;
+
+    SimPort() : decoder(buf, sizeof(buf)) { }
+};
+
+static Ds18b20Model*    sim_sensor;
+static Hcsr04Model*     sim_ranger;
+static uint8_t          sim_phone_seq;
+static struct timespec  sim_wall_start;
+static std::string      sim_script = "-";
+
+static FILE*                    sim_out;
+static std::vector<std::string> sim_golden;
+static size_t                   sim_golden_line;
+static std::string              sim_golden_error;
+static uint64_t                 sim_tolerance_us = 5000;
+
+static std::vector<SimMeasure>              sim_measures;
+static std::map<std::string, SimLatency>    sim_latencies;
+static uint32_t                             sim_last_pulse[PIN_COUNT];
+static int                                  sim_direction[PIN_COUNT];
+static bool                                 sim_quiet[PIN_COUNT];
+
+static SimPort  sim_phone_port;
+static SimPort  sim_tlm_port;
+
+/*
+Phone
+*/
+static void sim_send(const uint8_t* payload, size_t n)
+{
+    uint8_t     frame[FRAMING_MAX_ENCODED(PHONE_MAX_PAYLOAD)];
+    CobsEncoder enc(frame, sizeof(frame));
+
+    enc.begin();
+    enc.put(payload, n);
+
+    size_t      len = enc.finish();
+
+    hal_rx(house_pin(DEV_PHONE_RX), frame, len);
+}
+
+static void sim_phone(const std::string& commands)
+{
+    uint8_t     p[PHONE_MAX_PAYLOAD];
+    size_t      n = commands.size() < PHONE_MAX_BATCH ? commands.size() : PHONE_MAX_BATCH;
+
+    p[0] = PHONE_CMD;
+    p[1] = ++sim_phone_seq;
+    p[2] = (uint8_t)n;
+    memcpy(&p[3], commands.data(), n);
+    sim_send(p, 3 + n);
+}
+
+/*
+Latencies
+*/
+// Tells if a telemetry frame, as traced in hex, has a DS1820 fault with 'code'
+static bool sim_fault(const char* value, unsigned code)
+{
+    std::vector<uint8_t>    p;
+    unsigned                b;
+    int                     n;
+
+    for (; sscanf(value, "%x%n", &b, &n) == 1; value += n)
+        p.push_back((uint8_t)b);
+
+    // version and seq, then the records
+    for (size_t i = 2; i < p.size(); i += 1 + TLM_TAG_LEN(p[i]))
+        if (TLM_TAG_TYPE(p[i]) == TLM_FAULT && i + 2 < p.size() && p[i + 1] == TLM_DEV_DS1820 && p[i + 2] == code)
+            return true;
+    return false;
+}
+
+// 'previous' is the pulse width of the pin before a pwm record
+static bool sim_responds(const std::string& response, PinName pin, const char* kind, const char* value,
+                         uint32_t previous, bool reversed)
+{
+    unsigned    period;
+    unsigned    pulse;
+
+    if (response == "alarm" || response == "silence")
+        return pin == house_pin(DEV_BUZZER) && strcmp(kind, "pwm") == 0 && sscanf(value, "%u %u", &period, &pulse) == 2 &&
+               (response == "alarm" ? previous == 0 && pulse != 0 : previous != 0 && pulse == 0);
+    if (response.compare(0, 5, "tone:") == 0)
+        return pin == house_pin(DEV_BUZZER) && strcmp(kind, "pwm") == 0 && sscanf(value, "%u %u", &period, &pulse) == 2 &&
+               pulse != 0 && period == strtoul(response.c_str() + 5, NULL, 10);
+    if (response.compare(0, 6, "alert:") == 0)
+        return strcmp(kind, "phone") == 0 && strncmp(value, "alert ", 6) == 0 && value[6] == response[6];
+    if (response == "ack")
+        return strcmp(kind, "phone") == 0 && strncmp(value, "ack ", 4) == 0;
+    if (response.compare(0, 6, "fault:") == 0)
+        return strcmp(kind, "tlm") == 0 && sim_fault(value, strtoul(response.c_str() + 6, NULL, 10));
+    if (response.compare(0, 8, "reverse:") == 0)
+        return reversed && response.compare(8, std::string::npos, hal_pin_name(pin)) == 0;
+
+    size_t      eq = response.find('=');
+
+    return eq != std::string::npos && strcmp(kind, "out") == 0 &&
+           response.compare(0, eq, hal_pin_name(pin)) == 0 && response.compare(eq + 1, std::string::npos, value) == 0;
+}
+
+static void sim_missed(const SimMeasure& m)
+{
+    for (size_t i = 0; i < m.waiting.size(); i++)
+        sim_latencies[m.event + " -> " + m.waiting[i]].missed++;
+}
+
+static void sim_measure(const std::string& event, const std::vector<std::string>& responses)
+{
+    // responses still awaited from the previous stimulus of the event never came
+    for (size_t i = 0; i < sim_measures.size(); i++)
+        if (sim_measures[i].event == event) {
+            sim_missed(sim_measures[i]);
+            sim_measures.erase(sim_measures.begin() + i);
+            break;
+        }
+
+    SimMeasure  m;
+
+    m.event = event;
+    m.start_us = hal_now_us();
+    m.waiting = responses;
+    for (size_t i = 0; i < responses.size(); i++)
+        if (responses[i].compare(0, 5, "halt:") == 0) {
+            PinName pin = hal_pin_by_name(responses[i].c_str() + 5);
+
+            m.halt_direction[responses[i]] = pin != NC ? sim_direction[pin] : 0;
+            m.halt_moved_us[responses[i]] = m.start_us;
+        }
+    sim_measures.push_back(m);
+}
+
+// A halt: response ends when the servo turns, its time is the last move before
+static bool sim_halted(SimMeasure& m, const std::string& response, PinName pin, int dir, uint64_t at_us,
+                       uint64_t& moved_us)
+{
+    if (dir == 0 || response.compare(5, std::string::npos, hal_pin_name(pin)) != 0)
+        return false;
+    if (dir == m.halt_direction[response]) {
+        m.halt_moved_us[response] = at_us;
+        return false;
+    }
+    moved_us = m.halt_moved_us[response];
+    return true;
+}
+
+static void sim_responses(uint64_t at_us, PinName pin, const char* kind, const char* value)
+{
+    bool        reversed = false;
+    uint32_t    previous = sim_last_pulse[pin];
+    unsigned    period;
+    unsigned    pulse;
+    int         dir = 0;
+
+    // a servo turns around when its pulse width starts moving the other way
+    if (strcmp(kind, "pwm") == 0 && sscanf(value, "%u %u", &period, &pulse) == 2) {
+        dir = pulse > sim_last_pulse[pin] ? 1 : (pulse < sim_last_pulse[pin] ? -1 : 0);
+        reversed = dir != 0 && sim_direction[pin] != 0 && dir != sim_direction[pin];
+        if (dir != 0)
+            sim_direction[pin] = dir;
+        sim_last_pulse[pin] = pulse;
+    }
+
+    for (size_t i = 0; i < sim_measures.size(); i++) {
+        SimMeasure& m = sim_measures[i];
+
+        for (size_t r = 0; r < m.waiting.size(); r++) {
+            uint64_t    done_us = at_us;
+            bool        done = m.waiting[r].compare(0, 5, "halt:") == 0 ?
+                               sim_halted(m, m.waiting[r], pin, dir, at_us, done_us) :
+                               sim_responds(m.waiting[r], pin, kind, value, previous, reversed);
+
+            if (done) {
+                sim_latencies[m.event + " -> " + m.waiting[r]].ms.push_back((done_us - m.start_us) / 1000.0);
+                m.waiting.erase(m.waiting.begin() + r--);
+            }
+        }
+        if (m.waiting.empty())
+            sim_measures.erase(sim_measures.begin() + i--);
+    }
+}
+
+// Nearest rank percentile
+static double sim_percentile(std::vector<double> v, double p)
+{
+    if (v.empty())
+        return 0;
+    std::sort(v.begin(), v.end());
+
+    size_t  rank = (size_t)(p / 100.0 * v.size() + 0.999999);
+
+    return v[rank > 0 ? rank - 1 : 0];
+}
+
+/*
+Trace
+*/
+static void sim_compare(const char* line)
+{
+    if (sim_golden.empty() || !sim_golden_error.empty())
+        return;
+    if (sim_golden_line >= sim_golden.size()) {
+        sim_golden_error = std::string("more than in the golden trace: ") + line;
+        return;
+    }
+
+    const char*         expected = sim_golden[sim_golden_line++].c_str();
+    unsigned long long  t_got;
+    unsigned long long  t_expected;
+    int                 n_got;
+    int                 n_expected;
+
+    if (sscanf(line, "%llu%n", &t_got, &n_got) != 1 || sscanf(expected, "%llu%n", &t_expected, &n_expected) != 1 ||
+        strcmp(line + n_got, expected + n_expected) != 0 ||
+        (t_got > t_expected ? t_got - t_expected : t_expected - t_got) > sim_tolerance_us) {
+        char    msg[2 * SIM_LINE_MAX + 64];
+
+        snprintf(msg, sizeof(msg), "line %u is '%s', expected '%s'", (unsigned)sim_golden_line, line, expected);
+        sim_golden_error = msg;
+    }
+}
+
+static void sim_record(uint64_t at_us, PinName pin, const char* kind, const char* value)
+{
+    char    line[SIM_LINE_MAX];
+
+    snprintf(line, sizeof(line), "%llu %s %s %s", (unsigned long long)at_us, hal_pin_name(pin), kind, value);
+    if (!sim_quiet[pin]) {
+        if (sim_out != NULL)
+            fprintf(sim_out, "%s\n", line);
+        sim_compare(line);
+    }
+    sim_responses(at_us, pin, kind, value);
+}
+
+// Frames from the board to the phone, the phone acks every alert
+static void sim_phone_frame(const uint8_t* p, int n)
+{
+    char    value[64];
+
+    if (p[0] == PHONE_ACK && n >= 4)
+        snprintf(value, sizeof(value), "ack %u %u %c", p[1], p[2], p[3]);
+    else if (p[0] == PHONE_ALERT && n >= 5) {
+        uint8_t seq = p[1];
+
+        snprintf(value, sizeof(value), "alert %c %u %u %u", p[3], p[2], p[1], p[4]);
+        hal_at(hal_now_us() + SIM_PHONE_ACK_MS * 1000, [seq]() {
+            uint8_t ack[2] = { PHONE_ALERT_ACK, seq };
+
+            sim_send(ack, sizeof(ack));
+        });
+    }
+    else
+        snprintf(value, sizeof(value), "type %u", p[0]);
+    hal_record(house_pin(DEV_PHONE_TX), "phone", value);
+}
+
+static void sim_tlm_frame(const uint8_t* p, int n)
+{
+    char    value[SIM_LINE_MAX / 3 * 2];
+    size_t  len = 0;
+
+    for (int i = 0; i < n && len + 4 < sizeof(value); i++)
+        len += snprintf(&value[len], sizeof(value) - len, i > 0 ? " %02x" : "%02x", p[i]);
+    value[len] = 0;
+    hal_record(USBTX, "tlm", value);
+}
+
+static void sim_listen(SimPort& port, uint8_t b, void (*frame)(const uint8_t* p, int n))
+{
+    int     n = port.decoder.feed(b);
+
+    if (n > 0)
+        frame(port.decoder.data(), n);
+}
+
+/*
+Script
+*/
+static bool sim_pin(const char* name, PinName& pin)
+{
+    pin = hal_pin_by_name(name);
+    if (pin == NC)
+        fprintf(stderr, "%s: unknown pin %s\n", sim_script.c_str(), name);
+    return pin != NC;
+}
+
+// Schedules one timed line 'base_ms' later than it says, false if it can't be read
+static bool sim_line(const char* line, double base_ms)
+{
+    char        what[16];
+    char        arg[64];
+    double      ms;
+    int         used;
+    PinName     pin;
+
+    if (sscanf(line, "%lf %15s%n", &ms, what, &used) != 2)
+        return false;
+
+    uint64_t    at = (uint64_t)((base_ms + ms) * 1000);
+    const char* rest = line + used;
+    float       value;
+
+    if (strcmp(what, "pin") == 0 && sscanf(rest, "%63s %f", arg, &value) == 2 && sim_pin(arg, pin))
+        hal_at(at, [pin, value]() { hal_input(pin, (int)value); });
+    else if (strcmp(what, "adc") == 0 && sscanf(rest, "%63s %f", arg, &value) == 2 && sim_pin(arg, pin))
+        hal_at(at, [pin, value]() { hal_analog(pin, value); });
+    else if (strcmp(what, "temp") == 0 && sscanf(rest, "%f", &value) == 1)
+        hal_at(at, [value]() { sim_sensor->temperature(value); });
+    else if (strcmp(what, "sensor") == 0 && sscanf(rest, "%f", &value) == 1)
+        hal_at(at, [value]() { sim_sensor->connect(value != 0); });
+    else if (strcmp(what, "range") == 0 && sscanf(rest, "%f", &value) == 1)
+        hal_at(at, [value]() { sim_ranger->distance((uint16_t)value); });
+    else if (strcmp(what, "phone") == 0 && sscanf(rest, "%63s", arg) == 1) {
+        std::string commands(arg);
+
+        hal_at(at, [commands]() { sim_phone(commands); });
+    }
+    else if (strcmp(what, "rx") == 0 && sscanf(rest, "%63s%n", arg, &used) == 1 && sim_pin(arg, pin)) {
+        std::vector<uint8_t>    bytes;
+        unsigned                b;
+        int                     n;
+
+        for (rest += used; sscanf(rest, "%x%n", &b, &n) == 1; rest += n)
+            bytes.push_back((uint8_t)b);
+        hal_at(at, [pin, bytes]() { hal_rx(pin, bytes.data(), bytes.size()); });
+    }
+    else if (strcmp(what, "rtc") == 0 && sscanf(rest, "%63s", arg) == 1) {
+        uint32_t    seconds = strtoul(arg, NULL, 10);
+
+        hal_at(at, [seconds]() { set_time(seconds); });
+    }
+    else if (strcmp(what, "measure") == 0 && sscanf(rest, "%63s%n", arg, &used) == 1) {
+        std::string                 event(arg);
+        std::vector<std::string>    responses;
+
+        for (rest += used; sscanf(rest, "%63s%n", arg, &used) == 1; rest += used)
+            responses.push_back(arg);
+        if (responses.empty())
+            return false;
+        hal_at(at, [event, responses]() { sim_measure(event, responses); });
+    }
+    else
+        return false;
+    return true;
+}
+
+static bool sim_blank(const std::string& line)
+{
+    return line.find_first_not_of(" \t\r\n") == std::string::npos;
+}
+
+static bool sim_load(FILE* script)
+{
+    std::vector<std::string>    lines;
+    char                        buf[256];
+
+    while (fgets(buf, sizeof(buf), script) != NULL) {
+        buf[strcspn(buf, "#\r\n")] = 0;
+        lines.push_back(buf);
+    }
+
+    for (size_t i = 0; i < lines.size(); i++) {
+        const char* line = lines[i].c_str();
+        char        a[64];
+        char        b[64];
+        double      ms;
+        double      period;
+        double      budget;
+        unsigned    count;
+        int         used;
+        PinName     pin;
+        bool        ok = true;
+
+        if (sim_blank(lines[i]))
+            continue;
+        if (sscanf(line, "%lf repeat %u %lf%n", &ms, &count, &period, &used) == 3 && sim_blank(line + used)) {
+            size_t  first = i + 1;
+
+            while (++i < lines.size() && !(sscanf(lines[i].c_str(), "%63s", a) == 1 && strcmp(a, "end") == 0))
+                ;
+            for (unsigned r = 0; r < count && ok; r++)
+                for (size_t j = first; j < i && ok; j++)
+                    ok = sim_blank(lines[j]) || sim_line(lines[j].c_str(), ms + r * period);
+            if (i == lines.size()) {
+                fprintf(stderr, "%s:%u: repeat without end\n", sim_script.c_str(), (unsigned)first);
+                return false;
+            }
+        }
+        else if (sscanf(line, "budget %63s %63s %lf", a, b, &budget) == 3)
+            sim_latencies[std::string(a) + " -> " + b].budget_ms = budget;
+        else if (sscanf(line, "quiet %63s", a) == 1) {
+            ok = sim_pin(a, pin);
+            if (ok)
+                sim_quiet[pin] = true;
+        }
+        else
+            ok = sim_line(line, 0);
+
+        if (!ok) {
+            fprintf(stderr, "%s:%u: can't read '%s'\n", sim_script.c_str(), (unsigned)i + 1, line);
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+Results
+*/
+static bool sim_report_latencies(void)
+{
+    bool    failed = false;
+
+    // whatever is still awaited at the end never came
+    for (size_t i = 0; i < sim_measures.size(); i++)
+        sim_missed(sim_measures[i]);
+    sim_measures.clear();
+
+    if (sim_latencies.empty())
+        return false;
+
+    fprintf(stderr, "\n%-32s %6s %6s %9s %9s %9s %9s\n", "latency", "n", "missed", "p50 ms", "p99 ms", "max ms", "budget");
+    for (std::map<std::string, SimLatency>::const_iterator it = sim_latencies.begin(); it != sim_latencies.end(); ++it) {
+        const SimLatency&   l = it->second;
+        double              p99 = sim_percentile(l.ms, 99);
+
+        fprintf(stderr, "%-32s %6u %6u %9.3f %9.3f %9.3f", it->first.c_str(), (unsigned)l.ms.size(), (unsigned)l.missed,
+                sim_percentile(l.ms, 50), p99, sim_percentile(l.ms, 100));
+        if (l.budget_ms < 0) {
+            fprintf(stderr, " %9s\n", "-");
+            continue;
+        }
+
+        bool    over = l.ms.empty() || l.missed > 0 || p99 > l.budget_ms;
+
+        fprintf(stderr, " %9.1f%s\n", l.budget_ms, over ? "  FAIL" : "");
+        failed |= over;
+    }
+    return failed;
+}
+
+static bool sim_report_golden(void)
+{
+    if (sim_golden.empty())
+        return false;
+    if (sim_golden_error.empty() && sim_golden_line < sim_golden.size())
+        sim_golden_error = "trace ends before line " + std::to_string(sim_golden_line + 1) +
+                           " of the golden trace: '" + sim_golden[sim_golden_line] + "'";
+    if (sim_golden_error.empty())
+        fprintf(stderr, "\ngolden trace: %u lines match\n", (unsigned)sim_golden_line);
+    else
+        fprintf(stderr, "\ngolden trace: FAIL, %s\n", sim_golden_error.c_str());
+    return !sim_golden_error.empty();
+}
+
+static void sim_finished(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    double  wall = (now.tv_sec - sim_wall_start.tv_sec) + (now.tv_nsec - sim_wall_start.tv_nsec) / 1e9;
+    double  simulated = hal_now_us() / 1e6;
+
+    fprintf(stderr, "simulated %.1f s in %.2f s, %.0fx real time\n", simulated, wall, wall > 0 ? simulated / wall : 0);
+    fprintf(stderr, "%llu HAL calls, %llu interrupts, asleep %.1f%% of the time\n",
+            (unsigned long long)hal_accesses(), (unsigned long long)hal_interrupts(),
+            100.0 * hal_sleep_us() / hal_now_us());
+    fprintf(stderr, "DS18B20: %u resets, %u conversions, HC-SR04: %u pings\n",
+            sim_sensor->resets(), sim_sensor->conversions(), sim_ranger->pings());
+
+    bool    failed = sim_report_latencies();
+
+    failed |= sim_report_golden();
+    if (sim_out != NULL)
+        fflush(sim_out);
+    if (failed)
+        exit(1);
+}
+
+static FILE* sim_open(const char* path, const char* mode)
+{
+    FILE*   f = fopen(path, mode);
+
+    if (f == NULL) {
+        perror(path);
+        exit(1);
+    }
+    return f;
+}
+
+int main(int argc, char** argv)
+{
+    double      seconds = 60;
+    uint32_t    cost_ns = 1000;
+    const char* trace = NULL;
+    int         i;
+
+    for (i = 1; i < argc - 1 && argv[i][0] == '-' && argv[i][1] != 0; i += 2) {
+        if (strcmp(argv[i], "-t") == 0)
+            seconds = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "-o") == 0)
+            trace = argv[i + 1];
+        else if (strcmp(argv[i], "-g") == 0) {
+            FILE*   golden = sim_open(argv[i + 1], "r");
+            char    line[SIM_LINE_MAX];
+
+            while (fgets(line, sizeof(line), golden) != NULL) {
+                line[strcspn(line, "\r\n")] = 0;
+                if (line[0] != 0)
+                    sim_golden.push_back(line);
+            }
+            fclose(golden);
+        }
+        else if (strcmp(argv[i], "-j") == 0)
+            sim_tolerance_us = strtoull(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "-s") == 0)
+            hal_capture(USBTX, sim_open(argv[i + 1], "wb"));
+        else if (strcmp(argv[i], "-b") == 0)
+            hal_capture(house_pin(DEV_PHONE_TX), sim_open(argv[i + 1], "wb"));
+        else if (strcmp(argv[i], "-c") == 0)
+            cost_ns = atoi(argv[i + 1]);
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (trace != NULL)
+        sim_out = sim_open(trace, "w");
+    else if (sim_golden.empty())
+        sim_out = stdout;
+
+    Ds18b20Model    sensor(house_pin(DEV_TEMPERATURE));
+    Hcsr04Model     ranger(house_pin(DEV_RANGER_TRIGGER), house_pin(DEV_RANGER_ECHO));
+
+    sim_sensor = &sensor;
+    sim_ranger = &ranger;
+    hal_tap(house_pin(DEV_PHONE_TX), [](uint8_t b) { sim_listen(sim_phone_port, b, sim_phone_frame); });
+    hal_tap(USBTX, [](uint8_t b) { sim_listen(sim_tlm_port, b, sim_tlm_frame); });
+
+    if (i < argc) {
+        sim_script = argv[i];
+        if (!sim_load(sim_script == "-" ? stdin : sim_open(argv[i], "r")))
+            return 1;
+    }
+
+    hal_setup(cost_ns, (uint64_t)(seconds * 1e6), sim_finished);
+    hal_trace(sim_record);
+    clock_gettime(CLOCK_MONOTONIC, &sim_wall_start);
+
+    // the firmware only returns when it found no temperature sensor
+    firmware_main();
+    hal_finish();
+    return 0;
+}
@@ -0,0 +1,251 @@
+/*
+Measures where the time of the control loop of main.cpp goes. The firmware
+runs on the host stand-in of mbed.h (see host/house_sim) under a steady
+load: people moving through the zones, a drifting temperature, the phone
+sending commands and the garage door going up and down with something in
+its way now and then.
+
+Each subsystem of the loop is timed on its own, in the loop order, then
+house_loop() as a whole. The times are simulated: every HAL call (pin,
+timer, ADC, serial) costs -c ns, the waits of the drivers (1-Wire slots,
+serial FIFO full) take their real time and the interrupts that come in
+during a call are part of it, like on the LPC1768. Plain computation
+between HAL calls is free, so the numbers are a lower bound dominated by
+the I/O, which is what the loop spends its time on. Cycles are at
+SystemCoreClock (96 MHz).
+
+The results go to stdout as JSON, one object per subsystem with the mean,
+percentiles and a histogram of the iteration times (power of 2 buckets,
+"le_us" is the upper bound), a table goes to stderr.
+
+Build:
+    g++ -O2 -std=c++11 -I../mbed $(find ../.. -maxdepth 2 -type d -path '../../[A-Z]*' | sed 's/^/-I/') \
+        -o loop_bench loop_bench.cpp ../mbed/mbed.cpp ../mbed/HostHal.cpp ../mbed/HostDevices.cpp \
+        $(find ../.. -maxdepth 3 -path '../../[A-Z]*' -name '*.cpp')
+
+Use:
+    ./loop_bench [-t <seconds>] [-c <ns>] > loop_bench.json
+    -t  simulated time of each of the two runs (default 30)
+    -c  simulated time taken by one HAL call (default 1000)
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <functional>
+#include <map>
+#include "HostDevices.h"
+
+#define main firmware_main
+#include "../../main.cpp"
+#undef main
+
+#define BENCH_CORE_HZ   96000000
+#define BENCH_BUCKETS   24          // 1 us to 8 s
+
+// The iteration times are few distinct values, they are counted instead of kept
+struct BenchTask
+{
+    const char*                     name;
+    void                            (*run)(void);
+    std::map<uint32_t, uint32_t>    ns;
+    uint32_t                        iterations;
+    uint64_t                        total_ns;
+
+    void add(uint32_t t)
+    {
+        ns[t]++;
+        iterations++;
+        total_ns += t;
+    }
+};
+
+// In the order of house_loop()
+static BenchTask    bench_tasks[] = {
+    { "pir_sensor",         pir_sensor         },
+    { "smart_heating",      smart_heating      },
+    { "alarm",              alarm              },
+    { "flood_detector",     flood_detector     },
+    { "garage_door_opener", garage_door_opener },
+    { "phone_app",          phone_app          },
+    { "apply_outputs",      apply_outputs      },
+    { "publish_state",      publish_state      },
+    { "report_status",      report_status      },
+};
+
+#define BENCH_TASKS     (sizeof(bench_tasks) / sizeof(bench_tasks[0]))
+
+static BenchTask    bench_passes = { "subsystems", NULL };
+static BenchTask    bench_loop = { "house_loop", house_loop };
+
+static Ds18b20Model*    bench_sensor;
+static Hcsr04Model*     bench_ranger;
+static uint8_t          bench_phone_seq;
+
+/*
+Load
+*/
+static void bench_every(uint64_t period_us, std::function<void(uint32_t)> input, uint32_t n = 0)
+{
+    hal_at(hal_now_us() + period_us, [period_us, input, n]() {
+        input(n);
+        bench_every(period_us, input, n + 1);
+    });
+}
+
+static void bench_phone(const char* commands)
+{
+    uint8_t     frame[FRAMING_MAX_ENCODED(PHONE_MAX_PAYLOAD)];
+    CobsEncoder enc(frame, sizeof(frame));
+    size_t      n = strlen(commands);
+
+    enc.begin();
+    enc.put(PHONE_CMD);
+    enc.put(++bench_phone_seq);
+    enc.put((uint8_t)n);
+    enc.put((const uint8_t*)commands, n);
+
+    size_t      len = enc.finish();
+
+    hal_rx(house_pin(DEV_PHONE_RX), frame, len);
+}
+
+static void bench_load(void)
+{
+    static const char*  commands[] = { "2", "4", "35", "0", "4", "2", "53", "1" };
+
+    // motion in the zone every few seconds
+    bench_every(700000, [](uint32_t n) { hal_input(house_pin(DEV_PIR), (n % 5) < 2); });
+    // 19 to 25 C and back over a minute, under the aircon and fire thresholds
+    bench_every(1000000, [](uint32_t n) { bench_sensor->temperature(19.0f + 0.2f * (n % 60 < 30 ? n % 60 : 60 - n % 60)); });
+    // a dry floor, the sensor only sees noise
+    bench_every(200000, [](uint32_t n) { hal_analog(house_pin(DEV_WATER), 0.002f * (n % 4)); });
+    // a phone batch twice a second, the garage door commands are among them
+    bench_every(500000, [](uint32_t n) { bench_phone(commands[n % 8]); });
+    // something in front of the garage door for half a second every 7 s
+    bench_every(500000, [](uint32_t n) { bench_ranger->distance(n % 14 == 13 ? 5 : 200); });
+}
+
+/*
+Statistics
+*/
+// Nearest rank percentile in us
+static double bench_percentile(const BenchTask& task, double p)
+{
+    uint32_t    rank = (uint32_t)(p / 100.0 * task.iterations + 0.999999);
+    uint32_t    seen = 0;
+
+    for (std::map<uint32_t, uint32_t>::const_iterator it = task.ns.begin(); it != task.ns.end(); ++it) {
+        seen += it->second;
+        if (seen >= rank)
+            return it->first / 1000.0;
+    }
+    return 0;
+}
+
+static void bench_run(uint64_t us, std::function<void()> pass)
+{
+    uint64_t    end = hal_now_us() + us;
+
+    while (hal_now_us() < end)
+        pass();
+}
+
+static void bench_timed(BenchTask& task)
+{
+    uint64_t    start = hal_now_ns();
+
+    task.run();
+    task.add((uint32_t)(hal_now_ns() - start));
+}
+
+// 'loop_ns' is the time of the loop passes the task was part of
+static void bench_report(const BenchTask& task, uint64_t loop_ns, bool last)
+{
+    uint32_t    buckets[BENCH_BUCKETS] = { 0 };
+
+    for (std::map<uint32_t, uint32_t>::const_iterator it = task.ns.begin(); it != task.ns.end(); ++it) {
+        uint32_t    us = (it->first + 999) / 1000;
+        int         b = 0;
+
+        while (b < BENCH_BUCKETS - 1 && (1u << b) < us)
+            b++;
+        buckets[b] += it->second;
+    }
+
+    double  mean = task.iterations > 0 ? (double)task.total_ns / task.iterations : 0;
+    double  share = loop_ns > 0 ? (double)task.total_ns / loop_ns : 0;
+
+    printf("    {\"name\": \"%s\", \"iterations\": %u, \"mean_cycles\": %.0f, \"mean_us\": %.3f, "
+           "\"p50_us\": %.3f, \"p90_us\": %.3f, \"p99_us\": %.3f, \"p999_us\": %.3f, \"max_us\": %.3f, "
+           "\"share\": %.4f,\n     \"histogram\": [",
+           task.name, (unsigned)task.iterations, mean * BENCH_CORE_HZ / 1e9, mean / 1000,
+           bench_percentile(task, 50), bench_percentile(task, 90), bench_percentile(task, 99),
+           bench_percentile(task, 99.9), bench_percentile(task, 100), share);
+
+    bool    first = true;
+
+    for (int b = 0; b < BENCH_BUCKETS; b++)
+        if (buckets[b] > 0) {
+            printf("%s{\"le_us\": %u, \"count\": %u}", first ? "" : ", ", 1u << b, buckets[b]);
+            first = false;
+        }
+    printf("]}%s\n", last ? "" : ",");
+
+    fprintf(stderr, "%-20s %10u %12.0f %10.3f %10.3f %10.3f %10.3f %7.1f%%\n", task.name, (unsigned)task.iterations,
+            mean * BENCH_CORE_HZ / 1e9, mean / 1000, bench_percentile(task, 50), bench_percentile(task, 99),
+            bench_percentile(task, 100), 100.0 * share);
+}
+
+int main(int argc, char** argv)
+{
+    double      seconds = 30;
+    uint32_t    cost_ns = 1000;
+
+    for (int i = 1; i < argc - 1; i += 2) {
+        if (strcmp(argv[i], "-t") == 0)
+            seconds = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "-c") == 0)
+            cost_ns = atoi(argv[i + 1]);
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    Ds18b20Model    sensor(house_pin(DEV_TEMPERATURE));
+    Hcsr04Model     ranger(house_pin(DEV_RANGER_TRIGGER), house_pin(DEV_RANGER_ECHO));
+
+    bench_sensor = &sensor;
+    bench_ranger = &ranger;
+    hal_setup(cost_ns, 0, NULL);
+    set_time(1700000000);
+    bench_load();
+
+    if (!house_start()) {
+        fprintf(stderr, "the DS1820 was not found\n");
+        return 1;
+    }
+
+    uint64_t    run_us = (uint64_t)(seconds * 1e6);
+
+    bench_run(run_us, []() {
+        uint64_t    start = hal_now_ns();
+
+        for (size_t t = 0; t < BENCH_TASKS; t++)
+            bench_timed(bench_tasks[t]);
+        bench_passes.add((uint32_t)(hal_now_ns() - start));
+    });
+    bench_run(run_us, []() { bench_timed(bench_loop); });
+
+    fprintf(stderr, "%-20s %10s %12s %10s %10s %10s %10s %8s\n",
+            "", "iterations", "mean cycles", "mean us", "p50 us", "p99 us", "max us", "share");
+    printf("{\n  \"core_hz\": %u,\n  \"hal_access_ns\": %u,\n  \"simulated_s\": %.1f,\n  \"subsystems\": [\n",
+           BENCH_CORE_HZ, (unsigned)cost_ns, seconds);
+    for (size_t t = 0; t < BENCH_TASKS; t++)
+        bench_report(bench_tasks[t], bench_passes.total_ns, t == BENCH_TASKS - 1);
+    printf("  ],\n  \"loop\": [\n");
+    bench_report(bench_passes, bench_passes.total_ns, false);
+    bench_report(bench_loop, bench_loop.total_ns, true);
+    printf("  ]\n}\n");
+    return 0;
+}
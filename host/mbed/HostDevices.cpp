@@ -0,0 +1,334 @@
+#include "HostDevices.h"
+#include "OneWireCapture.h"
+#include <math.h>
+#include <string.h>
+
+#define HCSR04_DELAY_US     450     // trigger to echo, the 40 kHz burst goes out first
+#define HCSR04_RANGE_CM     400
+#define HCSR04_NO_ECHO_US   38000
+#define HCSR04_US_PER_CM    58
+
+#define OW_RESET_US         480     // a low pulse this long is a reset
+#define OW_PRESENCE_US      30      // presence pulse starts after
+#define OW_PRESENCE_LEN_US  120
+#define OW_SLOT_US          15      // master releases before this: 1, after: 0
+#define OW_ZERO_US          30      // the sensor holds a 0 this long
+
+/*
+HC-SR04
+*/
+Hcsr04Model::Hcsr04Model(PinName trigger, PinName echo, uint16_t distance_cm /*= 200*/) :
+    _echo(echo),
+    _distance_cm(distance_cm),
+    _rise_us(0),
+    _busy_until(0),
+    _pings(0)
+{
+    hal_attach(trigger, this);
+    hal_input(_echo, 0);
+}
+
+void Hcsr04Model::driven(PinName pin, int level)
+{
+    uint64_t    now = hal_now_us();
+
+    if (level) {
+        _rise_us = now;
+        return;
+    }
+    if (now - _rise_us < 10 || now < _busy_until)
+        return;
+
+    uint64_t    start = now + HCSR04_DELAY_US;
+    uint32_t    width = _distance_cm <= HCSR04_RANGE_CM ? _distance_cm * HCSR04_US_PER_CM : HCSR04_NO_ECHO_US;
+    PinName     echo = _echo;
+
+    _pings++;
+    _busy_until = start + width;
+    hal_at(start, [echo]() { hal_input(echo, 1); });
+    hal_at(start + width, [echo]() { hal_input(echo, 0); });
+}
+
+/*
+DS18B20
+*/
+Ds18b20Model::Ds18b20Model(PinName pin, uint64_t serial /*= 1*/, uint32_t conversion_us /*= 600000*/) :
+    _temperature(20),
+    _connected(true),
+    _conversion_us(conversion_us),
+    _state(IDLE),
+    _master(1),
+    _fall_us(0),
+    _slotTx(false),
+    _low_from(0),
+    _low_until(0),
+    _rxByte(0),
+    _rxBits(0),
+    _rxCount(0),
+    _txLen(0),
+    _txBit(0),
+    _searchBit(0),
+    _searchPhase(0),
+    _resets(0),
+    _conversions(0)
+{
+    _rom[0] = 0x28;     // family code
+    for (int i = 1; i < 7; i++)
+        _rom[i] = (uint8_t)(serial >> (8 * (i - 1)));
+    _rom[7] = crc8(_rom, 7);
+
+    // power-up scratchpad: 85 C, alarm limits, 12-bit resolution
+    static const uint8_t    POWER_UP[8] = { 0x50, 0x05, 0x4B, 0x46, 0x7F, 0xFF, 0x0C, 0x10 };
+
+    memcpy(_scratchpad, POWER_UP, 8);
+    _scratchpad[8] = crc8(_scratchpad, 8);
+    hal_attach(pin, this);
+}
+
+uint8_t Ds18b20Model::crc8(const uint8_t* data, uint8_t len)
+{
+    uint8_t crc = 0;
+
+    while (len--) {
+        uint8_t b = *data++;
+
+        for (int i = 0; i < 8; i++) {
+            uint8_t mix = (crc ^ b) & 0x01;
+
+            crc >>= 1;
+            if (mix)
+                crc ^= 0x8C;
+            b >>= 1;
+        }
+    }
+    return crc;
+}
+
+void Ds18b20Model::latch(void)
+{
+    int16_t raw = (int16_t)lroundf(_temperature * 16);
+    uint8_t res = 9 + ((_scratchpad[4] >> 5) & 3);
+
+    raw &= ~((1 << (12 - res)) - 1);    // undefined low bits at lower resolutions
+    _scratchpad[0] = (uint8_t)raw;
+    _scratchpad[1] = (uint8_t)(raw >> 8);
+    _scratchpad[8] = crc8(_scratchpad, 8);
+}
+
+void Ds18b20Model::transmit(const uint8_t* data, uint8_t len)
+{
+    memcpy(_txBuf, data, len);
+    _txLen = len;
+    _txBit = 0;
+    _state = TRANSMIT;
+}
+
+uint8_t Ds18b20Model::nextBit(void)
+{
+    if (_state == SEARCH_ROM) {
+        uint8_t b = (_rom[_searchBit / 8] >> (_searchBit % 8)) & 1;
+
+        // the bit, then its complement
+        return _searchPhase++ == 0 ? b : !b;
+    }
+
+    uint8_t b = (_txBuf[_txBit / 8] >> (_txBit % 8)) & 1;
+
+    if (++_txBit == _txLen * 8)
+        _state = IDLE;
+    return b;
+}
+
+void Ds18b20Model::bit(uint8_t b)
+{
+    if (_state == SEARCH_ROM) {
+        // the master picked a direction, devices that don't match drop out
+        if (b != ((_rom[_searchBit / 8] >> (_searchBit % 8)) & 1))
+            _state = IDLE;
+        else if (++_searchBit == 64)
+            _state = IDLE;
+        _searchPhase = 0;
+        return;
+    }
+
+    _rxByte |= b << _rxBits;
+    if (++_rxBits == 8) {
+        uint8_t v = _rxByte;
+
+        _rxByte = 0;
+        _rxBits = 0;
+        byte(v);
+    }
+}
+
+void Ds18b20Model::byte(uint8_t b)
+{
+    switch (_state) {
+    case ROM_COMMAND:
+        if (b == 0xF0) {            // SEARCH ROM
+            _state = SEARCH_ROM;
+            _searchBit = 0;
+            _searchPhase = 0;
+        }
+        else if (b == 0x33)         // READ ROM
+            transmit(_rom, 8);
+        else if (b == 0x55) {       // MATCH ROM
+            _state = MATCH_ROM;
+            _rxCount = 0;
+        }
+        else if (b == 0xCC)         // SKIP ROM
+            _state = FUNCTION;
+        else
+            _state = IDLE;
+        break;
+
+    case MATCH_ROM:
+        if (b != _rom[_rxCount])
+            _state = IDLE;
+        else if (++_rxCount == 8)
+            _state = FUNCTION;
+        break;
+
+    case FUNCTION:
+        if (b == 0x44) {            // CONVERT T
+            _conversions++;
+            _conversion.schedule(hal_now_us() + _conversion_us, [this]() { latch(); });
+            _state = IDLE;
+        }
+        else if (b == 0xBE)         // READ SCRATCHPAD
+            transmit(_scratchpad, 9);
+        else if (b == 0x4E) {       // WRITE SCRATCHPAD: TH, TL, config
+            _state = WRITE_SCRATCHPAD;
+            _rxCount = 0;
+        }
+        else
+            _state = IDLE;
+        break;
+
+    case WRITE_SCRATCHPAD:
+        _scratchpad[2 + _rxCount] = _rxCount == 2 ? (b & 0x60) | 0x1F : b;
+        if (++_rxCount == 3) {
+            _scratchpad[8] = crc8(_scratchpad, 8);
+            _state = IDLE;
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+void Ds18b20Model::driven(PinName pin, int level)
+{
+    uint64_t    now = hal_now_us();
+
+    if (level == _master)
+        return;
+    _master = level;
+    if (!_connected)
+        return;
+
+    // falling edge: a time slot starts, a 0 to send is held for OW_ZERO_US
+    if (!level) {
+        _fall_us = now;
+        _slotTx = _state == TRANSMIT || (_state == SEARCH_ROM && _searchPhase < 2);
+        if (_slotTx)
+            if (!nextBit()) {
+                _low_from = now;
+                _low_until = now + OW_ZERO_US;
+            }
+        return;
+    }
+
+    // rising edge: the length of the low pulse is a reset, a 1 or a 0
+    uint64_t    low = now - _fall_us;
+
+    if (low >= OW_RESET_US) {
+        _resets++;
+        _low_from = now + OW_PRESENCE_US;
+        _low_until = _low_from + OW_PRESENCE_LEN_US;
+        _state = ROM_COMMAND;
+        _rxByte = 0;
+        _rxBits = 0;
+        return;
+    }
+    if (_slotTx)
+        return;
+    if (_state == ROM_COMMAND || _state == MATCH_ROM || _state == FUNCTION || _state == WRITE_SCRATCHPAD ||
+        (_state == SEARCH_ROM && _searchPhase == 2))
+        bit(low < OW_SLOT_US ? 1 : 0);
+}
+
+int Ds18b20Model::level(PinName pin)
+{
+    uint64_t    now = hal_now_us();
+
+    return !(_connected && now >= _low_from && now < _low_until);
+}
+
+/*
+1-Wire replay
+*/
+OneWireReplayModel::OneWireReplayModel(PinName pin, const uint16_t* slots, uint32_t count, uint32_t hold_us /*= 30*/) :
+    _slots(slots),
+    _count(count),
+    _next(0),
+    _hold_us(hold_us),
+    _mismatches(0),
+    _master(1),
+    _fall_us(0),
+    _low_from(0),
+    _low_until(0)
+{
+    hal_attach(pin, this);
+}
+
+void OneWireReplayModel::driven(PinName pin, int level)
+{
+    uint64_t    now = hal_now_us();
+
+    if (level == _master)
+        return;
+    _master = level;
+
+    // falling edge: a read slot recorded as 0 is answered with one
+    if (!level) {
+        _fall_us = now;
+        if (!done() && ONEWIRE_SLOT_KIND(_slots[_next]) == ONEWIRE_SLOT_READ && !ONEWIRE_SLOT_VALUE(_slots[_next])) {
+            _low_from = now;
+            _low_until = now + _hold_us;
+        }
+        return;
+    }
+
+    // rising edge: the slot is over, the kind is known from the low pulse
+    uint64_t    low = now - _fall_us;
+
+    if (done()) {
+        _mismatches++;
+        return;
+    }
+
+    uint16_t    slot = _slots[_next++];
+
+    if (low >= OW_RESET_US) {
+        if (ONEWIRE_SLOT_KIND(slot) != ONEWIRE_SLOT_RESET)
+            _mismatches++;
+        else if (ONEWIRE_SLOT_VALUE(slot)) {
+            _low_from = now + OW_PRESENCE_US;
+            _low_until = _low_from + OW_PRESENCE_LEN_US;
+        }
+        return;
+    }
+    if (ONEWIRE_SLOT_KIND(slot) == ONEWIRE_SLOT_READ)
+        return;
+    if (ONEWIRE_SLOT_KIND(slot) != ONEWIRE_SLOT_WRITE || (low < OW_SLOT_US ? 1 : 0) != ONEWIRE_SLOT_VALUE(slot))
+        _mismatches++;
+}
+
+int OneWireReplayModel::level(PinName pin)
+{
+    uint64_t    now = hal_now_us();
+
+    return !(now >= _low_from && now < _low_until);
+}
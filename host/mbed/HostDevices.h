@@ -0,0 +1,125 @@
+#ifndef HOST_DEVICES_H_
+#define HOST_DEVICES_H_
+
+#include "HostHal.h"
+
+/**
+ * HC-SR04 ultrasonic ranger.
+ * Answers a trigger pulse of at least 10 us with an echo pulse of 58 us per
+ * cm of the distance, or a 38 ms pulse when nothing is in range. Triggers
+ * while an echo is still running are ignored, like on the real sensor.
+ */
+class Hcsr04Model : public HalPinModel
+{
+    PinName     _echo;
+    uint16_t    _distance_cm;
+    uint64_t    _rise_us;
+    uint64_t    _busy_until;
+    uint32_t    _pings;
+
+public:
+    Hcsr04Model(PinName trigger, PinName echo, uint16_t distance_cm = 200);
+
+    void        distance(uint16_t cm) { _distance_cm = cm; }
+    uint32_t    pings(void) const { return _pings; }
+
+    virtual void    driven(PinName pin, int level);
+};
+
+/**
+ * DS18B20 on a 1-Wire bus.
+ * Decodes the time slots of the bus master from the edges it drives and
+ * answers reset (presence pulse), SEARCH ROM, READ ROM, MATCH ROM, SKIP ROM,
+ * CONVERT T, READ and WRITE SCRATCHPAD. A conversion latches the current
+ * temperature after 'conversion_us'. A disconnected sensor leaves the bus
+ * alone.
+ */
+class Ds18b20Model : public HalPinModel
+{
+    enum State {
+        IDLE,           // deselected, waits for a reset
+        ROM_COMMAND,
+        MATCH_ROM,
+        SEARCH_ROM,
+        FUNCTION,
+        TRANSMIT,
+        WRITE_SCRATCHPAD
+    };
+
+    uint8_t     _rom[8];
+    uint8_t     _scratchpad[9];
+    float       _temperature;
+    bool        _connected;
+    uint32_t    _conversion_us;
+    HalEvent    _conversion;
+
+    State       _state;
+    int         _master;
+    uint64_t    _fall_us;
+    bool        _slotTx;        // the current time slot is one the sensor answers
+    uint64_t    _low_from;      // the sensor pulls the bus low in [_low_from, _low_until)
+    uint64_t    _low_until;
+    uint8_t     _rxByte;
+    uint8_t     _rxBits;
+    uint8_t     _rxCount;
+    uint8_t     _txBuf[9];
+    uint8_t     _txLen;
+    uint16_t    _txBit;
+    uint8_t     _searchBit;
+    uint8_t     _searchPhase;
+
+    uint32_t    _resets;
+    uint32_t    _conversions;
+
+    void        latch(void);
+    void        bit(uint8_t b);
+    void        byte(uint8_t b);
+    void        transmit(const uint8_t* data, uint8_t len);
+    uint8_t     nextBit(void);
+
+public:
+    Ds18b20Model(PinName pin, uint64_t serial = 1, uint32_t conversion_us = 600000);
+
+    void        temperature(float celsius) { _temperature = celsius; }
+    void        connect(bool connected) { _connected = connected; }
+    const uint8_t*  rom(void) const { return _rom; }
+    uint32_t    resets(void) const { return _resets; }
+    uint32_t    conversions(void) const { return _conversions; }
+
+    static uint8_t  crc8(const uint8_t* data, uint8_t len);
+
+    virtual void    driven(PinName pin, int level);
+    virtual int     level(PinName pin);
+};
+
+/**
+ * 1-Wire bus played back from a capture (see OneWireCapture.h).
+ * Takes the recorded slots in order: a reset gets a presence pulse when
+ * one was recorded, a read slot recorded as 0 is held low for 'hold_us'
+ * from its falling edge. A slot of another kind than recorded, or a write
+ * the device would have seen as the other bit, is a mismatch.
+ */
+class OneWireReplayModel : public HalPinModel
+{
+    const uint16_t* _slots;
+    uint32_t    _count;
+    uint32_t    _next;
+    uint32_t    _hold_us;
+    uint32_t    _mismatches;
+
+    int         _master;
+    uint64_t    _fall_us;
+    uint64_t    _low_from;      // the device pulls the bus low in [_low_from, _low_until)
+    uint64_t    _low_until;
+
+public:
+    OneWireReplayModel(PinName pin, const uint16_t* slots, uint32_t count, uint32_t hold_us = 30);
+
+    void        rewind(void) { _next = 0; }
+    bool        done(void) const { return _next >= _count; }
+    uint32_t    mismatches(void) const { return _mismatches; }
+
+    virtual void    driven(PinName pin, int level);
+    virtual int     level(PinName pin);
+};
+#endif /* HOST_DEVICES_H_ */
@@ -0,0 +1,618 @@
+#include "HostHal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <set>
+
+#define UART_FIFO   16      // LPC1768 UART FIFOs, both ways
+
+struct HalPin
+{
+    PinMode         mode;
+    bool            output;
+    int             drive;
+    int             master;     // level the firmware drives, 1 when released
+    int             input;      // level from outside, -1 floating
+    int             traced;     // last level traced, -1 none yet
+    float           analog;
+    uint32_t        period_us;
+    uint32_t        pulse_us;
+    HalPinModel*    model;
+    HalHandler      rise;
+    HalHandler      fall;
+};
+
+struct HalUart
+{
+    bool                open;
+    PinName             rx;
+    uint32_t            byte_us;
+    uint64_t            tx_done;    // the last byte written has left the wire
+    uint64_t            rx_done;    // the last byte injected has arrived
+    std::deque<uint8_t> fifo;
+    uint32_t            overruns;
+    HalHandler          irq;
+    FILE*               capture;
+    HalByteHandler      tap;
+};
+
+class HalScheduler
+{
+    struct Order
+    {
+        bool operator()(const HalEvent* a, const HalEvent* b) const
+        {
+            return a->_at != b->_at ? a->_at < b->_at : a->_seq < b->_seq;
+        }
+    };
+
+    std::set<HalEvent*, Order>  _queue;
+    uint64_t                    _seq;
+
+public:
+    HalScheduler() : _seq(0) { }
+
+    void    insert(HalEvent* e, uint64_t at, HalHandler handler);
+    void    remove(HalEvent* e);
+    bool    due(uint64_t until) const { return !_queue.empty() && (*_queue.begin())->_at <= until; }
+    bool    empty(void) const { return _queue.empty(); }
+    uint64_t    next(void) const { return (*_queue.begin())->_at; }
+    HalHandler  pop(void);
+};
+
+struct Hal
+{
+    uint64_t        now;
+    uint32_t        access_ns;
+    uint32_t        frac_ns;
+    uint64_t        end_us;
+    void            (*finish)(void);
+    bool            finishing;
+    bool            in_isr;
+    bool            primask;
+    uint64_t        accesses;
+    uint64_t        interrupts;
+    uint64_t        slept_us;
+    uint32_t        rtc_base;
+    uint64_t        rtc_set_us;
+    HalTraceSink    trace;
+    HalScheduler    events;
+    HalPin          pins[PIN_COUNT];
+    HalUart         uarts[PIN_COUNT];
+    PinName         rx_owner[PIN_COUNT];
+
+    Hal() :
+        now(0), access_ns(1000), frac_ns(0), end_us(0), finish(NULL), finishing(false),
+        in_isr(false), primask(false), accesses(0), interrupts(0), slept_us(0),
+        rtc_base(0), rtc_set_us(0)
+    {
+        for (int i = 0; i < PIN_COUNT; i++) {
+            HalPin& p = pins[i];
+
+            p.mode = PullDefault;
+            p.output = false;
+            p.drive = 0;
+            p.master = 1;
+            p.input = -1;
+            p.traced = -1;
+            p.analog = 0;
+            p.period_us = 20000;
+            p.pulse_us = 0;
+            p.model = NULL;
+
+            HalUart&    u = uarts[i];
+
+            u.open = false;
+            u.rx = NC;
+            u.byte_us = 1042;
+            u.tx_done = 0;
+            u.rx_done = 0;
+            u.overruns = 0;
+            u.capture = NULL;
+            rx_owner[i] = NC;
+        }
+    }
+};
+
+// Function static so the drivers constructed before main() (globals of the firmware) find it ready
+static Hal& hal(void)
+{
+    static Hal  h;
+
+    return h;
+}
+
+static const char* PIN_NAMES[PIN_COUNT] = {
+    "p5", "p6", "p7", "p8", "p9", "p10", "p11", "p12", "p13", "p14", "p15", "p16", "p17", "p18",
+    "p19", "p20", "p21", "p22", "p23", "p24", "p25", "p26", "p27", "p28", "p29", "p30",
+    "LED1", "LED2", "LED3", "LED4",
+    "USBTX", "USBRX"
+};
+
+/*
+Scheduler
+*/
+void HalScheduler::insert(HalEvent* e, uint64_t at, HalHandler handler)
+{
+    remove(e);
+    e->_at = at;
+    e->_seq = _seq++;
+    e->_handler = handler;
+    e->_queued = true;
+    _queue.insert(e);
+}
+
+void HalScheduler::remove(HalEvent* e)
+{
+    if (e->_queued) {
+        _queue.erase(e);
+        e->_queued = false;
+    }
+}
+
+HalHandler HalScheduler::pop(void)
+{
+    HalEvent*   e = *_queue.begin();
+
+    _queue.erase(_queue.begin());
+    e->_queued = false;
+    return e->_handler;     // a copy, the handler may reschedule or delete its event
+}
+
+HalEvent::HalEvent() :
+    _at(0),
+    _seq(0),
+    _queued(false)
+{ }
+
+HalEvent::~HalEvent()
+{
+    cancel();
+}
+
+void HalEvent::schedule(uint64_t at_us, HalHandler handler)
+{
+    hal().events.insert(this, at_us, handler);
+}
+
+void HalEvent::cancel(void)
+{
+    hal().events.remove(this);
+}
+
+/*
+Clock
+*/
+static bool dispatchable(void)
+{
+    return !hal().in_isr && !hal().primask;
+}
+
+static void check_end(void)
+{
+    Hal&    h = hal();
+
+    if (h.end_us != 0 && h.now >= h.end_us && !h.finishing)
+        hal_finish();
+}
+
+// Runs the interrupts that are due at the current time
+static void run_due(void)
+{
+    Hal&    h = hal();
+
+    while (dispatchable() && h.events.due(h.now)) {
+        HalHandler  handler = h.events.pop();
+
+        h.in_isr = true;
+        h.interrupts++;
+        handler();
+        h.in_isr = false;
+        check_end();
+    }
+}
+
+void hal_setup(uint32_t access_ns, uint64_t end_us, void (*finish)(void))
+{
+    hal().access_ns = access_ns;
+    hal().end_us = end_us;
+    hal().finish = finish;
+}
+
+void hal_trace(HalTraceSink sink)
+{
+    hal().trace = sink;
+}
+
+void hal_record(PinName pin, const char* kind, const char* value)
+{
+    Hal&    h = hal();
+
+    if (h.trace)
+        h.trace(h.now, pin, kind, value);
+}
+
+void hal_finish(void)
+{
+    Hal&    h = hal();
+
+    h.finishing = true;
+    if (h.finish != NULL)
+        h.finish();
+    for (int i = 0; i < PIN_COUNT; i++)
+        if (h.uarts[i].capture != NULL)
+            fflush(h.uarts[i].capture);
+    exit(0);
+}
+
+uint64_t hal_now_us(void)
+{
+    return hal().now;
+}
+
+uint64_t hal_now_ns(void)
+{
+    return hal().now * 1000 + hal().frac_ns;
+}
+
+void hal_access(void)
+{
+    Hal&    h = hal();
+
+    h.accesses++;
+    h.frac_ns += h.access_ns;
+    if (h.frac_ns >= 1000) {
+        uint32_t    us = h.frac_ns / 1000;
+
+        h.frac_ns -= us * 1000;
+        hal_advance(us);
+    }
+}
+
+void hal_advance(uint64_t us)
+{
+    Hal&        h = hal();
+    uint64_t    target = h.now + us;
+
+    // interrupts that come due on the way run at their time, they may move the clock past 'target'
+    while (dispatchable() && h.events.due(target > h.now ? target : h.now)) {
+        if (h.events.next() > h.now)
+            h.now = h.events.next();
+        run_due();
+    }
+    if (target > h.now)
+        h.now = target;
+    check_end();
+}
+
+void hal_sleep(void)
+{
+    Hal&    h = hal();
+
+    // WFI wakes up on the next interrupt, a masked one included
+    if (!h.events.empty() && h.events.next() > h.now) {
+        h.slept_us += h.events.next() - h.now;
+        hal_advance(h.events.next() - h.now);
+    }
+    else if (h.events.empty() && h.end_us > h.now) {
+        h.slept_us += h.end_us - h.now;
+        hal_advance(h.end_us - h.now);
+    }
+    else
+        hal_access();
+}
+
+void hal_at(uint64_t at_us, HalHandler handler)
+{
+    HalEvent*   e = new HalEvent;
+
+    e->schedule(at_us, [e, handler]() {
+        delete e;
+        handler();
+    });
+}
+
+bool hal_in_isr(void)
+{
+    return hal().in_isr;
+}
+
+uint64_t hal_accesses(void)
+{
+    return hal().accesses;
+}
+
+uint64_t hal_interrupts(void)
+{
+    return hal().interrupts;
+}
+
+uint64_t hal_sleep_us(void)
+{
+    return hal().slept_us;
+}
+
+/*
+Interrupt mask, PRIMASK does not nest
+*/
+void hal_irq_disable(void)
+{
+    hal().primask = true;
+}
+
+void hal_irq_enable(void)
+{
+    hal().primask = false;
+    run_due();
+}
+
+uint32_t hal_irq_state(void)
+{
+    return hal().primask ? 1 : 0;
+}
+
+void hal_irq_restore(uint32_t state)
+{
+    if (state)
+        hal_irq_disable();
+    else
+        hal_irq_enable();
+}
+
+/*
+Real time clock
+*/
+uint32_t hal_rtc(void)
+{
+    return hal().rtc_base + (uint32_t)((hal().now - hal().rtc_set_us) / 1000000);
+}
+
+void hal_set_rtc(uint32_t seconds)
+{
+    hal().rtc_base = seconds;
+    hal().rtc_set_us = hal().now;
+}
+
+/*
+Pins
+*/
+const char* hal_pin_name(PinName pin)
+{
+    return (pin >= 0 && pin < PIN_COUNT) ? PIN_NAMES[pin] : "NC";
+}
+
+PinName hal_pin_by_name(const char* name)
+{
+    for (int i = 0; i < PIN_COUNT; i++)
+        if (strcmp(name, PIN_NAMES[i]) == 0)
+            return (PinName)i;
+    return NC;
+}
+
+static int level(PinName pin)
+{
+    HalPin& p = hal().pins[pin];
+    int     v;
+
+    if (p.output)
+        v = p.drive;
+    else if (p.input >= 0)
+        v = p.input;
+    else
+        v = (p.mode == PullUp || p.mode == OpenDrain) ? 1 : 0;
+    if (p.model != NULL && !p.model->level(pin))
+        v = 0;
+    return v;
+}
+
+static void notify(PinName pin)
+{
+    HalPin& p = hal().pins[pin];
+    int     master = p.output ? p.drive : 1;
+
+    if (master != p.master) {
+        p.master = master;
+        if (p.model != NULL)
+            p.model->driven(pin, master);
+    }
+}
+
+void hal_attach(PinName pin, HalPinModel* model)
+{
+    hal().pins[pin].model = model;
+}
+
+void hal_mode(PinName pin, PinMode mode)
+{
+    hal().pins[pin].mode = mode;
+}
+
+void hal_drive(PinName pin, int level, bool traced)
+{
+    HalPin& p = hal().pins[pin];
+
+    p.output = true;
+    p.drive = level ? 1 : 0;
+    if (traced && p.traced != p.drive) {
+        p.traced = p.drive;
+        hal_record(pin, "out", p.drive ? "1" : "0");
+    }
+    notify(pin);
+}
+
+void hal_release(PinName pin)
+{
+    hal().pins[pin].output = false;
+    notify(pin);
+}
+
+int hal_read(PinName pin)
+{
+    return level(pin);
+}
+
+void hal_input(PinName pin, int value)
+{
+    HalPin& p = hal().pins[pin];
+    int     before = level(pin);
+
+    p.input = value < 0 ? -1 : (value ? 1 : 0);
+
+    int     after = level(pin);
+
+    // the edge interrupt runs when it can, the handler is looked up then
+    if (after != before)
+        hal_at(hal().now, [pin, after]() {
+            HalPin& q = hal().pins[pin];
+            HalHandler& handler = after ? q.rise : q.fall;
+
+            if (handler)
+                handler();
+        });
+}
+
+void hal_edges(PinName pin, HalHandler rise, HalHandler fall)
+{
+    hal().pins[pin].rise = rise;
+    hal().pins[pin].fall = fall;
+}
+
+void hal_analog(PinName pin, float value)
+{
+    hal().pins[pin].analog = value < 0 ? 0 : (value > 1 ? 1 : value);
+}
+
+float hal_analog_read(PinName pin)
+{
+    return hal().pins[pin].analog;
+}
+
+void hal_pwm(PinName pin, uint32_t period_us, uint32_t pulse_us)
+{
+    HalPin& p = hal().pins[pin];
+
+    if (period_us == p.period_us && pulse_us == p.pulse_us && p.traced >= 0)
+        return;
+    p.period_us = period_us;
+    p.pulse_us = pulse_us;
+    p.traced = 1;
+
+    char    value[24];
+
+    snprintf(value, sizeof(value), "%u %u", period_us, pulse_us);
+    hal_record(pin, "pwm", value);
+}
+
+/*
+Serial ports
+*/
+void hal_uart_open(PinName tx, PinName rx, int baud)
+{
+    Hal&        h = hal();
+    HalUart&    u = h.uarts[tx];
+
+    u.open = true;
+    u.rx = rx;
+    if (rx != NC)
+        h.rx_owner[rx] = tx;
+    hal_uart_baud(tx, baud);
+}
+
+void hal_uart_baud(PinName tx, int baud)
+{
+    // 8N1, ten bits a byte
+    hal().uarts[tx].byte_us = (10000000 + baud / 2) / baud;
+}
+
+void hal_uart_putc(PinName tx, uint8_t b)
+{
+    Hal&        h = hal();
+    HalUart&    u = h.uarts[tx];
+    uint64_t    room = (UART_FIFO - 1) * (uint64_t)u.byte_us;
+
+    // blocks while the TX FIFO is full, like the target
+    hal_access();
+    while (u.tx_done > h.now + room)
+        hal_advance(u.tx_done - room - h.now);
+    u.tx_done = (u.tx_done > h.now ? u.tx_done : h.now) + u.byte_us;
+
+    if (u.capture != NULL)
+        fputc(b, u.capture);
+    if (u.tap)
+        hal_at(u.tx_done, [tx, b]() {
+            hal().uarts[tx].tap(b);
+        });
+}
+
+bool hal_uart_writeable(PinName tx)
+{
+    HalUart&    u = hal().uarts[tx];
+
+    hal_access();
+    return u.tx_done <= hal().now + (UART_FIFO - 1) * (uint64_t)u.byte_us;
+}
+
+bool hal_uart_readable(PinName tx)
+{
+    hal_access();
+    return !hal().uarts[tx].fifo.empty();
+}
+
+int hal_uart_getc(PinName tx)
+{
+    HalUart&    u = hal().uarts[tx];
+
+    // blocks until a byte arrives
+    hal_access();
+    while (u.fifo.empty())
+        hal_sleep();
+
+    uint8_t     b = u.fifo.front();
+
+    u.fifo.pop_front();
+    return b;
+}
+
+void hal_uart_irq(PinName tx, HalHandler rx)
+{
+    hal().uarts[tx].irq = rx;
+}
+
+void hal_rx(PinName rx, const uint8_t* data, size_t len)
+{
+    Hal&    h = hal();
+    PinName tx = h.rx_owner[rx];
+
+    if (tx == NC)
+        return;     // nobody listens on that pin
+
+    HalUart&    u = h.uarts[tx];
+
+    // the bytes follow each other on the wire
+    for (size_t i = 0; i < len; i++) {
+        uint8_t b = data[i];
+
+        u.rx_done = (u.rx_done > h.now ? u.rx_done : h.now) + u.byte_us;
+        hal_at(u.rx_done, [tx, b]() {
+            HalUart&    v = hal().uarts[tx];
+
+            if (v.fifo.size() >= UART_FIFO) {
+                v.overruns++;
+                return;
+            }
+            v.fifo.push_back(b);
+            if (v.irq)
+                v.irq();
+        });
+    }
+}
+
+void hal_capture(PinName tx, FILE* out)
+{
+    hal().uarts[tx].capture = out;
+}
+
+void hal_tap(PinName tx, HalByteHandler tap)
+{
+    hal().uarts[tx].tap = tap;
+}
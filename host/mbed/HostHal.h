@@ -0,0 +1,132 @@
+#ifndef HOST_HAL_H_
+#define HOST_HAL_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <functional>
+#include "PinNames.h"
+
+/**
+ * Virtual hardware behind the host stand-in of mbed.h.
+ *
+ * Time is a 64-bit microsecond clock which only moves when the firmware
+ * waits, sleeps or touches the hardware. Every HAL call (pin, timer, ADC,
+ * serial access) costs hal_access_ns of simulated time, so the main loop
+ * advances the clock about as fast as it would on the LPC1768 and polling
+ * loops still end.
+ *
+ * Tickers, Timeouts, received serial bytes, pin edges and scripted inputs
+ * are events on one queue. An event runs as an interrupt as soon as the
+ * clock reaches it, unless an interrupt is already running or interrupts
+ * are disabled: then it runs late, when that ends, like on the target.
+ * Interrupts are never nested.
+ *
+ * Inputs are set with hal_input(), hal_analog() and hal_rx(), at a later
+ * time with hal_at(). Peripheral models (HostDevices.h) hook into pins with
+ * HalPinModel. Every change of an output pin goes to the trace sink, the
+ * bytes sent on a serial port can be captured or tapped.
+ *
+ * Trace records, as written by host/house_sim:
+ *     <time_us> <pin> out <level>
+ *     <time_us> <pin> pwm <period_us> <pulse_us>
+ *     <time_us> <pin> <kind> <value>           from hal_record()
+ */
+
+typedef std::function<void()>          HalHandler;
+typedef std::function<void(uint8_t)>   HalByteHandler;
+typedef std::function<void(uint64_t at_us, PinName pin, const char* kind, const char* value)>  HalTraceSink;
+
+/**
+ * Peripheral attached to a pin.
+ * driven() is called whenever the firmware changes the level it drives on
+ * the pin (1 when released), level() is the level the peripheral pulls the
+ * pin to, 1 when it leaves it alone.
+ */
+class HalPinModel
+{
+public:
+    virtual ~HalPinModel() { }
+
+    virtual void    driven(PinName pin, int level) { }
+    virtual int     level(PinName pin) { return 1; }
+};
+
+/**
+ * Event on the virtual clock.
+ * Owned by the caller (Ticker, Timeout, models), schedule() moves it when
+ * it is already queued.
+ */
+class HalEvent
+{
+    uint64_t    _at;
+    uint64_t    _seq;
+    bool        _queued;
+    HalHandler  _handler;
+
+    friend class HalScheduler;
+
+public:
+    HalEvent();
+    ~HalEvent();
+
+    void        schedule(uint64_t at_us, HalHandler handler);
+    void        cancel(void);
+    bool        queued(void) const { return _queued; }
+    uint64_t    at(void) const { return _at; }
+};
+
+// Setup, 'end_us' 0 runs forever. 'finish' is called once the clock reaches 'end_us', before exiting.
+void        hal_setup(uint32_t access_ns, uint64_t end_us, void (*finish)(void));
+void        hal_trace(HalTraceSink sink);
+void        hal_record(PinName pin, const char* kind, const char* value);
+void        hal_finish(void);
+
+// Clock
+uint64_t    hal_now_us(void);
+uint64_t    hal_now_ns(void);       // with the part of a us the HAL calls have taken so far
+void        hal_access(void);
+void        hal_advance(uint64_t us);
+void        hal_sleep(void);
+void        hal_at(uint64_t at_us, HalHandler handler);
+bool        hal_in_isr(void);
+uint64_t    hal_accesses(void);
+uint64_t    hal_interrupts(void);
+uint64_t    hal_sleep_us(void);
+
+// Interrupt mask
+void        hal_irq_disable(void);
+void        hal_irq_enable(void);
+uint32_t    hal_irq_state(void);
+void        hal_irq_restore(uint32_t state);
+
+// Real time clock
+uint32_t    hal_rtc(void);
+void        hal_set_rtc(uint32_t seconds);
+
+// Pins
+const char* hal_pin_name(PinName pin);
+PinName     hal_pin_by_name(const char* name);
+void        hal_attach(PinName pin, HalPinModel* model);
+void        hal_mode(PinName pin, PinMode mode);
+void        hal_drive(PinName pin, int level, bool traced);
+void        hal_release(PinName pin);
+int         hal_read(PinName pin);
+void        hal_input(PinName pin, int level);
+void        hal_edges(PinName pin, HalHandler rise, HalHandler fall);
+void        hal_analog(PinName pin, float value);
+float       hal_analog_read(PinName pin);
+void        hal_pwm(PinName pin, uint32_t period_us, uint32_t pulse_us);
+
+// Serial ports, identified by their TX pin, bytes are injected on their RX pin
+void        hal_uart_open(PinName tx, PinName rx, int baud);
+void        hal_uart_baud(PinName tx, int baud);
+void        hal_uart_putc(PinName tx, uint8_t b);
+bool        hal_uart_writeable(PinName tx);
+bool        hal_uart_readable(PinName tx);
+int         hal_uart_getc(PinName tx);
+void        hal_uart_irq(PinName tx, HalHandler rx);
+void        hal_rx(PinName rx, const uint8_t* data, size_t len);
+void        hal_capture(PinName tx, FILE* out);
+void        hal_tap(PinName tx, HalByteHandler tap);
+#endif /* HOST_HAL_H_ */
@@ -0,0 +1,27 @@
+#ifndef PIN_NAMES_H_
+#define PIN_NAMES_H_
+
+/*
+Pin names of the mbed LPC1768 for the host stand-in of mbed.h. The values
+are only used as indices of the simulated pins, they are not the LPC1768
+port/pin encoding.
+*/
+typedef enum {
+    p5 = 0, p6, p7, p8, p9, p10, p11, p12, p13, p14, p15, p16, p17, p18,
+    p19, p20, p21, p22, p23, p24, p25, p26, p27, p28, p29, p30,
+    LED1, LED2, LED3, LED4,
+    USBTX, USBRX,
+
+    PIN_COUNT,
+
+    NC = -1
+} PinName;
+
+typedef enum {
+    PullNone    = 0,
+    PullUp      = 1,
+    PullDown    = 2,
+    OpenDrain   = 3,
+    PullDefault = PullDown
+} PinMode;
+#endif /* PIN_NAMES_H_ */
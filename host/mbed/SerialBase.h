@@ -0,0 +1,6 @@
+#ifndef SERIAL_BASE_H_
+#define SERIAL_BASE_H_
+
+// SerialBase is part of the host stand-in of mbed.h
+#include "mbed.h"
+#endif /* SERIAL_BASE_H_ */
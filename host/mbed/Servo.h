@@ -0,0 +1,57 @@
+#ifndef MBED_SERVO_H
+#define MBED_SERVO_H
+
+/*
+Host build of the mbed Servo library (Simon Ford), same interface and pulse
+widths: 1.5 ms centre, +/- 'range' at the ends, 20 ms PwmOut period.
+*/
+
+#include "mbed.h"
+
+class Servo
+{
+    PwmOut  _pwm;
+    float   _range;
+    float   _degrees;
+    float   _p;
+
+    static float clamp(float value, float min, float max)
+    {
+        return value < min ? min : (value > max ? max : value);
+    }
+
+public:
+    Servo(PinName pin) : _pwm(pin), _p(0)
+    {
+        calibrate();
+        write(0.5);
+    }
+
+    void write(float percent)
+    {
+        float   offset = _range * 2.0f * (percent - 0.5f);
+
+        _pwm.pulsewidth(0.0015f + clamp(offset, -_range, _range));
+        _p = clamp(percent, 0.0f, 1.0f);
+    }
+
+    float read() { return _p; }
+
+    void position(float degrees)
+    {
+        float   offset = _range * (degrees / _degrees);
+
+        _pwm.pulsewidth(0.0015f + clamp(offset, -_range, _range));
+    }
+
+    void calibrate(float range = 0.0005f, float degrees = 45.0f)
+    {
+        _range = range;
+        _degrees = degrees;
+    }
+
+    Servo& operator=(float percent) { write(percent); return *this; }
+    Servo& operator=(Servo& rhs) { write(rhs.read()); return *this; }
+    operator float() { return read(); }
+};
+#endif /* MBED_SERVO_H */
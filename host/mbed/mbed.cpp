@@ -0,0 +1,190 @@
+#include "mbed.h"
+
+/*
+InterruptIn
+*/
+void InterruptIn::update(void)
+{
+    HalHandler  rise;
+    HalHandler  fall;
+
+    if (_enabled && _rise)
+        rise = [this]() { _rise.call(); };
+    if (_enabled && _fall)
+        fall = [this]() { _fall.call(); };
+    hal_edges(_pin, rise, fall);
+}
+
+/*
+PwmOut
+*/
+void PwmOut::period_us(int us)
+{
+    uint32_t    period = us > 0 ? us : 1;
+
+    // the LPC1768 driver scales the pulse width to keep the duty cycle
+    _pulse_us = (uint32_t)(((uint64_t)_pulse_us * period) / _period_us);
+    _period_us = period;
+    apply();
+}
+
+/*
+Ticker and Timeout, the period counts from the previous tick, not from when the handler ran
+*/
+void Ticker::attach_us(Callback<void()> func, uint64_t t)
+{
+    hal_access();
+    _function = func;
+    _delay_us = t > 0 ? t : 1;
+    _event.schedule(hal_now_us() + _delay_us, [this]() { handler(); });
+}
+
+void Ticker::handler(void)
+{
+    _event.schedule(_event.at() + _delay_us, [this]() { handler(); });
+    _function.call();
+}
+
+void Timeout::handler(void)
+{
+    _function.call();
+}
+
+/*
+Waiting, busy on the target
+*/
+void wait(float s)
+{
+    wait_us((int)(s * 1000000.0f));
+}
+
+void wait_ms(int ms)
+{
+    wait_us(ms * 1000);
+}
+
+void wait_us(int us)
+{
+    hal_access();
+    if (us > 0)
+        hal_advance(us);
+}
+
+void sleep(void)
+{
+    hal_sleep();
+}
+
+void deepsleep(void)
+{
+    hal_sleep();
+}
+
+time_t hal_time(time_t* t)
+{
+    time_t  now = hal_rtc();
+
+    if (t != NULL)
+        *t = now;
+    return now;
+}
+
+void set_time(time_t t)
+{
+    hal_set_rtc((uint32_t)t);
+}
+
+/*
+Critical sections nest, the interrupt mask is restored by the outermost exit
+*/
+static uint32_t critical_depth = 0;
+static uint32_t critical_primask = 0;
+
+void core_util_critical_section_enter(void)
+{
+    uint32_t    primask = __get_PRIMASK();
+
+    __disable_irq();
+    if (critical_depth++ == 0)
+        critical_primask = primask;
+}
+
+void core_util_critical_section_exit(void)
+{
+    if (critical_depth > 0 && --critical_depth == 0)
+        __set_PRIMASK(critical_primask);
+}
+
+/*
+Cycle counter
+*/
+HalDwt          hal_dwt;
+HalCoreDebug    hal_core_debug;
+
+/*
+Watchdog and reset
+*/
+HalWdt  hal_wdt;
+HalSc   hal_sc = { 1 };     // power on reset
+
+void NVIC_SystemReset(void)
+{
+    fflush(stdout);
+    fprintf(stderr, "system reset at %llu us\n", (unsigned long long)hal_now_us());
+    exit(2);
+}
+
+/*
+Serial ports
+*/
+void SerialBase::attach(Callback<void()> func, IrqType type /*= RxIrq*/)
+{
+    if (type != RxIrq)
+        return;     // the firmware does not use TX interrupts
+    if (func)
+        hal_uart_irq(_tx, [func]() { func.call(); });
+    else
+        hal_uart_irq(_tx, HalHandler());
+}
+
+/*
+SPI
+*/
+int SPI::write(int value)
+{
+    uint32_t    state = hal_irq_state();
+    int         r = 0;
+
+    hal_access();
+    hal_irq_disable();
+    for (int i = _bits - 1; i >= 0; i--) {
+        hal_drive(_mosi, (value >> i) & 1, true);
+        hal_advance(_bit_us / 2);
+        r = (r << 1) | hal_read(_mosi);
+        hal_advance(_bit_us - _bit_us / 2);
+    }
+    hal_irq_restore(state);
+    return r;
+}
+
+int RawSerial::puts(const char* str)
+{
+    while (*str)
+        putc(*str++);
+    return 0;
+}
+
+int RawSerial::printf(const char* format, ...)
+{
+    char    buf[256];
+    va_list args;
+
+    va_start(args, format);
+
+    int     len = vsnprintf(buf, sizeof(buf), format, args);
+
+    va_end(args);
+    for (int i = 0; i < len && i < (int)sizeof(buf) - 1; i++)
+        putc(buf[i]);
+    return len;
+}
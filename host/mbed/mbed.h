@@ -0,0 +1,410 @@
+#ifndef MBED_H
+#define MBED_H
+
+/*
+Host stand-in for the mbed 2 API used by the smart home, so main.cpp and the
+libraries build and run on Linux (see host/house_sim). The classes keep the
+mbed signatures and behaviour the firmware relies on, the hardware behind
+them is simulated by HostHal.h on a virtual clock.
+
+Differences to the LPC1768 worth knowing when reading results:
+ - every PwmOut has its own period, on the LPC1768 they share PWM1's period
+ - deepsleep() is sleep(), the us ticker keeps running
+ - Timer::read_us() wraps like on the target, read_ms() is read_us() / 1000
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <functional>
+#include "PinNames.h"
+#include "HostHal.h"
+
+#define MBED_MAJOR_VERSION  2
+#define MBED_ASSERT(expr)   do { if (!(expr)) { fprintf(stderr, "mbed assertation failed: %s, file: %s, line %d\n", #expr, __FILE__, __LINE__); abort(); } } while (0)
+
+template <typename F> class Callback;
+
+/**
+ * Callback with no arguments, a free function or an object and its method.
+ */
+template <typename R>
+class Callback<R()>
+{
+    std::function<R()>  _func;
+
+public:
+    Callback(R (*func)() = 0)
+    {
+        if (func)
+            _func = func;
+    }
+
+    template <typename T>
+    Callback(T* obj, R (T::*method)()) :
+        _func([obj, method]() { return (obj->*method)(); })
+    { }
+
+    R call() const { return _func(); }
+    R operator()() const { return _func(); }
+    operator bool() const { return (bool)_func; }
+};
+
+template <typename T, typename R>
+Callback<R()> callback(T* obj, R (T::*method)())
+{
+    return Callback<R()>(obj, method);
+}
+
+template <typename R>
+Callback<R()> callback(R (*func)())
+{
+    return Callback<R()>(func);
+}
+
+template <typename T>
+class NonCopyable
+{
+protected:
+    NonCopyable() { }
+    ~NonCopyable() { }
+
+private:
+    NonCopyable(const NonCopyable&);
+    NonCopyable& operator=(const NonCopyable&);
+};
+
+/*
+Digital I/O
+*/
+class DigitalOut
+{
+    PinName _pin;
+    int     _value;
+
+public:
+    DigitalOut(PinName pin, int value = 0) : _pin(pin), _value(value) { hal_drive(_pin, _value, true); }
+
+    void    write(int value) { hal_access(); _value = value ? 1 : 0; hal_drive(_pin, _value, true); }
+    int     read() { hal_access(); return _value; }
+    int     is_connected() { return _pin != NC; }
+
+    DigitalOut& operator=(int value) { write(value); return *this; }
+    DigitalOut& operator=(DigitalOut& rhs) { write(rhs.read()); return *this; }
+    operator int() { return read(); }
+};
+
+class DigitalIn
+{
+    PinName _pin;
+
+public:
+    DigitalIn(PinName pin) : _pin(pin) { }
+    DigitalIn(PinName pin, PinMode pull) : _pin(pin) { hal_mode(_pin, pull); }
+
+    int     read() { hal_access(); return hal_read(_pin); }
+    void    mode(PinMode pull) { hal_mode(_pin, pull); }
+    int     is_connected() { return _pin != NC; }
+
+    operator int() { return read(); }
+};
+
+class DigitalInOut
+{
+    PinName _pin;
+    int     _value;
+    bool    _output;
+
+public:
+    DigitalInOut(PinName pin) : _pin(pin), _value(0), _output(false) { }
+
+    void    write(int value) { hal_access(); _value = value ? 1 : 0; if (_output) hal_drive(_pin, _value, false); }
+    int     read() { hal_access(); return hal_read(_pin); }
+    void    output() { hal_access(); _output = true; hal_drive(_pin, _value, false); }
+    void    input() { hal_access(); _output = false; hal_release(_pin); }
+    void    mode(PinMode pull) { hal_mode(_pin, pull); }
+    int     is_connected() { return _pin != NC; }
+
+    DigitalInOut& operator=(int value) { write(value); return *this; }
+    operator int() { return read(); }
+};
+
+class InterruptIn
+{
+    PinName             _pin;
+    Callback<void()>    _rise;
+    Callback<void()>    _fall;
+    bool                _enabled;
+
+    void    update(void);
+
+public:
+    InterruptIn(PinName pin) : _pin(pin), _enabled(true) { }
+
+    int     read() { hal_access(); return hal_read(_pin); }
+    void    rise(Callback<void()> func) { _rise = func; update(); }
+    void    fall(Callback<void()> func) { _fall = func; update(); }
+    void    mode(PinMode pull) { hal_mode(_pin, pull); }
+    void    enable_irq() { _enabled = true; update(); }
+    void    disable_irq() { _enabled = false; update(); }
+
+    operator int() { return read(); }
+};
+
+/*
+Analog and PWM
+*/
+class AnalogIn
+{
+    PinName _pin;
+
+    // 12-bit conversion of the simulated voltage
+    uint16_t    convert(void) { hal_access(); return (uint16_t)(hal_analog_read(_pin) * 4095 + 0.5f); }
+
+public:
+    AnalogIn(PinName pin) : _pin(pin) { }
+
+    float           read() { return convert() / 4095.0f; }
+    unsigned short  read_u16() { uint16_t v = convert(); return (v << 4) | (v >> 8); }
+
+    operator float() { return read(); }
+};
+
+class PwmOut
+{
+    PinName     _pin;
+    uint32_t    _period_us;
+    uint32_t    _pulse_us;
+
+    void    apply(void) { hal_access(); hal_pwm(_pin, _period_us, _pulse_us); }
+
+public:
+    PwmOut(PinName pin) : _pin(pin), _period_us(20000), _pulse_us(0) { hal_pwm(_pin, _period_us, _pulse_us); }
+
+    void    period(float seconds) { period_us((int)(seconds * 1000000.0f + 0.5f)); }
+    void    period_ms(int ms) { period_us(ms * 1000); }
+    void    period_us(int us);
+    void    pulsewidth(float seconds) { pulsewidth_us((int)(seconds * 1000000.0f + 0.5f)); }
+    void    pulsewidth_ms(int ms) { pulsewidth_us(ms * 1000); }
+    void    pulsewidth_us(int us) { _pulse_us = us < 0 ? 0 : ((uint32_t)us > _period_us ? _period_us : us); apply(); }
+    void    write(float duty) { duty = duty < 0 ? 0 : (duty > 1 ? 1 : duty); pulsewidth_us((int)(duty * _period_us)); }
+    float   read() { return _period_us ? (float)_pulse_us / _period_us : 0; }
+
+    PwmOut& operator=(float duty) { write(duty); return *this; }
+    PwmOut& operator=(PwmOut& rhs) { write(rhs.read()); return *this; }
+    operator float() { return read(); }
+};
+
+/*
+Time
+*/
+class Timer
+{
+    bool        _running;
+    uint64_t    _start_us;
+    uint64_t    _elapsed_us;
+
+    uint64_t    elapsed(void) { hal_access(); return _elapsed_us + (_running ? hal_now_us() - _start_us : 0); }
+
+public:
+    Timer() : _running(false), _start_us(0), _elapsed_us(0) { }
+
+    void    start() { if (!_running) { _start_us = hal_now_us(); _running = true; } }
+    void    stop() { _elapsed_us = elapsed(); _running = false; }
+    void    reset() { _start_us = hal_now_us(); _elapsed_us = 0; }
+    int     read_us() { return (int)(uint32_t)elapsed(); }
+    int     read_ms() { return read_us() / 1000; }
+    float   read() { return read_us() / 1000000.0f; }
+
+    operator float() { return read(); }
+};
+
+class Ticker
+{
+protected:
+    HalEvent            _event;
+    Callback<void()>    _function;
+    uint64_t            _delay_us;
+
+    virtual void    handler(void);
+
+public:
+    Ticker() : _delay_us(0) { }
+    virtual ~Ticker() { }
+
+    void    attach(Callback<void()> func, float t) { attach_us(func, (uint64_t)(t * 1000000.0f)); }
+    void    attach_us(Callback<void()> func, uint64_t t);
+    void    detach() { _event.cancel(); _function = Callback<void()>(); }
+};
+
+class Timeout : public Ticker
+{
+protected:
+    virtual void    handler(void);
+};
+
+// Microsecond ticker of the HAL under Timer, wraps like on the target
+inline uint32_t us_ticker_read(void) { return (uint32_t)hal_now_us(); }
+
+void    wait(float s);
+void    wait_ms(int ms);
+void    wait_us(int us);
+
+void    sleep(void);
+void    deepsleep(void);
+
+// RTC, time() is redirected to the simulated clock
+time_t  hal_time(time_t* t);
+void    set_time(time_t t);
+#define time(t) hal_time(t)
+
+/*
+Interrupts
+*/
+inline void     __disable_irq(void) { hal_irq_disable(); }
+inline void     __enable_irq(void) { hal_irq_enable(); }
+inline uint32_t __get_PRIMASK(void) { return hal_irq_state(); }
+inline void     __set_PRIMASK(uint32_t primask) { hal_irq_restore(primask); }
+inline void     __DMB(void) { }
+inline void     __DSB(void) { }
+inline void     __NOP(void) { }
+
+void    core_util_critical_section_enter(void);
+void    core_util_critical_section_exit(void);
+
+/*
+Cycle counter of the Cortex-M3 (DWT), counts SystemCoreClock cycles of the
+simulated clock
+*/
+const uint32_t  SystemCoreClock = 96000000;
+
+#define CoreDebug_DEMCR_TRCENA_Msk      (1UL << 24)
+#define DWT_CTRL_CYCCNTENA_Msk          (1UL << 0)
+
+class HalCycleCounter
+{
+    uint32_t    _base;
+
+public:
+    HalCycleCounter() : _base(0) { }
+
+    operator uint32_t() const { return (uint32_t)(hal_now_ns() * (SystemCoreClock / 1000000) / 1000) - _base; }
+    HalCycleCounter& operator=(uint32_t cycles)
+    {
+        _base = (uint32_t)(hal_now_ns() * (SystemCoreClock / 1000000) / 1000) - cycles;
+        return *this;
+    }
+};
+
+struct HalDwt
+{
+    uint32_t        CTRL;
+    HalCycleCounter CYCCNT;
+};
+
+struct HalCoreDebug
+{
+    uint32_t        DEMCR;
+};
+
+extern HalDwt       hal_dwt;
+extern HalCoreDebug hal_core_debug;
+
+#define DWT         (&hal_dwt)
+#define CoreDebug   (&hal_core_debug)
+
+/*
+Watchdog and reset source of the LPC1768. The watchdog is not simulated,
+the board always starts as from power on and NVIC_SystemReset() ends the run.
+*/
+struct HalWdt
+{
+    uint32_t    WDMOD;
+    uint32_t    WDTC;
+    uint32_t    WDFEED;
+    uint32_t    WDTV;
+    uint32_t    WDCLKSEL;
+};
+
+struct HalSc
+{
+    uint32_t    RSID;
+};
+
+extern HalWdt   hal_wdt;
+extern HalSc    hal_sc;
+
+#define LPC_WDT     (&hal_wdt)
+#define LPC_SC      (&hal_sc)
+
+void    NVIC_SystemReset(void);
+
+/*
+Serial ports
+*/
+class SerialBase
+{
+protected:
+    PinName _tx;
+
+    SerialBase(PinName tx, PinName rx, int baud) : _tx(tx) { hal_uart_open(tx, rx, baud); }
+
+    int     _base_getc() { return hal_uart_getc(_tx); }
+    int     _base_putc(int c) { hal_uart_putc(_tx, (uint8_t)c); return c; }
+
+public:
+    enum IrqType {
+        RxIrq = 0,
+        TxIrq
+    };
+
+    void    baud(int baudrate) { hal_uart_baud(_tx, baudrate); }
+    int     readable() { return hal_uart_readable(_tx); }
+    int     writeable() { return hal_uart_writeable(_tx); }
+    void    attach(Callback<void()> func, IrqType type = RxIrq);
+};
+
+class RawSerial : public SerialBase
+{
+public:
+    RawSerial(PinName tx, PinName rx, int baud = 9600) : SerialBase(tx, rx, baud) { }
+
+    int     getc() { return _base_getc(); }
+    int     putc(int c) { return _base_putc(c); }
+    int     puts(const char* str);
+    int     printf(const char* format, ...);
+};
+
+class Serial : public RawSerial
+{
+public:
+    Serial(PinName tx, PinName rx, int baud = 9600) : RawSerial(tx, rx, baud) { }
+};
+
+/*
+SPI master. A frame is shifted out MSB first by the peripheral, the
+interrupts that come in on the way run after it like the CPU waiting on
+the SSP would see them. MISO is sampled in the middle of each bit on the
+MOSI line: the only SPI user is the 1-Wire master, whose MOSI and MISO are
+both on the bus, so the models are attached to MOSI.
+*/
+class SPI
+{
+    PinName     _mosi;
+    int         _bits;
+    uint32_t    _bit_us;
+
+public:
+    SPI(PinName mosi, PinName miso, PinName sclk) : _mosi(mosi), _bits(8), _bit_us(1) { hal_drive(_mosi, 1, true); }
+
+    void    format(int bits, int mode = 0) { _bits = bits; }
+    void    frequency(int hz = 1000000) { _bit_us = hz < 1000000 ? 1000000 / hz : 1; }
+    int     write(int value);
+};
+
+using namespace std;
+#endif /* MBED_H */
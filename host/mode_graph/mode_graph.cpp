@@ -0,0 +1,16 @@
+/*
+Prints the house mode transition graph (HouseMode/house_modes.dot).
+
+Build:
+    g++ -O2 -I../../HouseMode -I../../Trace -o mode_graph mode_graph.cpp ../../HouseMode/HouseMode.cpp
+
+Use:
+    ./mode_graph > ../../HouseMode/house_modes.dot
+*/
+#include "HouseMode.h"
+
+int main()
+{
+    ModeMachine::writeDot(stdout);
+    return 0;
+}
@@ -0,0 +1,177 @@
+/*
+Evaluates the OccupancyModel on synthetic weekly occupancy.
+
+A household is simulated minute by minute for a number of weeks: weekdays
+out from ~8:00 to ~17:30 (with jitter, and some days working from home),
+weekends home with a random outing, asleep (no motion) at night, and a week
+of holidays. While someone is home and awake the PIR fires a few times per
+ten minutes.
+
+After two weeks of learning, each hour compares:
+    prediction  the hour's score against the actual occupancy
+    always      comfort setpoints all the time
+    reactive    comfort while there was motion in the last 30 minutes
+    predictive  comfort when OccupancyModel::expected() with a one hour lead
+and counts how many arrivals found the house already conditioned for an
+hour, and for how many hours each strategy kept the heater/aircon at the
+comfort setpoints.
+
+The cold start is checked as well: a model that has learned nothing must
+not expect the house empty, or a new board would keep it at setback. The
+first week, while the model learns, is reported on its own line. The run
+fails (exit code 1) if a fresh model expects the house empty.
+
+Build:
+    g++ -O2 -I../../Occupancy -o occupancy_eval occupancy_eval.cpp ../../Occupancy/OccupancyModel.cpp
+
+Use:
+    ./occupancy_eval [weeks]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "OccupancyModel.h"
+
+#define LEAD_S          3600
+#define REACTIVE_S      1800
+#define TRAIN_WEEKS     2
+#define START_S         1700438400u     // a Monday 00:00 UTC
+#define HOLIDAY_WEEK    5
+
+static int jitter(int minutes)
+{
+    return rand() % (2 * minutes + 1) - minutes;
+}
+
+// fills one week of occupancy, one entry per minute: 0 out, 1 home awake, 2 home asleep
+static void week(unsigned char* home, bool holiday)
+{
+    for (int day = 0; day < 7; day++) {
+        unsigned char*  d = home + day * 1440;
+        int             wake = 6 * 60 + 30 + jitter(30);
+        int             sleep = 23 * 60 + jitter(30);
+
+        for (int m = 0; m < 1440; m++)
+            d[m] = (m < wake || m >= sleep) ? 2 : 1;
+
+        if (holiday) {
+            for (int m = 0; m < 1440; m++)
+                d[m] = 0;
+            continue;
+        }
+
+        if (day < 5 && rand() % 10) {
+            int leave = 8 * 60 + jitter(20);
+            int back = 17 * 60 + 30 + jitter(45);
+
+            for (int m = leave; m < back; m++)
+                d[m] = 0;
+        }
+        else if (day >= 5) {
+            int out = 11 * 60 + rand() % (6 * 60);
+
+            for (int m = out; m < out + 180 && m < 1440; m++)
+                d[m] = 0;
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    int             weeks = argc > 1 ? atoi(argv[1]) : 12;
+    OccupancyModel  model(1);
+    unsigned char   home[7 * 1440];
+    uint32_t        lastMotion = 0;
+    long            hours = 0, correct = 0, truePos = 0, falsePos = 0, falseNeg = 0;
+    long            comfortAlways = 0, comfortReactive = 0, comfortPredictive = 0;
+    long            arrivals = 0, readyReactive = 0, readyPredictive = 0;
+    long            comfortCold = 0, arrivalsCold = 0, readyCold = 0;
+    bool            predictiveHistory[61] = { false };
+    bool            reactiveHistory[61] = { false };
+
+    if (weeks <= TRAIN_WEEKS)
+        weeks = TRAIN_WEEKS + 1;
+    srand(1);
+
+    // nothing learned yet, every hour of the week counts as occupied
+    bool            coldEmpty = false;
+
+    for (uint32_t t = START_S; t < START_S + OCCUPANCY_SLOTS * 3600; t += 3600)
+        coldEmpty |= model.expectedEmpty(t, LEAD_S);
+
+    for (int w = 0; w < weeks; w++) {
+        week(home, w == HOLIDAY_WEEK);
+
+        for (int m = 0; m < 7 * 1440; m++) {
+            uint32_t    now = START_S + (uint32_t)(w * 7 * 1440 + m) * 60;
+            bool        evaluate = w >= TRAIN_WEEKS;
+
+            // hourly prediction check, before the hour is learned
+            if (m % 60 == 0 && evaluate) {
+                bool    occupied = false;
+
+                for (int k = m; k < m + 60; k++)
+                    occupied |= (home[k] == 1);
+
+                bool    predicted = model.score(0, now) >= OCCUPANCY_THRESHOLD;
+
+                hours++;
+                correct += (predicted == occupied);
+                truePos += (predicted && occupied);
+                falsePos += (predicted && !occupied);
+                falseNeg += (!predicted && occupied);
+            }
+
+            if (home[m] == 1 && rand() % 4 == 0) {
+                model.motion(0, now);
+                lastMotion = now;
+            }
+            model.tick(now);
+
+            bool    reactive = lastMotion && (now - lastMotion) < REACTIVE_S;
+            bool    predictive = reactive || model.expected(0, now, LEAD_S);
+
+            for (int k = 60; k > 0; k--) {
+                predictiveHistory[k] = predictiveHistory[k - 1];
+                reactiveHistory[k] = reactiveHistory[k - 1];
+            }
+            predictiveHistory[0] = predictive;
+            reactiveHistory[0] = reactive;
+
+            bool    arrived = (home[m] == 1) && (m > 0 ? home[m - 1] == 0 : false);
+
+            if (w == 0) {
+                comfortCold += predictive;
+                arrivalsCold += arrived;
+                readyCold += arrived && predictiveHistory[60];
+            }
+            if (!evaluate)
+                continue;
+
+            comfortAlways++;
+            comfortReactive += reactive;
+            comfortPredictive += predictive;
+
+            if (arrived) {
+                arrivals++;
+                readyReactive += reactiveHistory[60];
+                readyPredictive += predictiveHistory[60];
+            }
+        }
+    }
+
+    printf("%d weeks, %d for learning, RAM %u bytes\n\n", weeks, TRAIN_WEEKS, (unsigned)sizeof(model));
+    printf("hourly prediction: accuracy %.1f %%, precision %.1f %%, recall %.1f %%\n\n",
+           100.0 * correct / hours, 100.0 * truePos / (truePos + falsePos),
+           100.0 * truePos / (truePos + falseNeg));
+    printf("%-11s %14s %18s\n", "strategy", "comfort [h/wk]", "arrivals ready [%]");
+    printf("%-11s %14.1f %18.1f\n", "always", comfortAlways / 60.0 / (weeks - TRAIN_WEEKS), 100.0);
+    printf("%-11s %14.1f %18.1f\n", "reactive", comfortReactive / 60.0 / (weeks - TRAIN_WEEKS),
+           100.0 * readyReactive / arrivals);
+    printf("%-11s %14.1f %18.1f\n", "predictive", comfortPredictive / 60.0 / (weeks - TRAIN_WEEKS),
+           100.0 * readyPredictive / arrivals);
+    printf("%-11s %14.1f %18.1f\n", "first week", comfortCold / 60.0, 100.0 * readyCold / arrivalsCold);
+    printf("\ncold start: %s\n", coldEmpty ? "FAIL, a fresh model expects the house empty" :
+                                              "a fresh model expects the house occupied");
+
+    return coldEmpty;
+}
@@ -0,0 +1,252 @@
+/*
+Compares the three bus masters of OneWire (GPIO, UART and SPI) on the
+host stand-in of mbed.h, each talking to the DS18B20 model of host/mbed.
+
+For each backend the DS18B20 is found with search(), then the scratchpad
+is read -n times (reset, MATCH ROM, READ SCRATCHPAD, 9 bytes) while the
+bytes are timed on their own. "block" is the GPIO backend again with the
+10 bytes written and the 9 read by transfer(), as DS1820::read() does:
+    us/byte     simulated time of write_byte() and read_byte()
+    cycles      the same at SystemCoreClock (96 MHz): the CPU is held for
+                the whole byte by all three, in the GPIO waits, in getc()
+                and in SPI::write() (mbed 2 has no DMA SPI on the LPC1768)
+    HAL/byte    HAL calls per byte, the work the CPU does besides waiting
+    errors      scratchpads with a bad CRC, reads that failed
+-l adds an interrupt taking that many us every ms, e.g. a busy serial port.
+An interrupt in the middle of a GPIO slot stretches it, the SPI and UART
+slots are timed by the peripheral so it only delays the next one. The
+UART wire runs on host events the interrupt delays as well, so its errors
+are not shown under load.
+
+The UART backend needs the 470 Ohm wiring, modelled by UartWire: every
+byte sent is run as a slot on the DS18B20 and what the bus did during it
+comes back as the received byte.
+
+Build:
+    g++ -O2 -std=c++11 -I../mbed -I../../DS1820/OneWire -I../../Trace \
+        -o onewire_bench onewire_bench.cpp ../mbed/mbed.cpp ../mbed/HostHal.cpp ../mbed/HostDevices.cpp \
+        ../../DS1820/OneWire/OneWire.cpp
+
+Use:
+    ./onewire_bench [-n <reads>] [-l <us>] [-c <ns>]
+    -n  scratchpad reads per backend (default 100)
+    -l  interrupt load, us every ms (default 0)
+    -c  simulated time taken by one HAL call (default 1000)
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "HostDevices.h"
+#include "OneWire.h"
+
+#define BENCH_CORE_HZ   96000000
+
+#define GPIO_PIN        p8
+#define UART_TX         p9
+#define UART_RX         p10
+#define UART_BUS        p21         // the bus behind the UART, no pin of the board
+#define SPI_MOSI        p5
+#define SPI_MISO        p6
+#define SPI_SCLK        p7
+
+/**
+ * 1-Wire bus on a UART through a 470 Ohm resistor from TX, RX on the bus.
+ * A byte sent drives the bus with its start and data bits, the byte
+ * received has the bits as the bus was in their middle. The reset byte
+ * (0xF0) goes at 9600 baud, the slots at 115200.
+ */
+class UartWire
+{
+    PinName _bus;
+    PinName _rx;
+
+public:
+    UartWire(PinName tx, PinName rx, PinName bus) : _bus(bus), _rx(rx)
+    {
+        hal_drive(_bus, 1, false);
+        hal_tap(tx, [this](uint8_t b) { slot(b); });
+    }
+
+    // runs the byte from now on, the host taps it once it is sent
+    void slot(uint8_t b)
+    {
+        uint64_t    start = hal_now_us();
+        uint32_t    bit_us = b == 0xF0 ? 104 : 9;
+        uint8_t*    echo = new uint8_t(0);
+        PinName     bus = _bus;
+        PinName     rx = _rx;
+
+        for (int i = 0; i < 10; i++) {
+            int level = i == 0 ? 0 : i == 9 ? 1 : (b >> (i - 1)) & 1;
+
+            hal_at(start + i * bit_us, [bus, level]() { hal_drive(bus, level, false); });
+            if (i >= 1 && i <= 8)
+                hal_at(start + i * bit_us + bit_us / 2, [bus, echo, i]() { *echo |= hal_read(bus) << (i - 1); });
+        }
+        hal_at(start + 10 * bit_us, [rx, echo]() {
+            hal_rx(rx, echo, 1);
+            delete echo;
+        });
+    }
+};
+
+struct BenchResult
+{
+    uint64_t    write_ns;
+    uint64_t    read_ns;
+    uint64_t    write_hal;
+    uint64_t    read_hal;
+    uint32_t    written;
+    uint32_t    read;
+    uint32_t    crc_errors;
+    uint32_t    failures;
+};
+
+static uint32_t bench_load_us;
+
+static void bench_isr(void)
+{
+    wait_us(bench_load_us);
+}
+
+/**
+ * @brief   Finds the DS18B20, reads its scratchpad 'reads' times and times the bytes.
+ * @note
+ * @param   ow:     the bus master
+ * @param   reads:  scratchpad reads
+ * @param   block:  the bytes go by transfer(), timed as a whole
+ * @retval
+ */
+static BenchResult bench_backend(OneWire& ow, int reads, bool block = false)
+{
+    BenchResult r;
+    uint8_t     rom[8];
+
+    memset(&r, 0, sizeof(r));
+    ow.reset_search();
+    if (!ow.search(rom)) {
+        r.failures = reads;
+        return r;
+    }
+
+    for (int n = 0; n < reads; n++) {
+        uint8_t     command[10] = { 0x55 };
+        uint8_t     scratchpad[9];
+
+        memcpy(command + 1, rom, 8);
+        command[9] = 0xBE;
+        if (!ow.reset()) {
+            r.failures++;
+            continue;
+        }
+        if (block) {
+            uint64_t    ns = hal_now_ns();
+            uint64_t    calls = hal_accesses();
+
+            ow.transfer(command, NULL, 10);
+            r.write_ns += hal_now_ns() - ns;
+            r.write_hal += hal_accesses() - calls;
+            r.written += 10;
+            ns = hal_now_ns();
+            calls = hal_accesses();
+            ow.transfer(NULL, scratchpad, 9);
+            r.read_ns += hal_now_ns() - ns;
+            r.read_hal += hal_accesses() - calls;
+            r.read += 9;
+        }
+        for (int i = 0; i < 10 && !block; i++) {
+            uint64_t    ns = hal_now_ns();
+            uint64_t    calls = hal_accesses();
+
+            ow.write_byte(command[i]);
+            r.write_ns += hal_now_ns() - ns;
+            r.write_hal += hal_accesses() - calls;
+            r.written++;
+        }
+        for (int i = 0; i < 9 && !block; i++) {
+            uint64_t    ns = hal_now_ns();
+            uint64_t    calls = hal_accesses();
+
+            scratchpad[i] = ow.read_byte();
+            r.read_ns += hal_now_ns() - ns;
+            r.read_hal += hal_accesses() - calls;
+            r.read++;
+        }
+        if (OneWire::crc8(scratchpad, 8) != scratchpad[8])
+            r.crc_errors++;
+    }
+    return r;
+}
+
+static void bench_report(const char* name, const BenchResult& r, bool errors)
+{
+    if (r.written == 0) {
+        printf("%-5s the DS18B20 was not found\n", name);
+        return;
+    }
+
+    double  write_us = r.written ? r.write_ns / 1e3 / r.written : 0;
+    double  read_us = r.read ? r.read_ns / 1e3 / r.read : 0;
+
+    printf("%-5s %13.1f %13.1f %10.0f %10.0f %9.1f %9.1f", name, write_us, read_us,
+           write_us * BENCH_CORE_HZ / 1e6, read_us * BENCH_CORE_HZ / 1e6,
+           r.written ? (double)r.write_hal / r.written : 0, r.read ? (double)r.read_hal / r.read : 0);
+    if (errors)
+        printf(" %6u %6u\n", (unsigned)r.crc_errors, (unsigned)r.failures);
+    else
+        printf(" %6s %6s\n", "-", "-");
+}
+
+int main(int argc, char** argv)
+{
+    int         reads = 100;
+    uint32_t    cost_ns = 1000;
+    Ticker      load;
+
+    for (int i = 1; i < argc - 1; i += 2) {
+        if (strcmp(argv[i], "-n") == 0)
+            reads = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-l") == 0)
+            bench_load_us = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-c") == 0)
+            cost_ns = atoi(argv[i + 1]);
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    hal_setup(cost_ns, 0, NULL);
+    if (bench_load_us > 0)
+        load.attach_us(bench_isr, 1000);
+
+    printf("%d scratchpad reads, interrupt load %u us/ms\n", reads, (unsigned)bench_load_us);
+    printf("%-5s %13s %13s %10s %10s %9s %9s %6s %6s\n", "", "write us/byte", "read us/byte", "w cycles",
+           "r cycles", "w HAL", "r HAL", "crc", "failed");
+
+    {
+        Ds18b20Model    sensor(GPIO_PIN, 1);
+        OneWire         ow(GPIO_PIN);
+
+        bench_report("gpio", bench_backend(ow, reads), true);
+        bench_report("block", bench_backend(ow, reads, true), true);
+        hal_attach(GPIO_PIN, NULL);
+    }
+    {
+        Ds18b20Model    sensor(UART_BUS, 2);
+        UartWire        wire(UART_TX, UART_RX, UART_BUS);
+        OneWire         ow(UART_TX, UART_RX);
+
+        bench_report("uart", bench_backend(ow, reads), bench_load_us == 0);
+        hal_tap(UART_TX, HalByteHandler());
+        hal_attach(UART_BUS, NULL);
+    }
+    {
+        Ds18b20Model    sensor(SPI_MOSI, 3);
+        OneWire         ow(SPI_MOSI, SPI_MISO, SPI_SCLK);
+
+        bench_report("spi", bench_backend(ow, reads), true);
+        hal_attach(SPI_MOSI, NULL);
+    }
+    return 0;
+}
@@ -0,0 +1,321 @@
+/*
+Records and replays the slots of the 1-Wire bus (see OneWireCapture.h).
+
+-w records a capture on the host: the DS1820 driver runs against the
+DS18B20 model of host/mbed, the capture file is the OneWireCapture
+structure like the one dumped from the board. -e flips the value of every
+n-th read slot in the file, to get captures with CRC errors.
+
+-r replays a capture, from the board or from -w, through the OneWire
+driver: each recorded slot is run again with reset(), write_bit() or
+read_bit() against a bus that answers what was recorded. The transactions
+are decoded (ROM and function commands, the bytes read, the temperature of
+a READ SCRATCHPAD and its CRC) and the slots the driver ran differently
+are counted:
+    mismatches      a write the device would have seen as the other bit,
+                    a reset that was not one
+    reads           bits read back other than recorded, e.g. when the
+                    sample point moved past the 0 the bus held
+    timing          the recorded and the replayed times of each slot kind
+The timing of the replay is simulated, so the output only changes with the
+driver and is good to diff between two versions of it. The wall time goes
+to stderr.
+
+Build:
+    g++ -O2 -std=c++11 -DONEWIRE_CAPTURE=1 -I../mbed -I../../DS1820 -I../../DS1820/OneWire -I../../Trace \
+        -o onewire_replay onewire_replay.cpp ../mbed/mbed.cpp ../mbed/HostHal.cpp ../mbed/HostDevices.cpp \
+        ../../DS1820/DS1820.cpp ../../DS1820/OneWire/OneWire.cpp
+
+Use:
+    ./onewire_replay -w <capture.owc> [-t <celsius>] [-n <reads>] [-e <n>]
+    ./onewire_replay -r <capture.owc> [-n <repeat>] [-h <hold_us>]
+    -t  temperature of the sensor (default 21.5)
+    -n  temperature reads to record (default 4), or times to replay (default 1)
+    -h  how long the bus holds a 0 read (default 30, the DS18B20 model)
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "HostDevices.h"
+#include "DS1820.h"
+
+#define REPLAY_PIN          p8
+#define REPLAY_ACCESS_NS    1000
+
+static const char*  slot_names[] = { "write", "read", "reset" };
+
+/**
+ * @brief   Records DS1820 reads into a capture file.
+ * @note
+ * @param   path:       the capture file
+ * @param   celsius:    temperature of the sensor
+ * @param   reads:      temperature reads to record
+ * @param   every:      flip every n-th read slot in the file, 0 for none
+ * @retval  exit code
+ */
+static int record(const char* path, float celsius, int reads, int every)
+{
+    Ds18b20Model    sensor(REPLAY_PIN);
+    DS1820          ds1820(REPLAY_PIN);
+    float           temp;
+
+    sensor.temperature(celsius);
+    if (!ds1820.begin()) {
+        fprintf(stderr, "the DS18B20 was not found\n");
+        return 1;
+    }
+    onewire_capture_resume();   // leave the search out
+
+    for (int i = 0; i < reads; i++) {
+        ds1820.startConversion();
+        wait_ms(750);
+        if (ds1820.read(temp) != 0)
+            fprintf(stderr, "read %d failed\n", i);
+    }
+
+    OneWireCapture  capture = onewire_capture;
+    uint32_t        flipped = 0;
+    uint32_t        n = 0;
+
+    for (uint32_t i = 0; every > 0 && i < capture.written && i < capture.slots; i++)
+        if (ONEWIRE_SLOT_KIND(capture.slot[i]) == ONEWIRE_SLOT_READ && ++n % every == 0) {
+            capture.slot[i] ^= 1 << 13;
+            flipped++;
+        }
+
+    FILE*   out = fopen(path, "wb");
+
+    if (out == NULL || fwrite(&capture, sizeof(capture), 1, out) != 1) {
+        fprintf(stderr, "cannot write %s\n", path);
+        return 1;
+    }
+    fclose(out);
+    printf("%u slots of %d reads at %.2f C, %u read slots flipped\n", (unsigned)capture.written, reads, celsius,
+           (unsigned)flipped);
+    return 0;
+}
+
+/**
+ * @brief   Loads a capture file and puts its slots in the order they were run.
+ * @note    A ring that wrapped starts at its first reset.
+ * @param   path:   the capture file
+ * @param   slots:  filled with the slots
+ * @retval  false when the file is not a capture
+ */
+static bool load(const char* path, std::vector<uint16_t>& slots)
+{
+    FILE*           in = fopen(path, "rb");
+    OneWireCapture  header;
+
+    if (in == NULL) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+    if (fread(&header, offsetof(OneWireCapture, slot), 1, in) != 1 || header.magic != ONEWIRE_CAPTURE_MAGIC ||
+        header.head >= header.slots) {
+        fprintf(stderr, "%s is not a 1-Wire capture\n", path);
+        fclose(in);
+        return false;
+    }
+
+    std::vector<uint16_t>   ring(header.slots);
+
+    if (fread(ring.data(), 2, header.slots, in) != header.slots) {
+        fprintf(stderr, "%s is short\n", path);
+        fclose(in);
+        return false;
+    }
+    fclose(in);
+
+    if (header.written <= header.slots) {
+        slots.assign(ring.begin(), ring.begin() + header.written);
+        return true;
+    }
+
+    bool    started = false;
+
+    for (uint32_t i = 0; i < header.slots; i++) {
+        uint16_t    slot = ring[(header.head + i) % header.slots];
+
+        started = started || ONEWIRE_SLOT_KIND(slot) == ONEWIRE_SLOT_RESET;
+        if (started)
+            slots.push_back(slot);
+    }
+    return true;
+}
+
+/**
+ * Decodes the bits of a transaction into bytes, in the order they went on the bus.
+ */
+struct Transaction
+{
+    bool                    present;
+    std::vector<uint8_t>    written;
+    std::vector<uint8_t>    read;
+    uint8_t                 byte;
+    uint8_t                 bits;
+    int                     kind;
+
+    void start(bool presence)
+    {
+        present = presence;
+        written.clear();
+        read.clear();
+        bits = 0;
+        kind = -1;
+    }
+
+    void bit(int slot_kind, uint8_t value)
+    {
+        if (slot_kind != kind)
+            bits = 0;   // a partial byte is dropped, e.g. the triplets of a search
+        kind = slot_kind;
+        byte = (byte >> 1) | (value << 7);
+        if (++bits < 8)
+            return;
+        bits = 0;
+        (kind == ONEWIRE_SLOT_WRITE ? written : read).push_back(byte);
+    }
+
+    void print(void) const
+    {
+        printf("reset %s", present ? "present" : "absent");
+        if (!written.empty()) {
+            printf(" | w");
+            for (size_t i = 0; i < written.size(); i++)
+                printf(" %02X", written[i]);
+        }
+        if (!read.empty()) {
+            printf(" | r");
+            for (size_t i = 0; i < read.size(); i++)
+                printf(" %02X", read[i]);
+        }
+        if (!written.empty() && written.back() == 0xBE && read.size() == 9) {
+            if (OneWire::crc8(read.data(), 8) != read[8])
+                printf(" | crc error");
+            else
+                printf(" | %.4f C", (int16_t)((read[1] << 8) | read[0]) / 16.0);
+        }
+        printf("\n");
+    }
+};
+
+/**
+ * @brief   Replays a capture through the OneWire driver.
+ * @note
+ * @param   path:       the capture file
+ * @param   repeat:     times to replay it
+ * @param   hold_us:    how long the bus holds a 0 read
+ * @retval  exit code
+ */
+static int replay(const char* path, int repeat, uint32_t hold_us)
+{
+    std::vector<uint16_t>   slots;
+
+    if (!load(path, slots))
+        return 1;
+
+    OneWire             ow(REPLAY_PIN);
+    OneWireReplayModel  bus(REPLAY_PIN, slots.data(), slots.size(), hold_us);
+    Transaction         transaction;
+    uint32_t            reads_differ = 0;
+    uint64_t            recorded_us[3] = { 0 };
+    uint64_t            replayed_us[3] = { 0 };
+    uint32_t            kinds[3] = { 0 };
+    uint64_t            start_us = hal_now_us();
+    struct timespec     wall_start, wall_end;
+
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+    for (int pass = 0; pass < repeat; pass++) {
+        bus.rewind();
+        transaction.start(false);
+        for (size_t i = 0; i < slots.size(); i++) {
+            int         kind = ONEWIRE_SLOT_KIND(slots[i]);
+            uint8_t     value;
+
+            onewire_capture_resume();   // the replay captures its own timing
+            if (kind == ONEWIRE_SLOT_RESET) {
+                if (pass == 0 && i > 0)
+                    transaction.print();
+                value = ow.reset();
+                transaction.start(value);
+            }
+            else if (kind == ONEWIRE_SLOT_WRITE) {
+                value = ONEWIRE_SLOT_VALUE(slots[i]);
+                ow.write_bit(value);
+                transaction.bit(kind, value);
+            }
+            else if (kind == ONEWIRE_SLOT_READ) {
+                value = ow.read_bit();
+                transaction.bit(kind, value);
+            }
+            else
+                continue;
+
+            if (value != ONEWIRE_SLOT_VALUE(slots[i]))
+                reads_differ++;
+            if (onewire_capture.written == 1) {
+                recorded_us[kind] += ONEWIRE_SLOT_US(slots[i]);
+                replayed_us[kind] += ONEWIRE_SLOT_US(onewire_capture.slot[0]);
+                kinds[kind]++;
+            }
+        }
+        if (pass == 0 && !slots.empty())
+            transaction.print();
+    }
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+
+    printf("slots %u x %d, mismatches %u, reads differing %u\n", (unsigned)slots.size(), repeat,
+           (unsigned)bus.mismatches(), (unsigned)reads_differ);
+    for (int k = 0; k < 3; k++)
+        if (kinds[k] > 0)
+            printf("%-6s %8u slots, recorded %6.2f us, replayed %6.2f us\n", slot_names[k], (unsigned)kinds[k],
+                   (double)recorded_us[k] / kinds[k], (double)replayed_us[k] / kinds[k]);
+    printf("bus time %.3f ms\n", (hal_now_us() - start_us) / 1e3);
+
+    double  wall = (wall_end.tv_sec - wall_start.tv_sec) + (wall_end.tv_nsec - wall_start.tv_nsec) / 1e9;
+
+    fprintf(stderr, "%.3f s wall, %.0f slots/s\n", wall, wall > 0 ? slots.size() * repeat / wall : 0);
+    return bus.mismatches() > 0 || reads_differ > 0;
+}
+
+int main(int argc, char** argv)
+{
+    const char* out = NULL;
+    const char* in = NULL;
+    float       celsius = 21.5;
+    int         count = 0;
+    int         every = 0;
+    uint32_t    hold_us = 30;
+
+    for (int i = 1; i < argc - 1; i += 2) {
+        if (strcmp(argv[i], "-w") == 0)
+            out = argv[i + 1];
+        else if (strcmp(argv[i], "-r") == 0)
+            in = argv[i + 1];
+        else if (strcmp(argv[i], "-t") == 0)
+            celsius = atof(argv[i + 1]);
+        else if (strcmp(argv[i], "-n") == 0)
+            count = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-e") == 0)
+            every = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-h") == 0)
+            hold_us = atoi(argv[i + 1]);
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if ((out == NULL) == (in == NULL)) {
+        fprintf(stderr, "usage: onewire_replay -w <capture.owc> [-t <celsius>] [-n <reads>] [-e <n>]\n"
+                        "       onewire_replay -r <capture.owc> [-n <repeat>] [-h <hold_us>]\n");
+        return 1;
+    }
+
+    hal_setup(REPLAY_ACCESS_NS, 0, NULL);
+    if (out != NULL)
+        return record(out, celsius, count > 0 ? count : 4, every);
+    return replay(in, count > 0 ? count : 1, hold_us);
+}
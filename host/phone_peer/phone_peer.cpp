@@ -0,0 +1,224 @@
+/*
+Stand-in for the phone app, speaking the framed protocol of PhoneProtocol.h.
+
+It sends command batches, measures the command round trip time until the
+board's PHONE_ACK, acks every PHONE_ALERT and estimates the alert delivery
+time as the alert age reported by the board plus half the smoothed round trip.
+
+Build:
+    g++ -O2 -I../../Framing -I../../PhoneLink -o phone_peer \
+        phone_peer.cpp ../../Framing/Framing.cpp
+
+Use:
+    ./phone_peer /dev/rfcomm0               talk to the board over Bluetooth
+    ./phone_peer --pty                      create a pseudo-terminal and print its
+                                            name, for the host simulation to open
+    options: -n <count>     number of command frames to send (default 100)
+             -i <ms>        interval between command frames (default 100)
+             -c <commands>  command batch, e.g. "35" (default: empty ping)
+             -t <seconds>   keep running to collect alerts (default: until done)
+*/
+#define _XOPEN_SOURCE 600
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+#include "Framing.h"
+#include "PhoneProtocol.h"
+
+static double now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static int open_port(const char* path)
+{
+    int fd;
+
+    if (strcmp(path, "--pty") == 0) {
+        fd = posix_openpt(O_RDWR | O_NOCTTY);
+        if (fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0)
+            return -1;
+        printf("pty: %s\n", ptsname(fd));
+        fflush(stdout);
+    }
+    else
+    if ((fd = open(path, O_RDWR | O_NOCTTY)) < 0)
+        return -1;
+
+    struct termios  tio;
+
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        cfsetispeed(&tio, B9600);
+        cfsetospeed(&tio, B9600);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+
+    return fd;
+}
+
+static void send_frame(int fd, const uint8_t* payload, size_t len)
+{
+    uint8_t     frame[FRAMING_MAX_ENCODED(PHONE_MAX_PAYLOAD)];
+    CobsEncoder enc(frame, sizeof(frame));
+
+    enc.put(payload, len);
+    len = enc.finish();
+    if (write(fd, frame, len) != (ssize_t)len)
+        perror("write");
+}
+
+static double percentile(std::vector<double> v, double p)
+{
+    if (v.empty())
+        return 0;
+    std::sort(v.begin(), v.end());
+    return v[(size_t)(p * (v.size() - 1) + 0.5)];
+}
+
+static void report(const char* what, const std::vector<double>& v)
+{
+    if (v.empty()) {
+        printf("%-16s no samples\n", what);
+        return;
+    }
+
+    printf("%-16s n=%zu min=%.2f p50=%.2f p99=%.2f max=%.2f ms\n", what, v.size(),
+           percentile(v, 0), percentile(v, 0.5), percentile(v, 0.99), percentile(v, 1));
+}
+
+int main(int argc, char* argv[])
+{
+    const char*     port = NULL;
+    const char*     commands = "";
+    int             count = 100;
+    double          interval = 100;
+    double          duration = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            count = atoi(argv[++i]);
+        else
+        if (strcmp(argv[i], "-i") == 0 && i + 1 < argc)
+            interval = atof(argv[++i]);
+        else
+        if (strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+            commands = argv[++i];
+        else
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+            duration = atof(argv[++i]) * 1000;
+        else
+            port = argv[i];
+    }
+
+    if (port == NULL || strlen(commands) > PHONE_MAX_BATCH) {
+        fprintf(stderr, "usage: %s [-n count] [-i ms] [-c commands] [-t s] <tty | --pty>\n", argv[0]);
+        return 1;
+    }
+
+    int fd = open_port(port);
+
+    if (fd < 0) {
+        perror(port);
+        return 1;
+    }
+
+    uint8_t             rxPayload[PHONE_MAX_PAYLOAD + 2];
+    CobsDecoder         decoder(rxPayload, sizeof(rxPayload));
+    std::vector<double> rtt, delivery;
+    double              start = now_ms();
+    double              sentAt = 0, nextSend = start;
+    double              srtt = 0;
+    bool                waiting = false;
+    uint8_t             seq = 0;
+    int                 sent = 0, retries = 0, alerts = 0, duplicates = 0, badFrames = 0;
+    bool                seenAlert[256] = { false };
+
+    while (sent < count || waiting || (duration > 0 && now_ms() - start < duration)) {
+        double  t = now_ms();
+
+        // (re)send the current command frame
+        if ((!waiting && sent < count && t >= nextSend) || (waiting && t - sentAt > 1000)) {
+            uint8_t p[PHONE_MAX_PAYLOAD];
+            size_t  n = strlen(commands);
+
+            if (waiting)
+                retries++;
+            else {
+                seq++;
+                sent++;
+            }
+
+            p[0] = PHONE_CMD;
+            p[1] = seq;
+            p[2] = n;
+            memcpy(&p[3], commands, n);
+            send_frame(fd, p, 3 + n);
+            sentAt = t;
+            waiting = true;
+        }
+
+        struct pollfd   pfd = { fd, POLLIN, 0 };
+
+        if (poll(&pfd, 1, 5) <= 0)
+            continue;
+
+        uint8_t buf[64];
+        ssize_t len = read(fd, buf, sizeof(buf));
+
+        if (len <= 0)
+            break;
+
+        for (ssize_t i = 0; i < len; i++) {
+            int n = decoder.feed(buf[i]);
+
+            if (n == CobsDecoder::FRAME_ERROR)
+                badFrames++;
+            if (n < 2)
+                continue;
+
+            t = now_ms();
+            if (rxPayload[0] == PHONE_ACK && waiting && rxPayload[1] == seq) {
+                double  r = t - sentAt;
+
+                rtt.push_back(r);
+                srtt = srtt == 0 ? r : 0.875 * srtt + 0.125 * r;
+                waiting = false;
+                nextSend = sentAt + interval;
+            }
+            else
+            if (rxPayload[0] == PHONE_ALERT && n >= 7) {
+                uint8_t ack[2] = { PHONE_ALERT_ACK, rxPayload[1] };
+                double  age = rxPayload[5] | (rxPayload[6] << 8);
+
+                send_frame(fd, ack, sizeof(ack));
+                if (seenAlert[rxPayload[1]])
+                    duplicates++;
+                else {
+                    seenAlert[rxPayload[1]] = true;
+                    alerts++;
+                    delivery.push_back(age + srtt / 2);
+                    printf("alert %c priority %u seq %u attempt %u age %.0f ms\n", rxPayload[3],
+                           rxPayload[2], rxPayload[1], rxPayload[4], age);
+                }
+            }
+        }
+    }
+
+    report("command rtt", rtt);
+    report("alert delivery", delivery);
+    printf("commands %d, retries %d, alerts %d, duplicate alerts %d, bad frames %d\n",
+           sent, retries, alerts, duplicates, badFrames);
+    close(fd);
+    return 0;
+}
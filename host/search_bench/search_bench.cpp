@@ -0,0 +1,326 @@
+/*
+Compares the ROM search of OneWire, search() one device at a time against
+search_all(), on a simulated bus of 1 to 1000 devices.
+
+The devices answer SEARCH ROM only, with random ROMs (fixed seed) of four
+families, a quarter of them DS18B20 (0x28). Each bus size is enumerated in
+full and for the 0x28 family alone, by both searches, and the ROMs found
+are checked against each other. For each run:
+    passes      resets, one per search pass
+    slots       read and write slots, the 8 of the command included
+    bus ms      simulated time on the bus, what the search takes on the board
+    wall ms     host time of the run, mostly the bus simulation
+
+A pass has to walk the 64 bits from the root, 3 slots each, whatever the
+search knows already, so a full enumeration takes one pass per device with
+either search. search_all() saves the pass a family search makes into the
+next family and the work of finding the discrepancies again.
+
+Build:
+    g++ -O2 -std=c++11 -I../mbed -I../../DS1820/OneWire -I../../Trace \
+        -o search_bench search_bench.cpp ../mbed/mbed.cpp ../mbed/HostHal.cpp ../../DS1820/OneWire/OneWire.cpp
+
+Use:
+    ./search_bench [-n <devices>] [-c <ns>]
+    -n  largest bus (default 1000), the sizes go 1, 2, 5, 10, ... up to it
+    -c  simulated time taken by one HAL call (default 1000)
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+#include "HostHal.h"
+#include "OneWire.h"
+
+#define BENCH_PIN           p8
+#define BENCH_FAMILY        0x28
+
+#define OW_RESET_US         480     // same timing as the DS18B20 model
+#define OW_PRESENCE_US      30
+#define OW_PRESENCE_LEN_US  120
+#define OW_SLOT_US          15
+#define OW_ZERO_US          30
+
+typedef std::vector<uint64_t>   RomList;
+
+/**
+ * Devices on a 1-Wire bus that answer SEARCH ROM.
+ * They all go through the search in step, so the slot decoding is shared
+ * and only the devices still on the path are kept.
+ */
+class SearchBusModel : public HalPinModel
+{
+    enum State {
+        IDLE,
+        ROM_COMMAND,
+        SEARCH_ROM
+    };
+
+    PinName     _pin;
+    RomList     _roms;
+    RomList     _active;
+    State       _state;
+    int         _master;
+    uint64_t    _fall_us;
+    uint64_t    _low_from;
+    uint64_t    _low_until;
+    uint8_t     _command;
+    uint8_t     _bits;
+    uint8_t     _searchBit;
+    uint8_t     _searchPhase;
+
+public:
+    uint32_t    resets;
+    uint32_t    slots;
+
+    SearchBusModel(PinName pin, const RomList& roms) :
+        _pin(pin),
+        _roms(roms),
+        _state(IDLE),
+        _master(1),
+        _fall_us(0),
+        _low_from(0),
+        _low_until(0),
+        _command(0),
+        _bits(0),
+        _searchBit(0),
+        _searchPhase(0),
+        resets(0),
+        slots(0)
+    {
+        hal_attach(pin, this);
+    }
+
+    ~SearchBusModel()
+    {
+        hal_attach(_pin, NULL);
+    }
+
+    virtual void driven(PinName pin, int level)
+    {
+        uint64_t    now = hal_now_us();
+
+        if (level == _master)
+            return;
+        _master = level;
+
+        // falling edge: a read slot of the search gets the wired AND of the bit, or of its complement
+        if (!level) {
+            _fall_us = now;
+            if (_state == SEARCH_ROM && _searchPhase < 2) {
+                bool    zero = false;
+
+                for (size_t i = 0; i < _active.size() && !zero; i++)
+                    zero = ((_active[i] >> _searchBit) & 1) == (_searchPhase == 0 ? 0 : 1);
+                if (zero) {
+                    _low_from = now;
+                    _low_until = now + OW_ZERO_US;
+                }
+            }
+            return;
+        }
+
+        uint64_t    low = now - _fall_us;
+
+        if (low >= OW_RESET_US) {
+            resets++;
+            if (!_roms.empty()) {
+                _low_from = now + OW_PRESENCE_US;
+                _low_until = _low_from + OW_PRESENCE_LEN_US;
+            }
+            _state = ROM_COMMAND;
+            _command = 0;
+            _bits = 0;
+            return;
+        }
+
+        slots++;
+        if (_state == ROM_COMMAND) {
+            _command |= (low < OW_SLOT_US ? 1 : 0) << _bits;
+            if (++_bits < 8)
+                return;
+            _state = _command == 0xF0 ? SEARCH_ROM : IDLE;
+            _active = _roms;
+            _searchBit = 0;
+            _searchPhase = 0;
+        }
+        else if (_state == SEARCH_ROM && _searchPhase++ == 2) {
+            // the master picked a direction, devices that don't match drop out
+            uint64_t    b = low < OW_SLOT_US ? 1 : 0;
+
+            _active.erase(std::remove_if(_active.begin(), _active.end(),
+                [this, b](uint64_t rom) { return ((rom >> _searchBit) & 1) != b; }), _active.end());
+            _searchPhase = 0;
+            if (++_searchBit == 64)
+                _state = IDLE;
+        }
+    }
+
+    virtual int level(PinName pin)
+    {
+        uint64_t    now = hal_now_us();
+
+        return !(now >= _low_from && now < _low_until);
+    }
+};
+
+static uint64_t rom_value(const uint8_t* rom)
+{
+    uint64_t    v = 0;
+
+    for (int i = 7; i >= 0; i--)
+        v = (v << 8) | rom[i];
+    return v;
+}
+
+/**
+ * @brief   Makes the ROMs of a bus, a quarter of each family.
+ * @note    A fixed seed, the buses are the same from run to run.
+ * @param   count:  devices on the bus
+ * @retval
+ */
+static RomList make_roms(uint32_t count)
+{
+    static const uint8_t    families[4] = { 0x28, 0x10, 0x22, 0x3B };
+    uint64_t                seed = 0x9E3779B97F4A7C15ULL;
+    RomList                 roms;
+
+    for (uint32_t n = 0; n < count; n++) {
+        uint8_t rom[8];
+
+        rom[0] = families[n % 4];
+        for (int i = 1; i < 7; i++) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            rom[i] = (uint8_t)(seed >> 56);
+        }
+        rom[7] = OneWire::crc8(rom, 7);
+        roms.push_back(rom_value(rom));
+    }
+    return roms;
+}
+
+struct BenchRun
+{
+    uint32_t    found;
+    uint32_t    passes;
+    uint32_t    slots;
+    double      bus_ms;
+    double      wall_ms;
+    RomList     roms;
+};
+
+/**
+ * @brief   Runs one search on a fresh bus.
+ * @note
+ * @param   roms:       devices on the bus
+ * @param   cached:     search_all() rather than search()
+ * @param   family:     family to look for, 0 for all
+ * @retval
+ */
+static BenchRun bench_search(const RomList& roms, bool cached, uint8_t family)
+{
+    OneWire         ow(BENCH_PIN);
+    SearchBusModel  bus(BENCH_PIN, roms);
+    BenchRun        run;
+    uint64_t        start_us = hal_now_us();
+    struct timespec wall_start, wall_end;
+
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+    if (cached) {
+        std::vector<uint8_t>    found((roms.size() + 1) * 8);
+        uint16_t                n = ow.search_all((uint8_t (*)[8])found.data(), roms.size() + 1, family);
+
+        for (uint16_t i = 0; i < n; i++)
+            run.roms.push_back(rom_value(&found[i * 8]));
+    }
+    else {
+        uint8_t rom[8];
+
+        if (family)
+            ow.target_search(family);
+        else
+            ow.reset_search();
+        while (ow.search(rom) && (!family || rom[0] == family))
+            run.roms.push_back(rom_value(rom));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+
+    run.found = run.roms.size();
+    run.passes = bus.resets;
+    run.slots = bus.slots;
+    run.bus_ms = (hal_now_us() - start_us) / 1e3;
+    run.wall_ms = (wall_end.tv_sec - wall_start.tv_sec) * 1e3 + (wall_end.tv_nsec - wall_start.tv_nsec) / 1e6;
+    std::sort(run.roms.begin(), run.roms.end());
+    return run;
+}
+
+/**
+ * @brief   Tells if a search found exactly the devices it should.
+ * @note
+ * @param
+ * @retval
+ */
+static bool bench_check(const BenchRun& run, const RomList& roms, uint8_t family)
+{
+    RomList expected;
+
+    for (size_t i = 0; i < roms.size(); i++)
+        if (!family || (roms[i] & 0xFF) == family)
+            expected.push_back(roms[i]);
+    std::sort(expected.begin(), expected.end());
+    return run.roms == expected;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t    largest = 1000;
+    uint32_t    cost_ns = 1000;
+
+    for (int i = 1; i < argc - 1; i += 2) {
+        if (strcmp(argv[i], "-n") == 0)
+            largest = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-c") == 0)
+            cost_ns = atoi(argv[i + 1]);
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (largest < 1 || largest > 0xFFFE) {
+        fprintf(stderr, "-n goes from 1 to %u\n", 0xFFFE);
+        return 1;
+    }
+
+    static const uint32_t   steps[3] = { 1, 2, 5 };
+    int                     failed = 0;
+
+    hal_setup(cost_ns, 0, NULL);
+    printf("%7s %-6s %-10s %6s %7s %9s %10s %9s\n", "devices", "family", "search", "found", "passes", "slots",
+           "bus ms", "wall ms");
+    for (uint32_t decade = 1; decade <= largest; decade *= 10)
+        for (int s = 0; s < 3; s++) {
+            uint32_t    count = steps[s] * decade;
+
+            if (count > largest)
+                count = largest;
+
+            RomList     roms = make_roms(count);
+
+            for (int f = 0; f < 2; f++)
+                for (int cached = 0; cached < 2; cached++) {
+                    uint8_t     family = f ? BENCH_FAMILY : 0;
+                    BenchRun    run = bench_search(roms, cached, family);
+                    bool        ok = bench_check(run, roms, family);
+
+                    printf("%7u %-6s %-10s %6u %7u %9u %10.1f %9.1f%s\n", (unsigned)count, f ? "0x28" : "all",
+                           cached ? "search_all" : "search", (unsigned)run.found, (unsigned)run.passes,
+                           (unsigned)run.slots, run.bus_ms, run.wall_ms, ok ? "" : "  WRONG");
+                    failed |= !ok;
+                }
+            if (count == largest)
+                return failed;
+        }
+    return failed;
+}
@@ -0,0 +1,209 @@
+#include <string.h>
+#include "TelemetryDecoder.h"
+
+/**
+ * @brief   Constructs a decoder with an empty state.
+ * @note
+ * @param
+ * @retval
+ */
+TelemetryDecoder::TelemetryDecoder() :
+    _cobs(_payload, sizeof(_payload)),
+    _haveSeq(false),
+    _nextSeq(0),
+    _handler(NULL),
+    _handlerCtx(NULL)
+{
+    memset(&_state, 0, sizeof(_state));
+}
+
+/**
+ * @brief   Registers a callback invoked for every decoded record.
+ * @note    Unknown record types are passed on too, 'len' tells how long they are.
+ * @param
+ * @retval
+ */
+void TelemetryDecoder::onRecord(RecordHandler handler, void* ctx)
+{
+    _handler = handler;
+    _handlerCtx = ctx;
+}
+
+/**
+ * @brief   Feeds raw bytes received from the serial port.
+ * @note    Bytes outside of frames (e.g. boot messages) are dropped by the
+ *          framing layer and counted as errors.
+ * @param
+ * @retval  Number of valid frames completed by these bytes.
+ */
+int TelemetryDecoder::feed(const uint8_t* data, size_t len)
+{
+    int frames = 0;
+
+    _state.bytes += len;
+    while (len--) {
+        int n = _cobs.feed(*data++);
+
+        if (n == CobsDecoder::FRAME_ERROR)
+            _state.errors++;
+        else
+        if (n > 0 && decodePayload(_payload, n))
+            frames++;
+    }
+
+    return frames;
+}
+
+/**
+ * @brief   Decodes one unstuffed, CRC checked frame payload.
+ * @note    The records are checked before the sequence number: a board that
+ *          rebooted starts again at 0, its TLM_BOOT frame is not a gap.
+ * @param
+ * @retval  false if the frame has an unsupported version or is truncated.
+ */
+bool TelemetryDecoder::decodePayload(const uint8_t* payload, size_t len)
+{
+    if (len < 2 || payload[0] != TELEMETRY_VERSION) {
+        _state.unknown++;
+        return false;
+    }
+
+    bool    boot = false;
+    size_t  i = 2;
+
+    while (i < len) {
+        uint8_t tag = payload[i++];
+
+        if (i + TLM_TAG_LEN(tag) > len) {
+            _state.errors++;
+            return false;
+        }
+
+        boot |= TLM_TAG_TYPE(tag) == TLM_BOOT;
+        i += TLM_TAG_LEN(tag);
+    }
+
+    uint8_t seq = payload[1];
+
+    if (_haveSeq && !boot && seq != _nextSeq)
+        _state.lost += (uint8_t)(seq - _nextSeq);
+    _haveSeq = true;
+    _nextSeq = seq + 1;
+
+    i = 2;
+    while (i < len) {
+        uint8_t tag = payload[i++];
+        uint8_t rlen = TLM_TAG_LEN(tag);
+
+        apply(TLM_TAG_TYPE(tag), &payload[i], rlen);
+        if (_handler != NULL)
+            _handler(_handlerCtx, TLM_TAG_TYPE(tag), &payload[i], rlen);
+        i += rlen;
+    }
+
+    _state.frames++;
+    return true;
+}
+
+/**
+ * @brief   Stores a record in the state.
+ * @note
+ * @param
+ * @retval
+ */
+void TelemetryDecoder::apply(uint8_t type, const uint8_t* p, uint8_t len)
+{
+    switch (type) {
+        case TLM_TEMPERATURE:
+            if (len < 2) break;
+            _state.temp_centi = (int16_t)(p[0] | (p[1] << 8));
+            break;
+
+        case TLM_WATER:
+            if (len < 2) break;
+            _state.water = p[0] | (p[1] << 8);
+            break;
+
+        case TLM_DISTANCE:
+            if (len < 2) break;
+            _state.distance_cm = p[0] | (p[1] << 8);
+            break;
+
+        case TLM_GARAGE:
+            if (len < 2) break;
+            _state.garage_pos = p[0];
+            _state.garage_mode = p[1];
+            break;
+
+        case TLM_MODE:
+            if (len < 1) break;
+            _state.mode = p[0];
+            break;
+
+        case TLM_ALARM:
+            if (len < 2) break;
+            _state.alarm_type = p[0];
+            _state.alarm_active = p[1];
+            break;
+
+        case TLM_FAULT:
+            if (len < 2) break;
+            _state.fault_device = p[0];
+            _state.fault_code = p[1];
+            break;
+
+        case TLM_APP_LINK:
+            if (len < 2) break;
+            _state.app_out = p[0];
+            _state.app_in = p[1];
+            break;
+
+        case TLM_BOOT:
+            break;      // restarts the sequence numbers, see decodePayload()
+
+        case TLM_ACTUATORS:
+            if (len < 8) break;
+            _state.actuator_writes = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+            _state.actuator_suppressed = p[4] | (p[5] << 8) | (p[6] << 16) | ((uint32_t)p[7] << 24);
+            break;
+
+        case TLM_SAFE_STATE:
+            if (len < 15) break;
+            _state.safe_active = p[0];
+            _state.safe_wake_us = p[1] | (p[2] << 8);
+            _state.safe_max_wake_us = p[3] | (p[4] << 8);
+            _state.safe_alert_ms = p[5] | (p[6] << 8);
+            _state.safe_wakeups = p[7] | (p[8] << 8) | (p[9] << 16) | ((uint32_t)p[10] << 24);
+            _state.safe_interrupts = p[11] | (p[12] << 8) | (p[13] << 16) | ((uint32_t)p[14] << 24);
+            break;
+
+        case TLM_LOOP:
+            if (len < 11) break;
+            _state.reset_cause = p[0];
+            _state.stalled_task = p[1];
+            _state.loop_resets = p[2] | (p[3] << 8);
+            _state.overrun_task = p[4];
+            _state.overruns = p[5] | (p[6] << 8);
+            _state.overrun_worst_us = p[7] | (p[8] << 8) | (p[9] << 16) | ((uint32_t)p[10] << 24);
+            break;
+
+        case TLM_ONEWIRE:
+            if (len < 12) break;
+            if (p[0] != 0xFF) break;    // the devices add up to the bus
+            _state.onewire_quarantined = p[1];
+            _state.onewire_presence_failures = p[2] | (p[3] << 8);
+            _state.onewire_crc_errors = p[4] | (p[5] << 8);
+            _state.onewire_retries = p[6] | (p[7] << 8);
+            _state.onewire_quarantines = p[8] | (p[9] << 8);
+            break;
+
+        case TLM_TRACE:
+            break;      // events of a trace dump, host/trace_view puts them together
+
+        default:
+            _state.unknown++;
+            return;
+    }
+
+    _state.seen |= (1 << type);
+}
@@ -0,0 +1,83 @@
+#ifndef TELEMETRY_DECODER_H_
+#define TELEMETRY_DECODER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "Framing.h"
+#include "TelemetryProtocol.h"
+
+/**
+ * Latest known value of every telemetry record plus link statistics.
+ */
+struct TelemetryState
+{
+    int16_t     temp_centi;
+    uint16_t    water;
+    uint16_t    distance_cm;
+    uint8_t     garage_pos;
+    uint8_t     garage_mode;
+    uint8_t     mode;
+    uint8_t     alarm_type;
+    uint8_t     alarm_active;
+    uint8_t     app_out;
+    uint8_t     app_in;
+    uint8_t     fault_device;
+    uint8_t     fault_code;
+    uint32_t    actuator_writes;
+    uint32_t    actuator_suppressed;
+    uint8_t     safe_active;
+    uint16_t    safe_wake_us;
+    uint16_t    safe_max_wake_us;
+    uint16_t    safe_alert_ms;
+    uint32_t    safe_wakeups;
+    uint32_t    safe_interrupts;
+    uint8_t     reset_cause;
+    uint8_t     stalled_task;
+    uint16_t    loop_resets;
+    uint8_t     overrun_task;   // last task reported
+    uint16_t    overruns;
+    uint32_t    overrun_worst_us;
+    uint8_t     onewire_quarantined;    // of the bus, any device
+    uint16_t    onewire_presence_failures;
+    uint16_t    onewire_crc_errors;
+    uint16_t    onewire_retries;
+    uint16_t    onewire_quarantines;
+    uint16_t    seen;           // bit n set once record type n has been received
+
+    uint32_t    frames;         // valid frames
+    uint32_t    errors;         // frames dropped by the framing layer (CRC, stuffing)
+    uint32_t    lost;           // frames missing according to the sequence numbers
+    uint32_t    unknown;        // records skipped because of an unknown type or version
+    uint32_t    bytes;          // bytes fed in
+};
+
+/**
+ * Host side decoder for the board's binary telemetry stream.
+ * Mirrors Telemetry.h on the target, see TelemetryProtocol.h for the format.
+ */
+class TelemetryDecoder
+{
+public:
+    typedef void (*RecordHandler)(void* ctx, uint8_t type, const uint8_t* payload, uint8_t len);
+
+private:
+    uint8_t         _payload[TELEMETRY_MAX_PAYLOAD + 2];
+    CobsDecoder     _cobs;
+    TelemetryState  _state;
+    bool            _haveSeq;
+    uint8_t         _nextSeq;
+    RecordHandler   _handler;
+    void*           _handlerCtx;
+
+    void    apply(uint8_t type, const uint8_t* p, uint8_t len);
+
+public:
+    TelemetryDecoder();
+
+    void    onRecord(RecordHandler handler, void* ctx);
+    int     feed(const uint8_t* data, size_t len);
+    bool    decodePayload(const uint8_t* payload, size_t len);
+
+    const TelemetryState&   state(void) const { return _state; }
+};
+#endif /* TELEMETRY_DECODER_H_ */
@@ -0,0 +1,117 @@
+/*
+Host tool printing the board's binary telemetry in human readable form.
+
+Build:
+    g++ -O2 -I../../Framing -I../../Telemetry -o telemetry_dump \
+        telemetry_dump.cpp TelemetryDecoder.cpp ../../Framing/Framing.cpp
+
+Use:
+    stty -F /dev/ttyACM0 9600 raw && ./telemetry_dump < /dev/ttyACM0
+    ./telemetry_dump capture.bin
+*/
+#include <stdio.h>
+#include "TelemetryDecoder.h"
+
+static void short_record(uint8_t type, uint8_t len)
+{
+    printf("short record %u (%u bytes)\n", type, len);
+}
+
+static void print_record(void* ctx, uint8_t type, const uint8_t* p, uint8_t len)
+{
+    (void)ctx;
+    switch (type) {
+        case TLM_TEMPERATURE:
+            if (len < 2) return short_record(type, len);
+            printf("temperature = %.2f C\n", (int16_t)(p[0] | (p[1] << 8)) / 100.0);
+            break;
+        case TLM_WATER:
+            if (len < 2) return short_record(type, len);
+            printf("water = %u\n", p[0] | (p[1] << 8));
+            break;
+        case TLM_DISTANCE:
+            if (len < 2) return short_record(type, len);
+            printf("distance = %u cm\n", p[0] | (p[1] << 8));
+            break;
+        case TLM_GARAGE:
+            if (len < 2) return short_record(type, len);
+            printf("garage position = %u, mode = %u\n", p[0], p[1]);
+            break;
+        case TLM_MODE:
+            if (len < 1) return short_record(type, len);
+            printf("system mode = %u\n", p[0]);
+            break;
+        case TLM_ALARM:
+            if (len < 2) return short_record(type, len);
+            printf("alarm = %c, active = %u\n", p[0], p[1]);
+            break;
+        case TLM_FAULT:
+            if (len < 2) return short_record(type, len);
+            printf("fault device = %u, code = %u\n", p[0], p[1]);
+            break;
+        case TLM_APP_LINK:
+            if (len < 2) return short_record(type, len);
+            printf("app signal = %c, app input signal = %c\n", p[0], p[1]);
+            break;
+        case TLM_BOOT:
+            printf("--Starting-- (protocol %u)\n", len ? p[0] : 0);
+            break;
+        case TLM_ACTUATORS:
+            if (len < 8) return short_record(type, len);
+            printf("actuator writes = %u, suppressed = %u\n",
+                   p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned)p[3] << 24),
+                   p[4] | (p[5] << 8) | (p[6] << 16) | ((unsigned)p[7] << 24));
+            break;
+        case TLM_SAFE_STATE:
+            if (len < 15) return short_record(type, len);
+            printf("safe state = %u, awake %u us per wakeup (longest %u us), alert latency = %u ms, "
+                   "wakeups = %u, other interrupts = %u\n", p[0], p[1] | (p[2] << 8), p[3] | (p[4] << 8),
+                   p[5] | (p[6] << 8), p[7] | (p[8] << 8) | (p[9] << 16) | ((unsigned)p[10] << 24),
+                   p[11] | (p[12] << 8) | (p[13] << 16) | ((unsigned)p[14] << 24));
+            break;
+        case TLM_LOOP:
+            if (len < 11) return short_record(type, len);
+            printf("reset cause = %u, stalled task = %u, resets = %u, task %u overruns = %u, worst = %u us\n",
+                   p[0], p[1], p[2] | (p[3] << 8), p[4], p[5] | (p[6] << 8),
+                   p[7] | (p[8] << 8) | (p[9] << 16) | ((unsigned)p[10] << 24));
+            break;
+        case TLM_ONEWIRE:
+            if (len < 12) return short_record(type, len);
+            printf("1-wire %s %u: quarantined = %u, presence failures = %u, crc errors = %u, retries = %u, "
+                   "quarantines = %u, skipped = %u\n", p[0] == 0xFF ? "bus" : "device", p[0] == 0xFF ? 0 : p[0], p[1],
+                   p[2] | (p[3] << 8), p[4] | (p[5] << 8), p[6] | (p[7] << 8), p[8] | (p[9] << 8), p[10] | (p[11] << 8));
+            break;
+        case TLM_TRACE:
+            if (len < 8) return short_record(type, len);
+            printf("trace cycles = %u, point = %u, kind = %u, arg = %u\n",
+                   p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned)p[3] << 24), p[4], p[5], p[6] | (p[7] << 8));
+            break;
+        default:
+            printf("unknown record %u (%u bytes)\n", type, len);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    FILE*               in = stdin;
+    TelemetryDecoder    decoder;
+    uint8_t             buf[256];
+    size_t              n;
+
+    if (argc > 1 && (in = fopen(argv[1], "rb")) == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    decoder.onRecord(print_record, NULL);
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+        decoder.feed(buf, n);
+        fflush(stdout);
+    }
+
+    const TelemetryState&   s = decoder.state();
+
+    fprintf(stderr, "%u bytes, %u frames, %u errors, %u lost, %u unknown\n",
+            s.bytes, s.frames, s.errors, s.lost, s.unknown);
+    return 0;
+}
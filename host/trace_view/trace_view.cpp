@@ -0,0 +1,326 @@
+/*
+Host tool for the trace dumps of a board built with HOUSE_TRACE=1 (see
+TraceRing.h). It reads the telemetry stream, puts the TLM_TRACE records of
+a dump back together and shows:
+    - the latency of every trace point: count, mean, p50, p99 and max,
+    - a timeline of the dump, nested spans indented,
+    - with -f, folded stacks with the self time of each span in us, for
+      flamegraph.pl,
+    - with -c, Chrome trace events JSON, for chrome://tracing or Perfetto.
+
+The cycle counter wraps every 44 s at 96 MHz, the times are unwrapped from
+one event to the next, so a dump must not have a gap that long.
+
+Build:
+    g++ -O2 -I../../Framing -I../../Telemetry -I../../Trace -I../telemetry -o trace_view \
+        trace_view.cpp ../telemetry/TelemetryDecoder.cpp ../../Framing/Framing.cpp
+
+Use:
+    echo -n T > /dev/ttyACM0                    (asks the board for a dump)
+    ./trace_view [-d <dump>] [-h <core hz>] [-f | -c] capture.bin
+    -d  which dump of the capture, 0 is the first (default: the last one)
+    -h  core clock (default 96000000)
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include "TelemetryDecoder.h"
+#include "TraceRing.h"
+
+static const char*  TRACE_NAMES[TP_COUNT] = {
+    "dump", "onewire_reset", "ds1820_convert", "ds1820_read", "ranger_echo",
+    "water_burst", "pir", "mode", "telemetry_tx", "phone_tx"
+};
+
+struct ViewEvent
+{
+    double      us;         // since the oldest event of the dump
+    uint8_t     point;
+    uint8_t     kind;
+    uint16_t    arg;
+};
+
+struct ViewSpan
+{
+    std::string path;       // names of the enclosing spans, ';' separated
+    uint8_t     point;
+    int         depth;
+    double      start_us;
+    double      us;
+    double      child_us;
+    uint16_t    begin_arg;
+    uint16_t    end_arg;
+};
+
+typedef std::vector<TraceEvent>    RawDump;
+
+static std::vector<RawDump> view_dumps;
+
+static const char* view_name(uint8_t point)
+{
+    static char unknown[16];
+
+    if (point < TP_COUNT)
+        return TRACE_NAMES[point];
+    snprintf(unknown, sizeof(unknown), "point%u", point);
+    return unknown;
+}
+
+static void view_record(void* ctx, uint8_t type, const uint8_t* p, uint8_t len)
+{
+    (void)ctx;
+    if (type != TLM_TRACE || len < 8)
+        return;
+
+    TraceEvent  e;
+
+    e.cycles = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    e.point = p[4];
+    e.kind = p[5];
+    e.arg = p[6] | (p[7] << 8);
+    if (e.point == TP_DUMP && e.kind == TRACE_KIND_MARK)
+        view_dumps.push_back(RawDump());
+    if (!view_dumps.empty())
+        view_dumps.back().push_back(e);
+}
+
+// The dump mark comes first but is the newest event, the others are in order
+static std::vector<ViewEvent> view_unwrap(const RawDump& dump, double hz)
+{
+    std::vector<ViewEvent>  events;
+    uint64_t                cycles = 0;
+
+    for (size_t i = 1; i < dump.size(); i++) {
+        ViewEvent   e;
+
+        if (i > 1)
+            cycles += (uint32_t)(dump[i].cycles - dump[i - 1].cycles);
+        e.us = cycles * 1e6 / hz;
+        e.point = dump[i].point;
+        e.kind = dump[i].kind;
+        e.arg = dump[i].arg;
+        events.push_back(e);
+    }
+    return events;
+}
+
+// Matches the begins and ends, spans whose begin was overwritten in the ring are dropped
+static std::vector<ViewSpan> view_spans(const std::vector<ViewEvent>& events)
+{
+    std::vector<ViewSpan>   spans;
+    std::vector<size_t>     open;
+
+    for (size_t i = 0; i < events.size(); i++) {
+        const ViewEvent&    e = events[i];
+
+        if (e.kind == TRACE_KIND_BEGIN) {
+            ViewSpan    s;
+
+            s.path = open.empty() ? view_name(e.point) : spans[open.back()].path + ";" + view_name(e.point);
+            s.point = e.point;
+            s.depth = (int)open.size();
+            s.start_us = e.us;
+            s.us = -1;
+            s.child_us = 0;
+            s.begin_arg = e.arg;
+            s.end_arg = 0;
+            open.push_back(spans.size());
+            spans.push_back(s);
+        }
+        else if (e.kind == TRACE_KIND_END) {
+            size_t  depth = open.size();
+
+            while (depth > 0 && spans[open[depth - 1]].point != e.point)
+                depth--;
+            if (depth == 0)
+                continue;
+
+            ViewSpan&   s = spans[open[depth - 1]];
+
+            s.us = e.us - s.start_us;
+            s.end_arg = e.arg;
+            if (depth >= 2)
+                spans[open[depth - 2]].child_us += s.us;
+            open.resize(depth - 1);     // the spans begun inside it that never ended are left open
+        }
+    }
+    return spans;
+}
+
+static double view_percentile(std::vector<double> v, double p)
+{
+    if (v.empty())
+        return 0;
+    std::sort(v.begin(), v.end());
+
+    size_t  rank = (size_t)(p / 100.0 * v.size() + 0.999999);
+
+    return v[rank > 0 ? rank - 1 : 0];
+}
+
+static void view_mark(char* text, size_t size, const ViewEvent& e)
+{
+    if (e.point == TP_PIR)
+        snprintf(text, size, "pir zone %u %s", e.arg >> 8, (e.arg & 0xFF) ? "motion" : "still");
+    else if (e.point == TP_MODE)
+        snprintf(text, size, "mode %u -> %u", e.arg >> 8, e.arg & 0xFF);
+    else if (e.point == TP_RANGER_ECHO)
+        snprintf(text, size, "ranger_echo %u cm", e.arg);
+    else
+        snprintf(text, size, "%s %u", view_name(e.point), e.arg);
+}
+
+static void view_summary(const std::vector<ViewEvent>& events, const std::vector<ViewSpan>& spans)
+{
+    std::map<uint8_t, std::vector<double> > durations;
+    std::map<uint8_t, unsigned>             marks;
+
+    for (size_t i = 0; i < spans.size(); i++)
+        if (spans[i].us >= 0)
+            durations[spans[i].point].push_back(spans[i].us);
+    for (size_t i = 0; i < events.size(); i++)
+        if (events[i].kind == TRACE_KIND_MARK)
+            marks[events[i].point]++;
+
+    printf("%u events over %.3f ms\n\n", (unsigned)events.size(), events.empty() ? 0 : events.back().us / 1000);
+    printf("%-16s %7s %10s %10s %10s %10s\n", "span", "count", "mean us", "p50 us", "p99 us", "max us");
+    for (std::map<uint8_t, std::vector<double> >::iterator it = durations.begin(); it != durations.end(); ++it) {
+        const std::vector<double>&  d = it->second;
+        double                      total = 0;
+
+        for (size_t i = 0; i < d.size(); i++)
+            total += d[i];
+        printf("%-16s %7u %10.1f %10.1f %10.1f %10.1f\n", view_name(it->first), (unsigned)d.size(), total / d.size(),
+               view_percentile(d, 50), view_percentile(d, 99), view_percentile(d, 100));
+    }
+    for (std::map<uint8_t, unsigned>::iterator it = marks.begin(); it != marks.end(); ++it)
+        printf("%-16s %7u\n", view_name(it->first), it->second);
+
+    // timeline, spans in the order they began with the marks in between
+    size_t  s = 0;
+
+    printf("\n%12s\n", "ms");
+    for (size_t i = 0; i < events.size(); i++) {
+        const ViewEvent&    e = events[i];
+        char                text[64];
+
+        if (e.kind == TRACE_KIND_MARK) {
+            view_mark(text, sizeof(text), e);
+            printf("%12.3f  * %s\n", e.us / 1000, text);
+        }
+        else if (e.kind == TRACE_KIND_BEGIN && s < spans.size()) {
+            const ViewSpan& span = spans[s++];
+
+            if (span.us < 0)
+                printf("%12.3f  %*s%s (no end)\n", e.us / 1000, 2 * span.depth, "", view_name(span.point));
+            else
+                printf("%12.3f  %*s%s %.1f us, %u -> %u\n", e.us / 1000, 2 * span.depth, "", view_name(span.point),
+                       span.us, span.begin_arg, span.end_arg);
+        }
+    }
+}
+
+static void view_folded(const std::vector<ViewSpan>& spans)
+{
+    std::map<std::string, double>   self;
+
+    for (size_t i = 0; i < spans.size(); i++)
+        if (spans[i].us >= 0)
+            self[spans[i].path] += spans[i].us - spans[i].child_us;
+    for (std::map<std::string, double>::iterator it = self.begin(); it != self.end(); ++it)
+        printf("%s %.0f\n", it->first.c_str(), it->second);
+}
+
+static void view_chrome(const std::vector<ViewEvent>& events, const std::vector<ViewSpan>& spans)
+{
+    bool    first = true;
+
+    printf("{\"traceEvents\": [\n");
+    for (size_t i = 0; i < spans.size(); i++) {
+        const ViewSpan& s = spans[i];
+
+        if (s.us < 0)
+            continue;
+        printf("%s  {\"name\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": 1, "
+               "\"args\": {\"begin\": %u, \"end\": %u}}", first ? "" : ",\n", view_name(s.point), s.start_us, s.us,
+               s.begin_arg, s.end_arg);
+        first = false;
+    }
+    for (size_t i = 0; i < events.size(); i++) {
+        const ViewEvent&    e = events[i];
+
+        if (e.kind != TRACE_KIND_MARK)
+            continue;
+        printf("%s  {\"name\": \"%s\", \"ph\": \"i\", \"s\": \"t\", \"ts\": %.3f, \"pid\": 1, \"tid\": 1, "
+               "\"args\": {\"arg\": %u}}", first ? "" : ",\n", view_name(e.point), e.us, e.arg);
+        first = false;
+    }
+    printf("\n]}\n");
+}
+
+int main(int argc, char* argv[])
+{
+    int                 which = -1;
+    double              hz = 96000000;
+    char                format = 0;
+    int                 i;
+    TelemetryDecoder    decoder;
+    uint8_t             buf[256];
+    size_t              n;
+
+    for (i = 1; i < argc && argv[i][0] == '-' && argv[i][1] != 0; i++) {
+        if (strcmp(argv[i], "-f") == 0 || strcmp(argv[i], "-c") == 0)
+            format = argv[i][1];
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+            which = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-h") == 0 && i + 1 < argc)
+            hz = atof(argv[++i]);
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    FILE*   in = stdin;
+
+    if (i < argc && (in = fopen(argv[i], "rb")) == NULL) {
+        perror(argv[i]);
+        return 1;
+    }
+
+    decoder.onRecord(view_record, NULL);
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0)
+        decoder.feed(buf, n);
+
+    if (view_dumps.empty()) {
+        fprintf(stderr, "no trace dump in the capture\n");
+        return 1;
+    }
+    if (which < 0)
+        which = (int)view_dumps.size() - 1;
+    if (which >= (int)view_dumps.size()) {
+        fprintf(stderr, "the capture has %u dumps\n", (unsigned)view_dumps.size());
+        return 1;
+    }
+
+    const RawDump&  dump = view_dumps[which];
+
+    // the mark says how many events follow, frames lost on the way show as missing events
+    if (dump.size() - 1 != dump[0].arg)
+        fprintf(stderr, "dump %d: %u of %u events received\n", which, (unsigned)dump.size() - 1, dump[0].arg);
+
+    std::vector<ViewEvent>  events = view_unwrap(dump, hz);
+    std::vector<ViewSpan>   spans = view_spans(events);
+
+    if (format == 'f')
+        view_folded(spans);
+    else if (format == 'c')
+        view_chrome(events, spans);
+    else
+        view_summary(events, spans);
+    return 0;
+}
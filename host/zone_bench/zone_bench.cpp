@@ -0,0 +1,125 @@
+/*
+Measures the cost of one control tick (ZoneTable::evaluate()) as the number
+of zones grows from 1 to 256, and the same rules over an array of per-zone
+structs for comparison.
+
+Build:
+    g++ -O2 -I../../Zones -o zone_bench zone_bench.cpp
+
+Use:
+    ./zone_bench [ticks per size]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ZoneTable.h"
+
+static const ZoneRules  rules = { 10000, true, 5700, 655 };
+
+// array-of-structs layout of the same state, as one object per room would give
+struct Zone
+{
+    int16_t     temp_centi;
+    uint16_t    water;
+    uint32_t    motion_ms;
+    int16_t     heat_on;
+    int16_t     cool_on;
+    int16_t     band;
+    bool        moved;
+    bool        lights;
+    bool        heater;
+    bool        aircon;
+    bool        fire;
+    bool        flood;
+    bool        lights_changed;
+    bool        heater_changed;
+    bool        aircon_changed;
+};
+
+static void evaluateAos(Zone* zones, uint32_t n, uint32_t now_ms, const ZoneRules& r)
+{
+    for (uint32_t z = 0; z < n; z++) {
+        Zone&   s = zones[z];
+        bool    light = r.lights && s.moved && (now_ms - s.motion_ms) < r.light_ms;
+        bool    heat = s.temp_centi < s.heat_on || (s.heater && s.temp_centi < s.heat_on + s.band);
+        bool    cool = s.temp_centi > s.cool_on || (s.aircon && s.temp_centi > s.cool_on - s.band);
+
+        s.lights_changed = light != s.lights;
+        s.heater_changed = heat != s.heater;
+        s.aircon_changed = cool != s.aircon;
+        s.lights = light;
+        s.heater = heat;
+        s.aircon = cool;
+        s.fire = s.temp_centi > r.fire_centi;
+        s.flood = s.water > r.water_level;
+    }
+}
+
+static double now_ns(void)
+{
+    timespec    ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+template <uint32_t N>
+static void bench(long ticks)
+{
+    static ZoneTable<N> table;
+    static Zone         aos[N];
+    volatile uint32_t   sink = 0;
+
+    for (uint32_t z = 0; z < N; z++) {
+        table.temp_centi[z] = aos[z].temp_centi = 2000 + rand() % 1000;
+        table.water[z] = aos[z].water = rand() % 1000;
+        table.heat_on[z] = aos[z].heat_on = 2400;
+        table.cool_on[z] = aos[z].cool_on = 2700;
+        table.band[z] = aos[z].band = 50;
+        if (rand() % 2) {
+            table.motion(z, rand() % 20000);
+            aos[z].motion_ms = table.motion_ms[z];
+            aos[z].moved = true;
+        }
+    }
+
+    double  start = now_ns();
+
+    for (long t = 0; t < ticks; t++) {
+        table.temp_centi[t % N] += (t & 1) ? 60 : -60;     // keep the hysteresis busy
+        table.evaluate((uint32_t)t, rules);
+        sink += table.lights_changed[0];
+    }
+
+    double  soa = (now_ns() - start) / ticks;
+
+    start = now_ns();
+    for (long t = 0; t < ticks; t++) {
+        aos[t % N].temp_centi += (t & 1) ? 60 : -60;
+        evaluateAos(aos, N, (uint32_t)t, rules);
+        sink += aos[0].lights_changed;
+    }
+
+    double  aosNs = (now_ns() - start) / ticks;
+
+    printf("%6u %12.1f %10.2f %12.1f %10.2f\n", N, soa, soa / N, aosNs, aosNs / N);
+}
+
+int main(int argc, char* argv[])
+{
+    long    ticks = argc > 1 ? atol(argv[1]) : 200000;
+
+    srand(1);
+    printf("%6s %12s %10s %12s %10s\n", "zones", "SoA ns/tick", "ns/zone", "AoS ns/tick", "ns/zone");
+    bench<1>(ticks);
+    bench<2>(ticks);
+    bench<4>(ticks);
+    bench<8>(ticks);
+    bench<16>(ticks);
+    bench<32>(ticks);
+    bench<64>(ticks);
+    bench<128>(ticks);
+    bench<256>(ticks);
+
+    return 0;
+}
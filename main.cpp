@@ -7,12 +7,29 @@ https://os.mbed.com/docs/mbed-os/v6.15/apis/timeout.html
 
 #include "mbed.h"
 #include "DS1820.h"
-#include "hcsr04.h"
+#include "EchoRanger.h"
+#include "WaterSampler.h"
 #include "Servo.h"
-#include <string> 
+#include "ServoMotion.h"
+#include "AlarmSequencer.h"
+#include "ClimateZone.h"
+#include "FireDetector.h"
+#include "OccupancyModel.h"
+#include "ZoneTable.h"
+#include "DeviceRegistry.h"
+#include "SafeState.h"
+#include "Telemetry.h"
+#include "PhoneLink.h"
+#include "Actuator.h"
+#include "HouseMode.h"
+#include "HomeState.h"
+#include "SeqLock.h"
+#include "TraceRing.h"
+#include "LoopMonitor.h"
+#include "OneWireHealth.h"
 
 /*
-Global modes of operation for the automated smart home.
+Global modes of operation for the automated smart home (see HouseMode.h).
 Mode 0: Normal Mode
 Mode 1: Eco Mode
 Mode 2: Security Mode
@@ -20,16 +37,43 @@ Mode 3: Fire Emergency Mode
 Mode 4: Flood Emergency Mode
 */
 
+/*
+State of the house. The control loop works on 'home' and publishes a copy
+at the end of every pass, reporters read consistent snapshots from
+'home_published' (see HomeState.h).
+*/
+HomeState home;
+SeqLock<HomeState> home_published;
+
+/*
+Pins, thresholds and polling periods are in HouseConfig.h, the drivers
+below are created from it and DeviceRegistry.h checks it when compiling.
+*/
+
+//Timer::read_ms() wraps after ~35 minutes, this keeps a longer millisecond clock
+Timer uptime_timer;
+uint32_t uptime_total_ms = 0;
+uint32_t uptime_counted_us = 0;
+
+uint32_t uptime(){
+    //The difference stays right when read_us() wraps, the part below 1 ms is kept for the next call
+    uint32_t elapsed_ms = ((uint32_t)uptime_timer.read_us() - uptime_counted_us) / 1000;
+    
+    uptime_counted_us += elapsed_ms * 1000;
+    uptime_total_ms += elapsed_ms;
+    return uptime_total_ms;
+}
+
 //For the automated garage door
-DigitalOut garage_opening_led(p25);
-DigitalOut garage_closing_led(p26);
-DigitalOut garage_door_led(p27);
-HCSR04 usensor(p29,p30);
-unsigned int ultrasonic_distance;
-int garage_mode;
+DigitalOut garage_opening_led(house_pin(DEV_GARAGE_OPENING));
+DigitalOut garage_closing_led(house_pin(DEV_GARAGE_CLOSING));
+DigitalOut garage_door_led(house_pin(DEV_GARAGE_DOOR));
+EchoRanger usensor(house_pin(DEV_RANGER_TRIGGER), house_pin(DEV_RANGER_ECHO), house_period_us(DEV_RANGER_TRIGGER)); //pings in the background
+volatile bool garage_obstructed = false;
 Timer garage_timer;
-int garage_inc;
-Servo garage_motor(p24);
+Servo garage_motor(house_pin(DEV_GARAGE_MOTOR));
+ServoMotion garage_motion(garage_motor, 350, 700); //full travel in ~3.3 s
+volatile bool garage_arrived = false;
 /*
 Mode 0: open
 Mode 1: closed
@@ -37,71 +81,127 @@ Mode 2: opening
 Mode 3: closing
 */
 
-//For the PIR Motion sensor
-DigitalOut house_lights(p19);
-DigitalIn pir(p5);
-Timer pir_timer;
+/*
+The house is split in zones, each with its own PIR and lights. Their state
+is kept in contiguous arrays (see ZoneTable.h) and the lighting rules run
+over all zones at once every loop pass. Only the lights are run from the
+table, the PI loops drive the climate and the fire and flood detectors
+watch the one temperature and water sensor. There is one zone per PIR in
+HouseConfig.h, the PIRs and lights of all zones are generated from it.
+*/
+ZoneTable<HOUSE_ZONES> zones;
+
+//For the PIR Motion sensors and the lights
+DeviceBank<DigitalIn, DEV_PIR> zone_pir;
+DeviceBank<DigitalOut, DEV_LIGHT> zone_lights;
+bool pir_last[HOUSE_ZONES];
+
+/*
+The motion is also learned per hour of the week (see OccupancyModel.h) so
+the climate control can get the house ready before people come home and
+idle while nobody is expected. The time of week comes from the RTC, set it
+once with set_time().
+*/
+OccupancyModel occupancy(HOUSE_ZONES);
 
 
 //For the Smart Temperature control
-DigitalOut heater_led(p7);
-DigitalOut aircon_led(p8);
-DS1820 ds1820(p6); // mbed pin name connected to module
+DigitalOut heater_led(house_pin(DEV_HEATER));
+DigitalOut aircon_led(house_pin(DEV_AIRCON));
+DS1820 ds1820(house_pin(DEV_TEMPERATURE)); // mbed pin name connected to module
+
+//Retries, backoff and quarantine of the DS1820 transactions with their error counters (see OneWireHealth.h)
+OneWireHealth onewire_health;
+#define TEMP_SENSOR 0   //the DS1820 is device 0 of its bus
+bool temp_quarantined = false;
+
+//Fire detection on the temperature readings, absolute and rate of rise (see FireDetector.h)
+FireDetector fire_detector(HOUSE_ZONES);
 Serial pc(USBTX, USBRX);
 
-//Temp timer is for triggering the smart heating logic
-Timer temp_timer;
+//All status goes to the pc as binary telemetry frames (see TelemetryProtocol.h)
+Telemetry telemetry(pc);
+Timer telemetry_timer;
 
-//heating_timer is for the heat or aircon to stay on for 300 seconds
-Timer heating_timer;
+//Schedules the DS1820 conversions and readings, a reading before the conversion is done gives the 85 C power-up value
+Poll<DEV_TEMPERATURE> temp_poll;
+uint32_t temp_started_ms = 0;
+uint8_t temp_convert_result = OW_OK;
 
-float temp = 0;
-int result = 0;
-bool temp_conversion = false;
+/*
+Climate control: a PI loop each for the heater and the aircon, turned into
+on/off times by the zone so neither switches more often than every 5 minutes
+(see ClimateZone.h). The gains were tuned with host/climate_sim.
+*/
+#define HEAT_COMFORT    (HEATER_TEMP + 25)
+#define COOL_COMFORT    (AIRCON_TEMP - 25)
+const PidGains climate_gains = { PID_GAIN(20.0), PID_GAIN(0.02), PID_GAIN(0.0) };
+PidController heat_control(HEAT_COMFORT, climate_gains, 0, CLIMATE_FULL_DEMAND);
+PidController cool_control(COOL_COMFORT, climate_gains, -CLIMATE_FULL_DEMAND, 0);
+ClimateZone climate(heat_control, cool_control);
+uint32_t climate_read_ms = 0;
 
-//For the buzzer alarm
-PwmOut buzzer(p22);
-float freq[]= {659,440,659,440,659,440,659,440,659,440,659,440};
-Timer alarm_timer;
-bool alarm_trigger;
-int alarm_iterator;
+//For the buzzer alarm, the melodies are played from an interrupt (see AlarmPatterns.h)
+PwmOut buzzer(house_pin(DEV_BUZZER));
+AlarmSequencer alarm_sound(buzzer);
+const char alarm_types[ALARM_COUNT] = { 'S', 'X', 'F' };   //alarm_type of each melody, in AlarmPattern order
 
-//For water sensor
-AnalogIn w_sensor(p20);
-float water_value;
-Timer flood_timer;
+//For water sensor, sampled at 1 kHz and filtered in the background
+WaterSampler w_sensor(house_pin(DEV_WATER), WATER_DETECTED, WATER_DETECTED / 2);
 
 // For Phone App
-Serial device(p9, p10);
-char app_out;
-char app_in;
-char alarm_type;
+RawSerial device(house_pin(DEV_PHONE_TX), house_pin(DEV_PHONE_RX));
+PhoneLink phone_link(device);
 /* 
 Alarm types:
 F for fire
 X for flood
+S for security
 */
 
-// Different modes our system operates in such as "security", "eco" and "fire"
-string system_mode;
-
 // Door controls
-DigitalOut doorlock(p12);
-
-void door_lock(){doorlock = 1;}
-void door_unlock(){doorlock = 0;}
+DigitalOut doorlock(house_pin(DEV_DOORLOCK));
 
 // Controls the servo motor to open the window
-Servo window_motor(p21);
-int window_position;
-string mode;
+Servo window_motor(house_pin(DEV_WINDOW));
+ServoMotion window_motion(window_motor, 500, 1000, MOTION_SCURVE);
+
+/*
+The actuator fields of 'home' are the desired state. The control functions
+only change these values, apply_outputs() writes them to the hardware once
+per loop pass and only the ones that changed. The servos are moved by their
+motion profiles (see ServoMotion.h), apply_outputs() only gives them the target.
+*/
+
+ActuatorBank<DigitalOut, DEV_LIGHT> zone_lights_out(zone_lights);
+Actuator<DigitalOut> doorlock_out(doorlock);
+Actuator<DigitalOut> heater_out(heater_led);
+Actuator<DigitalOut> aircon_out(aircon_led);
+Actuator<DigitalOut> garage_opening_out(garage_opening_led);
+Actuator<DigitalOut> garage_closing_out(garage_closing_led);
+Actuator<DigitalOut> garage_door_out(garage_door_led);
+
+void apply_outputs(){
+    for(unsigned z = 0; z < HOUSE_ZONES; z++)
+        zone_lights_out[z].write(zones.lights[z]);
+    doorlock_out.write(home.doorlock);
+    heater_out.write(home.heater);
+    aircon_out.write(home.aircon);
+    window_motion.moveTo(home.window * 10);
+    garage_opening_out.write(home.garage_opening);
+    garage_closing_out.write(home.garage_closing);
+    garage_door_out.write(home.garage_door);
+}
+
+void door_lock(){home.doorlock = 1;}
+void door_unlock(){home.doorlock = 0;}
  
 void window_open(){
-    window_motor = 100.0;
+    home.window = 100;
 }
 
 void window_close(){
-    window_motor = 0.0;
+    home.window = 0;
 }
 
 /*
@@ -109,37 +209,98 @@ Alarm function:
  Triggers an alarm. Any system that has an alarm uses this alarm
 */
 void alarm(){
-    //The alarm starts at 50% duty cycle so this silences it
-    if(!alarm_trigger){
-        buzzer.period(0);
+    if(!home.alarm_trigger){
+        alarm_sound.silence();
+        home.alarm_iterator = 0;
+        return;
     }
     
     /*
-    This flags if the alarm is triggered and then makes a noise every .5 seconds
-    and iterates throught the freq[] array for different sounds
+    Each alarm type has its own melody, only the one of the current alarm type
+    sounds. The others are cleared when the type changes, a fire alarm must not
+    keep sounding over the flood that followed it. Raising the same alarm again
+    does not restart it, it is raised before the others are cleared so the
+    buzzer does not go quiet in between.
     */
-    if(alarm_trigger && (alarm_timer.read() > 0.5) && (alarm_iterator < 12)){
-        buzzer.period(1/(2*freq[alarm_iterator]));
-        alarm_iterator++;
-        alarm_timer.reset(); 
-        pc.printf("intruder");
-        system_mode = "resting";
+    for(int p = 0; p < ALARM_COUNT; p++){
+        if(alarm_types[p] == home.alarm_type)
+            alarm_sound.raise((AlarmPattern)p);
     }
-    else
-        alarm_iterator = 0;
+    for(int p = 0; p < ALARM_COUNT; p++){
+        if(alarm_types[p] != home.alarm_type)
+            alarm_sound.clear((AlarmPattern)p);
+    }
+    home.alarm_iterator = alarm_sound.step();
 }
 
 /*
-House lights
+House lights, they come back on with the next motion
 */
-void house_lighting_on(){
-    house_lights = 1;
+void house_lighting_off(){
+    zones.clearMotion();
+    home.house_lights = 0;
 }
 
-void house_lighting_off(){
-    house_lights = 0;
+/*
+House modes:
+ The transitions between the modes are in HOUSE_MODE_TABLE (HouseMode.h),
+ these are the actions run when a mode is entered or left and the guards
+ checked before an emergency mode can be left.
+*/
+void eco_enter(){
+    window_open();
+    house_lighting_off();
+    home.heater = 0;
+    home.aircon = 0;
+}
+
+void eco_exit(){
+    window_close();
+}
+
+void security_enter(){
+    house_lighting_off();
+    window_close();
+    door_lock();
+}
+
+void security_exit(){
+    door_unlock();
+    home.alarm_trigger = false;
+    home.alarm_type = '9';
+}
+
+void fire_enter(){
+    home.alarm_trigger = true;
+    home.alarm_type = 'F';
+    door_unlock();
+}
+
+void flood_enter(){
+    home.alarm_trigger = true;
+    home.alarm_type = 'X';
+}
+
+void emergency_exit(){
+    home.alarm_trigger = false;
+    home.alarm_type = '9';
 }
 
+bool fire_cleared(){
+    return !fire_detector.fire() && (home.temp_centi <= FIRE_TEMP);
+}
+
+bool water_cleared(){
+    return !w_sensor.flooded();
+}
+
+const ModeActions mode_actions = {
+    { NULL, eco_enter, security_enter, fire_enter, flood_enter },          // enter
+    { NULL, eco_exit, security_exit, emergency_exit, emergency_exit },     // exit
+    { NULL, fire_cleared, water_cleared }                                  // guards
+};
+ModeMachine house_mode(mode_actions);
+
 /*
 Motion sensing function: 
  If motion is detected it turns on the lights. If the house is in security mode
@@ -150,21 +311,54 @@ void pir_sensor(){
     If the PIR detects motion it turns on the lights for 10 seconds every time 
     it detects motion. 10 seconds without motion turns the lights off
     */
-    if(pir && garage_mode == 3){
-        garage_mode = 2;
-    }
-    if (pir && (system_mode != "eco_mode")){
-        house_lighting_on();
-        pir_timer.reset();
-        //pc.printf("PIR sensor works \r\n");
-        if(system_mode == "security_mode"){
-            alarm_trigger = true;
-            alarm_type = 'S';   
+    uint32_t now = uptime();
+    bool motion = false;
+    
+    for(unsigned z = 0; z < HOUSE_ZONES; z++){
+        bool moving = zone_pir[z];
+        
+        if(moving){
+            zones.motion(z, now);
+            motion = true;
         }
-     }
-     else if(pir_timer.read() > 10 || (system_mode == "eco_mode"))
-        house_lighting_off();
-            
+        if(moving != pir_last[z])
+            TRACE_MARK(TP_PIR, (z << 8) | moving);
+        if(moving && !pir_last[z])
+            occupancy.motion(z, time(NULL));
+        pir_last[z] = moving;
+    }
+    
+    //pc.printf("PIR sensor works \r\n");
+    if(motion && home.garage_mode == 3){
+        home.garage_mode = 2;
+    }
+    if(motion && (house_mode.mode() == MODE_SECURITY)){
+        home.alarm_trigger = true;
+        home.alarm_type = 'S';   
+    }
+    
+    //Lights in every zone, none in eco mode
+    ZoneRules rules = { LIGHT_MS, house_mode.mode() != MODE_ECO, FIRE_ABSOLUTE, WATER_DETECTED };
+    zones.evaluateLights(now, rules);
+    home.house_lights = ZoneTable<HOUSE_ZONES>::any(zones.lights);
+}
+
+/*
+Comfort setpoints while someone is home or expected within the hour,
+setback setpoints that leave the heater and aircon idle otherwise
+*/
+void climate_setpoints(){
+    uint32_t now_s = time(NULL);
+    
+    occupancy.tick(now_s);
+    if(occupancy.recent(now_s, RECENT_MOTION_S) || !occupancy.expectedEmpty(now_s, PRECONDITION_S)){
+        heat_control.setSetpoint(HEAT_COMFORT);
+        cool_control.setSetpoint(COOL_COMFORT);
+    }
+    else{
+        heat_control.setSetpoint(HEATER_TEMP - SETBACK_TEMP);
+        cool_control.setSetpoint(AIRCON_TEMP + SETBACK_TEMP);
+    }
 }
 
 /*
@@ -173,56 +367,65 @@ Smart Heating function:
  it will also sound an alarm if motion is detected.
 */
 void smart_heating(){ 
-    /* 
-    This detects a fire. Right now it is set to detect a fire at 33 celsius 
-    for testing purposes 
-    */    
-    if(temp > 30){
-        alarm_trigger = true;
-        alarm_type = 'F';
-        door_unlock();
-    }
+    /*
+    The next two ifs are to start gathering and reading the heat data from the ds1820.
+    A conversion takes 750 ms, reading every 2 seconds lets the fire detector
+    see how fast the temperature rises
+    */
+    uint32_t now = uptime();
     
-    //The next two else ifs are to start gathering and reading the heat data from the ds1820
-    else if(temp_timer > 7 && !temp_conversion){
-        ds1820.startConversion();
-        temp_conversion = true;
+    if(!home.temp_conversion && temp_poll.ahead(now, DS1820_CONVERSION_US / 1000)){
+        temp_convert_result = onewire_health.startConversion(ds1820, TEMP_SENSOR, now);
+        home.temp_conversion = true;
+        temp_started_ms = now;
     }
-    else if(temp_timer > 10 && temp_conversion){
-        result = ds1820.read(temp); // read temperature
-        switch (result) {
-            case 0: // no errors
-                pc.printf("Temperature= %3.1f C\r\n", temp);  
-                break;
-            case 1: // no sensor present
-                pc.printf("No sensor present\n\r");
-            break;
-            case 2: // CRC error -> 'temp' is not updated
-                pc.printf("CRC error\r\n");
-        }
-        temp_conversion = false;
-        temp_timer.reset();
-        
-        /*
-        This checks the heater every (supposed to be 300 seconds) 20 seconds
-        and turns on the heater if its too cold or the aircon if it is too hot
-        to reach the desired temperature range
-        */
-        
-        if(system_mode == "eco_mode"){
-            aircon_led = 0;
-            heater_led = 0;    
+    else if(home.temp_conversion && (now - temp_started_ms >= DS1820_CONVERSION_US / 1000) && temp_poll.due(now)){
+        float temp;
+        //Without a conversion the sensor gives the last one again, or 85 C after it lost power
+        uint8_t result = temp_convert_result;
+        if(result == OW_OK)
+            result = onewire_health.read(ds1820, TEMP_SENSOR, temp, now);
+        //1: no presence pulse, 2: CRC error, 3: quarantined -> 'temp' is not updated
+        if(result == OW_OK){
+            home.temp_centi = (int16_t)(temp * HOME_TEMP_SCALE);
+            climate_setpoints();
+            
+            //The controllers only run on fresh readings, a failed read keeps the last demand
+            climate.update(home.temp_centi, now - climate_read_ms);
+            climate_read_ms = now;
+            
+            //A hot afternoon rises a few degrees per hour, a fire several per minute
+            fire_detector.add(house_zone(DEV_TEMPERATURE), home.temp_centi, now);
+            if(fire_detector.fire())
+                house_mode.dispatch(EV_FIRE);
         }
-        else if(heating_timer.read() > 20){
-            if(temp > 27)
-                aircon_led = 1;
-            else if(temp < 27)
-                aircon_led = 0;
-            if(temp < 24)
-                heater_led = 1;
-            else if(temp > 24)
-                heater_led = 0;   
-        }  
+        else if(result != OW_QUARANTINED)
+            telemetry.fault(TLM_DEV_DS1820, result);
+        home.temp_conversion = false;
+    }
+    
+    /*
+    The fire detector has no readings while its only sensor is in quarantine,
+    so the start and the end of it are faults. It lasts at most
+    TEMP_QUARANTINE_MAX_MS.
+    */
+    if(onewire_health.quarantined(TEMP_SENSOR) != temp_quarantined){
+        temp_quarantined = !temp_quarantined;
+        telemetry.fault(TLM_DEV_DS1820, temp_quarantined ? TLM_FAULT_QUARANTINED : TLM_FAULT_RELEASED);
+    }
+    
+    /*
+    The heater and aircon follow the duty cycle of the zone, which keeps the
+    temperature between HEATER_TEMP and AIRCON_TEMP without short cycling
+    */
+    if(house_mode.mode() == MODE_ECO){
+        climate.reset();
+        home.aircon = 0;
+        home.heater = 0;    
+    }
+    else{
+        home.heater = climate.heating(now);
+        home.aircon = climate.cooling(now);
     }
 }
 
@@ -231,71 +434,103 @@ Flood Detecting function:
  If water is detected it will sound an alarm
 */
 void flood_detector(){
-    if(flood_timer > 20){
-        water_value = w_sensor;
-        flood_timer.reset(); 
-    }
-
+    home.water = w_sensor.level();
     
-    if(water_value > 0.01){
+    //The sampler only reports a flood once the water stayed for ~130 ms, spikes are ignored
+    if(w_sensor.flooded()){
         //pc.printf("FLOOD ALARM \r\n FLOOD ALARM \r\n FLOOD ALARM");  
-        alarm_trigger = true;
-        alarm_type = 'X';        
+        house_mode.dispatch(EV_FLOOD);
     }
         
         
 }
 
-Timer ultrasonic_timer;
-void garage_door_opener(){
-    if(ultrasonic_timer == 1){
-            ultrasonic_distance = usensor.get_dist_cm();
-            ultrasonic_timer.reset();
-    }
-    //if((ultrasonic_distance < 10) && (garage_mode == 3))
-        //garage_mode = 2; //switches mode to opening
+/*
+Called from the ultrasonic sensor interrupt when something comes closer than
+10 cm to the garage door or goes away again
+*/
+void garage_obstacle(bool present){
+    garage_obstructed = present;
     
     /*
-    Opening: 
-    Checks if mode is in opening mode.
-    Checks timer so it can increment every 0.1 seconds
-    Checks garage inc to simulate the servo motor going in increments of 1
+    Closing onto the obstacle, stop dead and re-open straight away instead of
+    waiting for the loop. Braking would keep the door closing for another half
+    a second.
     */
-    if((garage_mode == 2) && (garage_timer > 0.1) && (garage_inc > 2)){
-        
-        garage_inc = garage_inc -3;
-        garage_opening_led = !garage_opening_led;
-        garage_closing_led = 0;
-        garage_timer.reset();
-    }   
+    if(present && garage_motion.moving() && (garage_motion.target() == MOTION_FULL_SCALE)){
+        garage_motion.halt();
+        garage_motion.moveTo(0);
+    }
+}
+
+/*
+Called from the motion ticker when the garage door reached its target, the
+loop reads the position from the motion itself
+*/
+void garage_door_arrived(int32_t){
+    garage_arrived = true;
+}
+
+void garage_door_opener(){
+    home.distance_cm = usensor.distance_cm();
+    
+    //Never keep closing onto an obstacle, the flag is set by the sensor interrupt
+    if(garage_obstructed && (home.garage_mode == 3))
+        home.garage_mode = 2; //switches mode to opening
+    
     /*
-    Closing: 
-    Checks if mode is in opening mode.
-    Checks timer so it can increment every 0.1 seconds
-    Checks garage inc to simulate the servo motor going in increments of 1
-    */ 
-    else if((garage_mode == 3) && (garage_timer > 0.1) && (garage_inc < 97)){
-        garage_inc = garage_inc + 3;
-        garage_opening_led = 0;
-        garage_closing_led = !garage_closing_led;
+    Opening and closing:
+    The motion profile moves the servo from a ticker, so this only hands it
+    the target for the mode. Asking again for the same target does nothing.
+    */
+    if(home.garage_mode == 2)
+        garage_motion.moveTo(0);
+    else if(home.garage_mode == 3){
+        /*
+        The obstacle interrupt may have re-opened the door since the check
+        above, its request must not be overwritten by this one.
+        */
+        __disable_irq();
+        if(!garage_obstructed)
+            garage_motion.moveTo(MOTION_FULL_SCALE);
+        __enable_irq();
+    }
+    
+    home.garage_pos = garage_motion.position() / 10;
+    
+    //Blinks the opening or closing led every 0.1 seconds while the door moves
+    if(garage_motion.moving() && (garage_timer > 0.1)){
+        if(garage_motion.target() == 0){
+            home.garage_opening = !home.garage_opening;
+            home.garage_closing = 0;
+        }
+        else{
+            home.garage_opening = 0;
+            home.garage_closing = !home.garage_closing;
+        }
         garage_timer.reset();
-    } 
+    }
+    
+    //The door only changes to open or closed once the motion has finished
+    if(garage_arrived){
+        garage_arrived = false;
+        home.garage_opening = 0;
+        home.garage_closing = 0;
+    }
+    if(garage_motion.moving())
+        return;
     
     //This led just shows if the door is open or closed
-    if(garage_inc <= 2){
-        garage_door_led = 1;
-        garage_mode = 1;
+    if(home.garage_pos <= 2){
+        home.garage_door = 1;
+        home.garage_mode = 1;
         }
-    else if(garage_inc >= 98){
-        garage_door_led = 0;
-        garage_mode = 0;
+    else if(home.garage_pos >= 98){
+        home.garage_door = 0;
+        home.garage_mode = 0;
         }
     else
-        garage_door_led = 0;
-    
-    garage_motor = (float) garage_inc/100; 
-    pc.printf("garage motor = %i, Distance = %ld cm, Temperature= %3.1f C\r\n" 
-        ,garage_inc, ultrasonic_distance, temp);
+        home.garage_door = 0;
 }
 
 /*
@@ -303,150 +538,361 @@ void garage_door_opener(){
 */
 Timer phone_timer;
 
-void phone_app() {
-    if (device.readable()) {
-        app_out = device.getc();
-        device.putc(app_in);
-        pc.printf("app signal = %c, app input signal = %c water value = %f\n\r, system mode = " ,app_out, app_in, water_value);
-    }
-    switch (app_out){
+/*
+Runs a single command received from the app. Each command runs once when it
+arrives and only changes the desired state, so sending the same command again
+does not change anything.
+*/
+void handle_command(char command){
+    switch (command){
     case '0': // Open Garage
-        if(garage_inc >= 100)
-            garage_inc--;
-        garage_mode = 2;
+        home.garage_mode = 2;
         break; // Close Garage
     case '1':
-        garage_inc++;
-        garage_mode = 3;
+        home.garage_mode = 3;
         break;
     case '2': // Eco Mode On
-        window_open();
-        house_lighting_off();
-        system_mode = "eco_mode";
-        pc.printf("eco mode activated \r\n");
+        house_mode.dispatch(EV_ECO_ON);
         break; 
     case '3': // Lock door 
             door_lock();
         break;
     case '4': // Eco Mode Off
-        window_close();
-        system_mode = "resting";
-        pc.printf("eco mode deactivated \r\n");
+        house_mode.dispatch(EV_ECO_OFF);
         break;
     case '5': // Unlock door
         door_unlock();
         break;
     case '6': // Security Mode On
-        system_mode = "security_mode";
-        house_lighting_off();
-        window_close();
-        door_lock();
-        pc.printf("Security Activated \r\n");
+        house_mode.dispatch(EV_SECURITY_ON);
         break;
-    case '7': // Security Mode Off
-        system_mode = "resting";
-        door_unlock();
-        pc.printf("Security Deactivated \r\n");
-        alarm_trigger = false;
+    case '7': // Security Mode Off, also silences a fire or flood alarm once it is over
+        house_mode.dispatch(EV_SECURITY_OFF);
         break;
     }
-    switch (alarm_type)
+}
+
+void phone_app() {
+    /*
+    Commands arrive in frames (see PhoneProtocol.h), a frame can carry a batch
+    of them. They are queued by the serial interrupt and acked by the link.
+    */
+    char command;
+    
+    phone_link.poll();
+    while (phone_link.nextCommand(command)) {
+        home.app_out = command;
+        handle_command(command);
+    }
+    
+    /*
+    Alarms are pushed to the phone as alerts which the link resends until the
+    phone acks them. While the alarm stays on the alert is raised again every
+    60 seconds (every 2 seconds for a flood).
+    */
+    switch (home.alarm_type)
     {
     case 'F': //Fire
-        if(phone_timer > 60){
+        if(home.app_in != 'F' || phone_timer > 60){
             phone_timer.reset();
-            app_in = 'F';
-            pc.printf("Fire detected \r\n");
+            home.app_in = 'F';
+            phone_link.alert('F', PHONE_PRIORITY_URGENT);
             }
-        else if(phone_timer > 1)
-            app_in = 'O';
         break;
     case 'X': // flood
-        if(phone_timer > 2){
+        if(home.app_in != 'X' || phone_timer > 2){
             phone_timer.reset();
-            app_in = 'X';
-            pc.printf("Flood detected \r\n");
+            home.app_in = 'X';
+            phone_link.alert('X', PHONE_PRIORITY_URGENT);
             }
-        else if(phone_timer > 1)
-            app_in = 'O';
         break;
-    case 'S': // flood
-        if(phone_timer > 60){
+    case 'S': // security
+        if(home.app_in != 'S' || phone_timer > 60){
             phone_timer.reset();
-            app_in = 'S';
-            pc.printf("security detected \r\n");
+            home.app_in = 'S';
+            phone_link.alert('S', PHONE_PRIORITY_NORMAL);
             }
-        else if(phone_timer > 1)
-            app_in = 'O';
         break;
     default: //default
-        app_in = 'O';
+        home.app_in = 'O';
     }
+    phone_link.setStatus(home.app_in);
+}
+
+/*
+Publishes the state of this loop pass for the reporters
+*/
+void publish_state(){
+    home.mode = house_mode.mode();
+    home_published.write(home);
+}
+
+/*
+Status reporting:
+ Sends the state of the house to the pc. Only what changed since the last
+ report goes out, so this can run a lot more often than the old printf lines.
+*/
+void report_status(){
+    if(telemetry_timer.read() < 0.25)
+        return;
+    telemetry_timer.reset();
+
+    HomeState snapshot;
+    home_published.read(snapshot);
+
+    TelemetrySample sample;
+    sample.temp_centi = snapshot.temp_centi;
+    sample.water = snapshot.water;
+    sample.distance_cm = snapshot.distance_cm;
+    sample.garage_pos = snapshot.garage_pos;
+    sample.garage_mode = snapshot.garage_mode;
+    sample.mode = snapshot.mode;
+    sample.alarm_type = snapshot.alarm_type;
+    sample.alarm_active = snapshot.alarm_trigger;
+    sample.app_out = snapshot.app_out;
+    sample.app_in = snapshot.app_in;
+    sample.actuator_writes = ActuatorCounters::totalWrites();
+    sample.actuator_suppressed = ActuatorCounters::totalSuppressed();
+    telemetry.update(sample);
+}
+
+#if HOUSE_TRACE
+/*
+Trace dump:
+ A 'T' from the pc reads out the trace ring (see TraceRing.h). The events go
+ out a frame per loop pass, so the house keeps running during the dump.
+*/
+volatile bool trace_requested = false;
+
+void trace_command(){
+    while(pc.readable())
+        if(pc.getc() == 'T')
+            trace_requested = true;
+}
+
+void trace_dump(){
+    TraceEvent events[TELEMETRY_TRACE_EVENTS];
+    uint8_t count = 0;
     
+    if(trace_requested){
+        trace_requested = false;
+        trace_ring.dump();
+    }
+    while(count < TELEMETRY_TRACE_EVENTS && trace_ring.next(events[count]))
+        count++;
+    if(count > 0)
+        telemetry.trace(events, count);
 }
+#endif
 
-int main() {
-    pir_timer.start();
-    temp_timer.start();
-    alarm_timer.start();
-    heating_timer.start();
+/*
+Loop deadlines:
+ Each subsystem of the loop has a time budget (HouseConfig.h). The monitor
+ counts the passes over it, resets the board when a subsystem hangs and
+ keeps its counters over the reset (see LoopMonitor.h). The task numbers in
+ the telemetry are the index in this table.
+*/
+const LoopTask loop_tasks[] = {
+    { pir_sensor,           PIR_BUDGET_US       },
+    { smart_heating,        HEATING_BUDGET_US   },
+    { alarm,                ALARM_BUDGET_US     },
+    { flood_detector,       FLOOD_BUDGET_US     },
+    { garage_door_opener,   GARAGE_BUDGET_US    },
+    { phone_app,            PHONE_BUDGET_US     },
+    { apply_outputs,        OUTPUTS_BUDGET_US   },
+    { publish_state,        PUBLISH_BUDGET_US   },
+    { report_status,        REPORT_BUDGET_US    }
+};
+LoopMonitor loop_monitor(loop_tasks, sizeof(loop_tasks) / sizeof(LoopTask));
+Timer loop_report_timer;
+
+//Sends the counters of the subsystems that went over their budget, at most once a second
+void report_loop(){
+    const LoopRecord& record = loop_monitor.record();
+    uint8_t task;
+    
+    if(loop_report_timer.read() < 1)
+        return;
+    loop_report_timer.reset();
+    
+    while(loop_monitor.nextOverrun(task))
+        telemetry.loop(record.cause, record.stalled, record.resets, task, record.overruns[task], record.worst_us[task]);
+}
+
+//Sends the error counters of the 1-Wire devices that changed
+void report_onewire(){
+    uint8_t device;
+    
+    while(onewire_health.nextChanged(device)){
+        const OneWireStats& stats = onewire_health.device(device);
+        telemetry.oneWire(device, onewire_health.quarantined(device), stats.presence_failures, stats.crc_errors,
+                          stats.retries, stats.quarantines, stats.skipped);
+    }
+}
+
+/*
+Safe state:
+ When the house floods the board shuts everything down in this order and
+ sleeps, waking every second to check the water and every 10 seconds to
+ send the flood alert and its telemetry. It comes back by itself once the
+ water is gone.
+*/
+void safe_silence(){
+    alarm_sound.silence();
+}
+
+void safe_park_servos(){
+    garage_motion.stop();   //the servos hold their position
+    window_motion.stop();
+}
+
+void safe_outputs_off(){
+    climate.reset();
+    home.heater = 0;
+    home.aircon = 0;
+    home.doorlock = 0;      //nobody gets locked in
+    house_lighting_off();
+    apply_outputs();
+}
+
+void safe_sensors_off(){
+    usensor.stop();
+    w_sensor.stop();        //sampled on the wakeups instead
+}
+
+const SafeStep safe_shutdown[] = { safe_silence, safe_park_servos, safe_outputs_off, safe_sensors_off };
+SafeState safe_state(safe_shutdown, sizeof(safe_shutdown) / sizeof(SafeStep));
+
+void safe_report(){
+    uint32_t latency = phone_link.lastAlertLatency_ms();
+    uint32_t wake = safe_state.wake_us();
+    uint32_t longest = safe_state.maxWake_us();
+    
+    telemetry.safeState(safe_state.active(), wake > 0xFFFF ? 0xFFFF : wake, longest > 0xFFFF ? 0xFFFF : longest,
+                        latency > 0xFFFF ? 0xFFFF : latency, safe_state.wakeups(), safe_state.interrupts());
+}
+
+void safe_wake(){
+    char command;
+    
+    loop_monitor.feed();    //the loop does not run in the safe state
+    home.water = w_sensor.burst();
+    phone_link.poll();
+    while (phone_link.nextCommand(command))
+        home.app_out = command;     //acked by the link, nothing moves in the safe state
+    
+    if(safe_state.wakeups() % SAFE_BEACON_WAKEUPS == 1){
+        phone_link.alert('X', PHONE_PRIORITY_URGENT);
+        safe_report();
+    }
+}
+
+bool safe_flooded(){
+    return w_sensor.flooded();
+}
+
+void safe_restore(){
+    w_sensor.start();
+    usensor.start();
+    garage_motion.start(garage_motion.position());
+    window_motion.start(window_motion.position());
+    house_mode.dispatch(EV_SECURITY_OFF);   //leaves MODE_FLOOD, the water is gone
+    safe_report();
+}
+
+/*
+Starts the drivers and puts the house in its initial state, main() and the
+host benchmarks (host/loop_bench) run the same start up. Returns false when
+there is no temperature sensor, the watchdog is not armed then: nothing
+would feed it after main() returned and the board would reset forever.
+*/
+bool house_start(){
+    uptime_timer.start();
     garage_timer.start();
-    flood_timer.start();
+    w_sensor.start();
     phone_timer.start();
-    ultrasonic_timer.start();
+    telemetry_timer.start();
+    phone_link.start();
+    safe_state.onWake(safe_wake);
+    safe_state.onHazard(safe_flooded);
+    usensor.onObstacle(garage_obstacle, GARAGE_OBSTACLE_CM);
+    garage_motion.onComplete(garage_door_arrived);
+    garage_motion.start(MOTION_FULL_SCALE);
+    window_motion.start(0);
     usensor.start();
-    window_position = 0.0;
-    doorlock = 1;
+#if HOUSE_TRACE
+    pc.attach(&trace_command);
+#endif
+    home.window = 0;
+    home.doorlock = 1;
+    apply_outputs();
     
-    system_mode = "resting";
-    alarm_trigger = false;
-    alarm_iterator = 0;
-    pc.printf("\r\n--Starting--\r\n");
+    home.alarm_trigger = false;
+    home.alarm_iterator = 0;
+    telemetry.boot();
     /*
     This might be the only wait statement in the code.
     I am thinking that we might do a 60 second wait for bootup
     for the final implementation
     */
     wait(2); // Wait for sensor to take snap shot of still room 
-    house_lights = 0;
-    heater_led = 0;
-    aircon_led = 0;
-    ultrasonic_distance = 0;
-    garage_mode = 1; //Garage door starts closed
-    buzzer = 0.5;
-    garage_opening_led = 0;
-    garage_closing_led = 0;
-    garage_door_led = 0;
-    garage_inc = 100;
-    alarm_type = '9';
-    Timer exit_timer;
+    home.house_lights = 0;
+    home.heater = 0;
+    home.aircon = 0;
+    home.distance_cm = 0;
+    home.garage_mode = 1; //Garage door starts closed
+    home.garage_opening = 0;
+    home.garage_closing = 0;
+    home.garage_door = 0;
+    home.garage_pos = 100;
+    home.alarm_type = '9';
     
-    if (ds1820.begin()){
-        while(1) {
-            pir_sensor();
-            smart_heating();
-            alarm();
-            flood_detector();
-            garage_door_opener();
-            phone_app();
-            
-            /*
-            If the house floods we want the system to power down, the exit will
-             turn off the mbed and connecting systems
-            */
-            if(alarm_type == 'X' && (exit_timer == 0)){
-                exit_timer.start();
-            }
-            else if(alarm_type == 'X' && (exit_timer >= 5)){
-                aircon_led = 0;
-                heater_led = 0;
-                doorlock = 0;
-                house_lighting_off();
-                exit(0);
-            }
-                
-        }
+    onewire_health.setMaxQuarantine(TEMP_SENSOR, TEMP_QUARANTINE_MAX_MS);
+    if(!ds1820.begin()){
+        telemetry.fault(TLM_DEV_DS1820, TLM_FAULT_NO_PRESENCE);
+        return false;
     }
-    else
-        pc.printf("No DS1820 sensor found!\r\n");
+    
+    //the subsystems are timed from here on, the start up waits are over
+    loop_monitor.start();
+    loop_report_timer.start();
+    const LoopRecord& record = loop_monitor.record();
+    telemetry.loop(record.cause, record.stalled, record.resets, LOOP_NO_TASK, 0, 0);
+    return true;
+}
+
+/*
+One pass of the control loop
+*/
+Timer exit_timer;
+
+void house_loop(){
+    loop_monitor.pass();    //the subsystems of loop_tasks, in order
+    report_loop();
+    report_onewire();
+#if HOUSE_TRACE
+    trace_dump();
+#endif
+    
+    /*
+    If the house floods we want the system to power down, the safe state
+     turns everything off and sleeps until the water is gone
+    */
+    if(house_mode.mode() == MODE_FLOOD && (exit_timer == 0)){
+        exit_timer.start();
+    }
+    else if(house_mode.mode() == MODE_FLOOD && (exit_timer >= FLOOD_SAFE_S)){
+        exit_timer.stop();
+        exit_timer.reset();
+        safe_state.run();
+        safe_restore();
+    }
+}
+
+int main() {
+    if(!house_start())
+        return 1;
+    
+    while(1)
+        house_loop();
 }